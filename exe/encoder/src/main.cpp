@@ -26,8 +26,9 @@ struct Args
     int mask_id = 0;
     int scale = 1;
     int indent = 4;
-    std::string output = "out.ppm";
+    std::vector<std::string> outputs;
     std::string log_level_str = "info";
+    bool inverse = false;
 
     void Init(int argc, char* argv[])
     {
@@ -72,7 +73,7 @@ struct Args
             else if (args[i] == "-o" || args[i] == "--output")
             {
                 if (i + 1 < args.size())
-                    output = args[++i];
+                    outputs.push_back(args[++i]);
                 else
                     ExitWithErrorMessage("--output option requires an argument.");
             }
@@ -105,6 +106,10 @@ struct Args
                 else
                     ExitWithErrorMessage("--scale option requires an argument.");
             }
+            else if (args[i] == "--inverse")
+            {
+                inverse = true;
+            }
             else if (args[i] == "-i" || args[i] == "--indent")
             {
                 if (i + 1 < args.size())
@@ -122,6 +127,9 @@ struct Args
             ExitWithErrorMessage("`message` was not provided");
         }
 
+        if (outputs.empty())
+            outputs.push_back("out.ppm");
+
         Validate();
     }
 
@@ -150,9 +158,13 @@ struct Args
            << "                             Must be one of `L` (7%), `M` (15%), `Q` (25%), `H` (30%)" << std::endl
            << "  -m,--mask <mask_id>      - identificator of mask function. Negative value means choosing the best mask." << std::endl
            << "                             Integer value from range [0; 7] identify specific function." << std::endl
-           << "  -o,--output <filename>   - output image (supported formats: ppm, svg, console)." << std::endl
+           << "  -o,--output <filename>   - output image (supported formats: ppm (ASCII PBM), pbm, png, svg, svgz, eps, pdf, tif (G4);" << std::endl
+           << "                             printer streams: pos (ESC/POS raster), zpl (ZPL graphic field);" << std::endl
+           << "                             `console` and `unicode` (half blocks) print to stdout)." << std::endl
+           << "                             Can be repeated, the message is encoded once for all outputs." << std::endl
            << "  -s,--scale <int>         - scaling factor for output image (default 1)" << std::endl
-           << "  -i,--indent <int>        - indentation for output QR code (default 4)"
+           << "  -i,--indent <int>        - indentation for output QR code (default 4)" << std::endl
+           << "  --inverse                - draw `console` and `unicode` outputs in ANSI inverse video" << std::endl
            << "  -l,--log-level <level>   - set logging level. Must be one of `critical`, `error`, `warning`, `debug`, `info` or `void`" << std::endl
            << std::endl
            << "Required arguments:" << std::endl
@@ -162,6 +174,42 @@ struct Args
 
 // =============================================================================
 
+std::unique_ptr<myqro::Outputter> MakeOutputter(const std::string& output, bool inverse)
+{
+    if (output == "console")
+        return std::make_unique<myqro::ConsoleOutputter>(std::cout, myqro::ConsoleStyle::ASCII, inverse);
+    if (output == "unicode")
+        return std::make_unique<myqro::ConsoleOutputter>(std::cout, myqro::ConsoleStyle::HALF_BLOCKS, inverse);
+
+    std::filesystem::path path(output);
+    std::string ext = path.extension();
+    if (ext == ".ppm" || ext == ".PPM")
+        return std::make_unique<myqro::PBMOutputter>(path, myqro::PbmFormat::ASCII);
+    if (ext == ".pbm" || ext == ".PBM")
+        return std::make_unique<myqro::PBMOutputter>(path, myqro::PbmFormat::BINARY);
+    if (ext == ".png" || ext == ".PNG")
+        return std::make_unique<myqro::PngOutputter>(path);
+    if (ext == ".svg" || ext == ".SVG")
+        return std::make_unique<myqro::SvgOutputter>(path);
+    if (ext == ".svgz" || ext == ".SVGZ")
+        return std::make_unique<myqro::SvgzOutputter>(path);
+    if (ext == ".eps" || ext == ".EPS")
+        return std::make_unique<myqro::EpsOutputter>(path);
+    if (ext == ".tif" || ext == ".tiff" || ext == ".TIF" || ext == ".TIFF")
+        return std::make_unique<myqro::TiffG4Outputter>(path);
+    if (ext == ".pdf" || ext == ".PDF")
+        return std::make_unique<myqro::PdfOutputter>(path);
+    if (ext == ".pos" || ext == ".POS")
+        return std::make_unique<myqro::EscPosOutputter>(path);
+    if (ext == ".zpl" || ext == ".ZPL")
+        return std::make_unique<myqro::ZplOutputter>(path);
+
+    ExitWithErrorMessage("Unsupported output format: {}", ext);
+    return nullptr;
+}
+
+// =============================================================================
+
 int main(int argc, char* argv[])
 {
     Args args;
@@ -169,27 +217,17 @@ int main(int argc, char* argv[])
     args.Init(argc, argv);
     myqro::SetLogLevel(args.log_level_str);
 
-    std::unique_ptr<myqro::Outputter> outputter;
-    if (args.output == "console")
-        outputter = std::make_unique<myqro::ConsoleOutputter>(std::cout);
-    else
-    {
-        std::filesystem::path path(args.output);
-        std::string ext = path.extension();
-        if (ext == ".ppm" || ext == ".PPM")
-            outputter = std::make_unique<myqro::PBMOutputter>(path);
-        else if (ext == ".svg" || ext == ".SVG")
-            outputter = std::make_unique<myqro::SvgOutputter>(path);
-        else if (ext == ".eps" || ext == ".EPS")
-            outputter = std::make_unique<myqro::EpsOutputter>(path);
-        else
-            ExitWithErrorMessage("Unsupported output format: {}", ext);
-    }
+    std::vector<std::unique_ptr<myqro::Outputter>> outputters;
+    for (const std::string& output: args.outputs)
+        outputters.push_back(MakeOutputter(output, args.inverse));
 
     myqro::Canvas canvas = myqro::Encoder::Encode(args.msg, args.cl, args.encoding, args.mask_id);
     LogDebug("Version: {}", canvas.Version());
 
-    outputter->Output(canvas, myqro::OutputOptions(args.scale, args.indent));
+    std::vector<myqro::Outputter*> targets;
+    for (const auto& outputter: outputters)
+        targets.push_back(outputter.get());
+    myqro::Outputter::OutputAll(canvas, myqro::OutputOptions(args.scale, args.indent), targets);
 
     return 0;
 }
@@ -0,0 +1,26 @@
+// Parts of the regular library replaced in myqro_freestanding
+
+#include <cstdlib>
+
+#include "defines.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Lookups of the constant tables fail only on internal errors, there is nobody to
+// catch an exception
+void ThrowOutOfRange(const char*)
+{
+    std::abort();
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
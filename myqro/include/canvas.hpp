@@ -1,11 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <ostream>
+#include <span>
 #include <vector>
 
-#include "datastream.hpp"
+#include "canvas_base.hpp"
 
 
 // =============================================================================
@@ -15,75 +16,51 @@ namespace myqro
 
 // =============================================================================
 
-struct Dir
+// Pixels of caller-owned framebuffers
+enum class PixelFormat : uint8_t
 {
-    int dr;
-    int dc;
+    MONO,       // 1 bit per pixel, first pixel in the most significant bit, dark is 1
+    GRAY8,      // 1 byte per pixel, dark is 0x00, light is 0xFF
 };
 
 // =============================================================================
 
-enum class Pattern : size_t
-{
-    UNKNOWN = 0,
-    INDENT = 1,
-    SEARCH = 2,
-    LEVELING = 3,
-    SYNC = 4,
-    MASK_CORRECTION = 5,
-    VERSION = 6,
-    DATA = 7,
-};
-
-const char* PatternNameToString(Pattern p);
-
-// =============================================================================
-
-struct Cell
-{
-    Pattern kind;
-    uint8_t value;
-
-    Cell() : kind(Pattern::UNKNOWN) {}
-    Cell(Pattern k, uint8_t v) : kind(k), value(v) {}
-};
-
-// =============================================================================
-
-class Canvas
+class Canvas : public CanvasBase<Canvas>
 {
 public:
     Canvas(size_t version);
-
-    void SetupSearchPatterns();
-    void SetupLevelingPatterns();
-    void SetupSyncLines();
-    void SetupVersionCode();
-
-    void FillData(CorrectionLevel cl, size_t mask_id, const DataStream& stream);
+    Canvas(size_t version, std::span<const Cell> cells);
 
     void DebugPatterns(std::ostream& os) const;
     void DebugOutputFillDataOrder(std::ostream& os);
 
-    Cell& At(size_t row, size_t col) { return cells_[Index(row, col)]; }
-    const Cell& At(size_t row, size_t col) const { return cells_[Index(row, col)]; }
-    bool IsInside(int row, int col) const { return row >= 0 && row < static_cast<int>(size_) && col >= 0 && col < static_cast<int>(size_); }
-
-    size_t Penalty(size_t mask_id) const;
-
     size_t Version() const { return version_; }
     size_t Size() const { return size_; }
 
-private:
-    void PlaceSearchPattern(int row, int col);
-    void PlaceLevelingPattern(int row, int col);
-    void PlaceCorrectionMaskCode(CorrectionLevel cl, size_t mask_id);
-    size_t Index(int row, int col) const { return row*size_ + col; }
+    std::span<Cell> Cells() { return cells_; }
+    std::span<const Cell> Cells() const { return cells_; }
+
+    // Modules of one row packed 8 per byte, dark modules are 1. Cells are
+    // gathered a word at a time, so it is the fast way to read a row.
+    void PackedRow(size_t row, std::span<uint8_t> bits, bool msb_first = true) const;
+
+    // All rows packed, row r starts at byte r * stride
+    void ExportPacked(std::span<std::byte> dst, size_t stride, bool msb_first = true) const;
 
-    bool HasSameColorSquare(size_t row, size_t col, size_t sq) const;
-    bool HasColorStripe(size_t row, size_t col, int dr, int dc, size_t len, uint8_t color=WHITE) const;
+    // Renders the symbol with `indent` modules of quiet zone, `scale` pixels per
+    // module, into a framebuffer of rows `stride` bytes apart. The top left pixel
+    // goes to (x, y), x need not be byte aligned for MONO, pixels outside the
+    // symbol are kept.
+    void BlitScaled(std::span<std::byte> dst, size_t stride, size_t x, size_t y, size_t scale, size_t indent,
+                    PixelFormat format = PixelFormat::MONO) const;
+
+private:
+    friend class CanvasBase<Canvas>;
 
-    void IterateDataModules(Pattern pattern, std::function<void(size_t, size_t, size_t)> f);
+    const LevelingCenters& Leveling() const { return LevelingPatterns[version_ - 1]; }
+    uint32_t VersionBits() const { return VersionCode[version_ - 1]; }
+    std::vector<size_t> DataOrder() const { return ModulesOrder(Pattern::UNKNOWN); }
+    std::vector<uint8_t> Plane() const { return std::vector<uint8_t>(cells_.size()); }
 
 private:
     size_t version_;
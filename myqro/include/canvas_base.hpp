@@ -0,0 +1,322 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <vector>
+
+#include "bits.hpp"
+#include "core.hpp"
+#include "datastream.hpp"
+#include "defines.hpp"
+#include "error.hpp"
+#include "logger.hpp"
+#include "simd.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+enum class Pattern : uint8_t
+{
+    UNKNOWN = 0,
+    INDENT = 1,
+    SEARCH = 2,
+    LEVELING = 3,
+    SYNC = 4,
+    MASK_CORRECTION = 5,
+    VERSION = 6,
+    DATA = 7,
+};
+
+const char* PatternNameToString(Pattern p);
+
+// =============================================================================
+
+struct Cell
+{
+    Pattern kind;
+    uint8_t value;
+
+    Cell() : kind(Pattern::UNKNOWN) {}
+    Cell(Pattern k, uint8_t v) : kind(k), value(v) {}
+};
+
+// =============================================================================
+
+// Mask penalty rules of core run by the kernels. Planes hold one byte per module;
+// lines are scanned independently, so the penalty of a symbol is the sum over its
+// rows, columns and pairs of adjacent rows, plus core::BalancePenalty.
+
+// Bars 5+ modules long and "# ### #" patterns with 4 white modules at one of the
+// sides (or both) in `rows` lines of `width` modules
+inline size_t LinesPenalty(const Kernels& kernels, const uint8_t* plane, size_t width, size_t rows)
+{
+    return kernels.penalty_runs(plane, width, rows) + core::PATTERN_PENALTY * kernels.penalty_finders(plane, width, rows);
+}
+
+// 2x2 squares of the same color in `rows` lines of `width` modules
+inline size_t SquaresPenalty(const Kernels& kernels, const uint8_t* plane, size_t width, size_t rows)
+{
+    return core::SQUARE_PENALTY * kernels.penalty_squares(plane, width, rows);
+}
+
+// =============================================================================
+
+// Symbol layout, data placement and penalty shared by the canvas of runtime version
+// (Canvas) and the canvases specialized for one version (FixedCanvas). Derived
+// provides storage and geometry:
+//   Version(), Size()      - constexpr in FixedCanvas, so all loops get fixed bounds
+//   Cells()                - contiguous Size() * Size() cells
+//   Leveling()             - leveling pattern centers of the version
+//   VersionBits()          - version information code, 0 for versions below 7
+//   DataOrder()            - data modules in placement order
+//   Plane()                - zeroed Size() * Size() byte buffer for penalty scans
+template <typename Derived>
+class CanvasBase
+{
+public:
+    void SetupSearchPatterns();
+    void SetupLevelingPatterns();
+    void SetupSyncLines();
+    void SetupVersionCode();
+
+    void FillData(CorrectionLevel cl, size_t mask_id, const DataStream& stream);
+
+    Cell& At(size_t row, size_t col) { return Self().Cells()[Index(row, col)]; }
+    const Cell& At(size_t row, size_t col) const { return Self().Cells()[Index(row, col)]; }
+    bool IsInside(int row, int col) const
+    {
+        int size = static_cast<int>(Self().Size());
+        return row >= 0 && row < size && col >= 0 && col < size;
+    }
+
+    size_t Penalty(size_t mask_id) const;
+
+    // Indices (row * Size() + col) of data modules in placement order
+    std::vector<size_t> DataModulesOrder() const { return ModulesOrder(Pattern::DATA); }
+
+protected:
+    void PlaceSearchPattern(int row, int col);
+    void PlaceLevelingPattern(int row, int col);
+    void PlaceCorrectionMaskCode(CorrectionLevel cl, size_t mask_id);
+    size_t Index(int row, int col) const { return row*Self().Size() + col; }
+
+    template <typename F>
+    void IterateDataModules(Pattern pattern, F&& f) const;
+    std::vector<size_t> ModulesOrder(Pattern pattern) const;
+
+private:
+    Derived& Self() { return static_cast<Derived&>(*this); }
+    const Derived& Self() const { return static_cast<const Derived&>(*this); }
+};
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::SetupSearchPatterns()
+{
+    const int size = Self().Size();
+    PlaceSearchPattern(-1, -1);
+    PlaceSearchPattern(-1, size - SEARCH_PATTERN_SIZE);
+    PlaceSearchPattern(size - SEARCH_PATTERN_SIZE, -1);
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::SetupLevelingPatterns()
+{
+    if (Self().Version() >= 2)
+    {
+        const auto& centers = Self().Leveling();
+        for (size_t p: centers)
+            for (size_t q: centers)
+                PlaceLevelingPattern(p, q);
+    }
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::SetupSyncLines()
+{
+    static const int b = SEARCH_PATTERN_SIZE - 2;
+    for (int a = Self().Size() - SEARCH_PATTERN_SIZE + 1; a > b; a--)
+    {
+        Cell& c1 = At(a, b);
+        if (c1.kind == Pattern::UNKNOWN)
+            c1 = {Pattern::SYNC, core::SyncModule(a)};
+
+        Cell& c2 = At(b, a);
+        if (c2.kind == Pattern::UNKNOWN)
+            c2 = {Pattern::SYNC, core::SyncModule(a)};
+    }
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::SetupVersionCode()
+{
+    if (Self().Version() >= 7)
+    {
+        uint32_t code = Self().VersionBits();
+        int start = Self().Size() - SEARCH_PATTERN_SIZE - core::VERSION_CODE_ROWS;
+        for (int r = 0; r < core::VERSION_CODE_ROWS; r++)
+        {
+            for (int c = 0; c < core::VERSION_CODE_COLS; c++)
+            {
+                uint8_t value = core::VersionCodeBit(code, r, c);
+                At(start + r, c) = {Pattern::VERSION, value};
+                At(c, start + r) = {Pattern::VERSION, value};
+            }
+        }
+    }
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::FillData(CorrectionLevel cl, size_t mask_id, const DataStream& stream)
+{
+    if (mask_id >= MaskFunctions.size())
+        throw Error(std::format("No such mask_id: {}", mask_id));
+
+    PlaceCorrectionMaskCode(cl, mask_id);
+
+    // data modules in placement order with their unpacked bits and mask values
+    const std::vector<size_t>& order = Self().DataOrder();
+    const size_t size = Self().Size();
+
+    const Kernels& kernels = GetKernels();
+    std::vector<uint8_t> values(order.size(), 0);
+    std::vector<uint8_t> masks(order.size());
+    kernels.unpack_bits(stream.Data(), std::min(stream.Size(), order.size()), values.data());
+    for (size_t i = 0; i < order.size(); i++)
+        masks[i] = MaskBit(mask_id, order[i] / size, order[i] % size);
+    kernels.xor_bytes(values.data(), masks.data(), order.size());
+
+    auto cells = Self().Cells();
+    for (size_t i = 0; i < order.size(); i++)
+        cells[order[i]] = {Pattern::DATA, values[i]};
+}
+
+// =============================================================================
+
+template <typename Derived>
+size_t CanvasBase<Derived>::Penalty(size_t mask_id) const
+{
+    const size_t size = Self().Size();
+
+    // module values row by row and column by column, so vertical scans are the same as horizontal ones
+    auto rows = Self().Plane();
+    auto cols = Self().Plane();
+    for (size_t row = 0; row < size; ++row)
+    {
+        for (size_t col = 0; col < size; ++col)
+        {
+            uint8_t value = At(row, col).value;
+            rows[row * size + col] = value;
+            cols[col * size + row] = value;
+        }
+    }
+
+    const Kernels& kernels = GetKernels();
+    size_t result = LinesPenalty(kernels, rows.data(), size, size) + LinesPenalty(kernels, cols.data(), size, size);
+    result += SquaresPenalty(kernels, rows.data(), size, size);
+    result += core::BalancePenalty(kernels.count_ones(rows.data(), rows.size()), size * size);
+
+    LogDebug("Penalty: mask={} result={}", mask_id, result);
+    return result;
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::PlaceSearchPattern(int row, int col)
+{
+    for (int r = row; r <= row + SEARCH_PATTERN_SIZE; r++)
+        for (int c = col; c <= col + SEARCH_PATTERN_SIZE; c++)
+            if (IsInside(r, c))
+                At(r, c) = {Pattern::SEARCH, core::SearchPatternModule(r - row, c - col)};
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::PlaceLevelingPattern(int row, int col)
+{
+    static const int half_size = core::LEVELING_HALF_SIZE;
+    // check if leveling pattern intersects with search pattern
+    for (int r = row - half_size; r <= row + half_size; r++)
+    {
+        for (int c = col - half_size; c <= col + half_size; c++)
+        {
+            if (!IsInside(r, c))
+                throw Error("Trying to place leveling pattern outside of the code canvas");
+            Cell& cell = At(r, c);
+            if (cell.kind == Pattern::SEARCH)
+            {
+                LogDebug("Can't place leveling pattern module at ({},{}): module is occupied with {}",
+                         r, c, PatternNameToString(cell.kind));
+                return;
+            }
+        }
+    }
+
+    for (int r = row - half_size; r <= row + half_size; r++)
+        for (int c = col - half_size; c <= col + half_size; c++)
+            At(r, c) = {Pattern::LEVELING, core::LevelingPatternModule(r - row, c - col)};
+}
+
+// =============================================================================
+
+template <typename Derived>
+void CanvasBase<Derived>::PlaceCorrectionMaskCode(CorrectionLevel cl, size_t mask_id)
+{
+    size_t code = CorrectionLevelMaskCode.at(cl)[mask_id];
+    const int size = Self().Size();
+
+    core::ForEachFormatModule(Self().Version(), [this, code](int r, int c, int shift) {
+        At(r, c) = {Pattern::MASK_CORRECTION, GetBit(code, shift)};
+    });
+
+    // this square must always be black
+    At(size - SEARCH_PATTERN_SIZE, SEARCH_PATTERN_SIZE) = {Pattern::MASK_CORRECTION, BLACK};
+}
+
+// =============================================================================
+
+template <typename Derived>
+template <typename F>
+void CanvasBase<Derived>::IterateDataModules(Pattern pattern, F&& f) const
+{
+    size_t index = 0;
+    core::ForEachPlacementModule(Self().Version(), [this, pattern, &f, &index](int r, int c)
+    {
+        if (At(r, c).kind == pattern)
+            f(index++, r, c);
+    });
+}
+
+// =============================================================================
+
+template <typename Derived>
+std::vector<size_t> CanvasBase<Derived>::ModulesOrder(Pattern pattern) const
+{
+    std::vector<size_t> order;
+    order.reserve(Self().Size() * Self().Size());
+    IterateDataModules(pattern, [&order, this](size_t, size_t r, size_t c) { order.push_back(Index(r, c)); });
+    return order;
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// CCITT T.6 (Group 4) encoder of bilevel rows. Every row is coded against the
+// previous one (the first against a white row) from the positions where pixels
+// change color, so rows repeated `scale` times cost one bit each.
+class G4Encoder
+{
+public:
+    G4Encoder(size_t width);
+
+    // Packed row, first pixel in the most significant bit, black pixels are 1
+    void Row(std::span<const uint8_t> pixels);
+
+    // Appends the end of facsimile block and pads the last byte
+    void Finish();
+
+    // Coded bytes are appended to Output() as soon as they are complete
+    std::vector<uint8_t>& Output() { return output_; }
+
+private:
+    // b2 is looked up one change after b1, which can be one after the first sentinel
+    static constexpr size_t SENTINELS = 3;
+
+    void FindChanges(std::span<const uint8_t> pixels, std::vector<size_t>& changes) const;
+
+    void PutBits(uint32_t code, int length);
+    void PutRun(size_t run, bool black);
+
+private:
+    size_t width_;
+    std::vector<size_t> reference_;     // changing elements of the previous row
+    std::vector<size_t> coding_;        // and of the current one, both end with sentinels at width_
+
+    uint32_t bits_;
+    int n_bits_;
+    std::vector<uint8_t> output_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -12,6 +12,20 @@ namespace myqro
 
 // =============================================================================
 
+struct EncodeOptions
+{
+    // Masks are evaluated concurrently on the shared thread pool for versions
+    // starting from this one (0 disables concurrent evaluation)
+    size_t parallel_mask_min_version = 25;
+
+    // Correction blocks are generated concurrently when the estimated amount of
+    // work (number of Galois field multiply-accumulates) reaches this value
+    // (0 disables concurrent generation)
+    size_t parallel_blocks_min_cost = 16384;
+};
+
+// =============================================================================
+
 struct Context
 {
     DataStream stream;
@@ -24,6 +38,7 @@ struct Context
     std::vector<Block> data_blocks;
     std::vector<ArrayType> correction_blocks;
     ArrayType output;
+    EncodeOptions options;
     const size_t encoding_field_width = 4;
 
     Context() :
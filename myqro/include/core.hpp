@@ -0,0 +1,667 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.hpp"
+
+
+// =============================================================================
+
+// Encoding pipeline usable in constant expressions and without heap or exceptions:
+// data conversion, Reed-Solomon, placement and mask selection work on buffers
+// provided by the caller and report errors with Status. The runtime Encoder takes
+// the version layout, data conversion, function patterns, placement order and
+// penalty rules from here, so both produce the same symbols.
+namespace myqro::core
+{
+
+// =============================================================================
+
+enum class Status : uint8_t
+{
+    OK                  = 0,
+    UNSUPPORTED_DATA    = 1,    // data can't be represented in the encoding
+    DATA_TOO_BIG        = 2,    // data doesn't fit into the largest version
+    BUFFER_TOO_SMALL    = 3,
+    INVALID_ARGUMENT    = 4,
+};
+
+constexpr const char* StatusToString(Status s)
+{
+    switch (s)
+    {
+        case Status::OK:                return "OK";
+        case Status::UNSUPPORTED_DATA:  return "UNSUPPORTED_DATA";
+        case Status::DATA_TOO_BIG:      return "DATA_TOO_BIG";
+        case Status::BUFFER_TOO_SMALL:  return "BUFFER_TOO_SMALL";
+        case Status::INVALID_ARGUMENT:  return "INVALID_ARGUMENT";
+    }
+    return "UNKNOWN";
+}
+
+// =============================================================================
+
+// Modules are stored one byte per module, row by row. Besides the color a byte
+// marks function patterns, which are skipped by data placement and masking.
+inline constexpr uint8_t MODULE_DARK = 0b001;
+inline constexpr uint8_t MODULE_FUNCTION = 0b010;
+inline constexpr uint8_t MODULE_SEARCH = 0b100;
+
+inline constexpr size_t MAX_SIZE = SymbolSize(MAX_VERSION);
+
+// Number of data and correction codewords of a version (the same for all levels)
+constexpr size_t CodewordsCount(size_t version)
+{
+    const size_t i = version - 1;
+    return VersionCorrectionMaxDataSize.at(CorrectionLevel::L)[i] / BITS_PER_BYTE +
+           BlocksCount.at(CorrectionLevel::L)[i] * CorrBlockBytes.at(CorrectionLevel::L)[i];
+}
+
+inline constexpr size_t MAX_CODEWORDS = CodewordsCount(MAX_VERSION);
+
+// =============================================================================
+
+constexpr int AlphaNumericCode(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    switch (c)
+    {
+        case ' ': return 36;
+        case '$': return 37;
+        case '%': return 38;
+        case '*': return 39;
+        case '+': return 40;
+        case '-': return 41;
+        case '.': return 42;
+        case '/': return 43;
+        case ':': return 44;
+    }
+    return -1;
+}
+
+constexpr bool IsDataSupported(const char* data, size_t length, EncodingType encoding)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (encoding == EncodingType::NUNERIC && (data[i] < '0' || data[i] > '9'))
+            return false;
+        if (encoding == EncodingType::ALPHANUMERIC && AlphaNumericCode(data[i]) < 0)
+            return false;
+    }
+    return encoding == EncodingType::NUNERIC || encoding == EncodingType::ALPHANUMERIC ||
+           encoding == EncodingType::BYTES;
+}
+
+// Bits of the converted data without service fields
+constexpr size_t PayloadBits(size_t length, EncodingType encoding)
+{
+    switch (encoding)
+    {
+        case EncodingType::NUNERIC:         return 10 * (length / 3) + (length % 3 == 0 ? 0 : 1 + 3 * (length % 3));
+        case EncodingType::ALPHANUMERIC:    return 11 * (length / 2) + 6 * (length % 2);
+        case EncodingType::BYTES:           return BITS_PER_BYTE * length;
+        default:                            return 0;
+    }
+}
+
+// =============================================================================
+
+// Appends bits MSB first to a zero-initialized buffer
+class BitWriter
+{
+public:
+    constexpr explicit BitWriter(uint8_t* data) : data_(data), size_(0) {}
+
+    constexpr void Append(uint32_t value, size_t width)
+    {
+        for (size_t i = width; i-- > 0; size_++)
+            data_[size_ / BITS_PER_BYTE] |= static_cast<uint8_t>(((value >> i) & 1) << (BITS_PER_BYTE - 1 - size_ % BITS_PER_BYTE));
+    }
+
+    constexpr size_t Size() const { return size_; }
+
+private:
+    uint8_t* data_;
+    size_t size_;
+};
+
+// Appends the data converted to the encoding, without service fields, to a writer
+// with Append(value, width) such as BitWriter. Digits are packed by 3, alphanumeric
+// chars by 2.
+template <typename Writer>
+constexpr void AppendPayload(const char* data, size_t length, EncodingType encoding, Writer& writer)
+{
+    if (encoding == EncodingType::BYTES)
+    {
+        for (size_t i = 0; i < length; i++)
+            writer.Append(static_cast<uint8_t>(data[i]), BITS_PER_BYTE);
+        return;
+    }
+
+    const bool numeric = encoding == EncodingType::NUNERIC;
+    const size_t group = numeric ? 3 : 2;
+    for (size_t i = 0; i < length; i += group)
+    {
+        size_t tail = (length - i < group) ? length - i : group;
+        uint32_t value = 0;
+        for (size_t j = 0; j < tail; j++)
+            value = numeric ? value * 10 + (data[i + j] - '0') : value * 45 + AlphaNumericCode(data[i + j]);
+        writer.Append(value, numeric ? 1 + 3 * tail : 5 * tail + 1);
+    }
+}
+
+// =============================================================================
+
+struct Layout
+{
+    size_t version = 0;
+    size_t max_data_size = 0;           // in bits
+    size_t data_size_field_width = 0;
+};
+
+// Version and service field widths of `payload` bits of converted data (see
+// PayloadBits), also used by EncodeProvider::PrepareServiceFields
+constexpr Status ChooseLayout(size_t payload, EncodingType encoding, CorrectionLevel cl, Layout& layout)
+{
+    constexpr size_t encoding_field_width = 4;
+    const auto& sizes = VersionCorrectionMaxDataSize.at(cl);
+
+    size_t version = MIN_VERSION;
+    while (version <= MAX_VERSION && sizes[version - 1] <= payload)
+        version++;
+    if (version > MAX_VERSION)
+        return Status::DATA_TOO_BIG;
+
+    size_t max_version = (version <= 9) ? 9 : (version <= 26) ? 26 : MAX_VERSION;
+    layout.data_size_field_width = DataSizeFieldWidth.at(encoding).at(max_version);
+    layout.max_data_size = sizes[version - 1];
+
+    if (payload + encoding_field_width + layout.data_size_field_width > layout.max_data_size)
+    {
+        version += 1;
+        if (version > MAX_VERSION)
+            return Status::DATA_TOO_BIG;
+        layout.max_data_size = sizes[version - 1];
+    }
+    if (payload + encoding_field_width + layout.data_size_field_width > layout.max_data_size)
+        return Status::DATA_TOO_BIG;
+
+    layout.version = version;
+    return Status::OK;
+}
+
+// =============================================================================
+
+// Reed-Solomon correction bytes of one block (n_correction_bytes must be a key of
+// GeneratingPolynomial)
+constexpr void CorrectionBytes(const uint8_t* data, size_t size, size_t n_correction_bytes, uint8_t* parity)
+{
+    const auto& poly = GeneratingPolynomial.at(n_correction_bytes);
+
+    for (size_t i = 0; i < n_correction_bytes; i++)
+        parity[i] = 0;
+
+    for (size_t j = 0; j < size; j++)
+    {
+        uint8_t A = data[j] ^ parity[0];
+        for (size_t i = 0; i + 1 < n_correction_bytes; i++)
+            parity[i] = parity[i + 1];
+        parity[n_correction_bytes - 1] = 0;
+
+        if (A == 0) continue;
+
+        size_t B = ReverseGaloisField[A];
+        for (size_t i = 0; i < n_correction_bytes; i++)
+            parity[i] ^= GaloisField[(poly[i] + B) % 255];
+    }
+}
+
+// =============================================================================
+
+// Blocks of a version and correction level: first `ordinary` blocks have
+// `bytes_per_block` data bytes, the rest have one more
+struct Blocks
+{
+    size_t count;
+    size_t ordinary;
+    size_t bytes_per_block;
+    size_t n_correction_bytes;
+    size_t data_bytes;
+
+    constexpr Blocks(size_t version, CorrectionLevel cl) :
+        count(BlocksCount.at(cl)[version - 1]),
+        ordinary(0),
+        bytes_per_block(0),
+        n_correction_bytes(CorrBlockBytes.at(cl)[version - 1]),
+        data_bytes(VersionCorrectionMaxDataSize.at(cl)[version - 1] / BITS_PER_BYTE)
+    {
+        bytes_per_block = data_bytes / count;
+        ordinary = count - data_bytes % count;
+    }
+
+    constexpr size_t Offset(size_t block) const { return block * bytes_per_block + (block > ordinary ? block - ordinary : 0); }
+    constexpr size_t Size(size_t block) const { return bytes_per_block + (block < ordinary ? 0 : 1); }
+
+    // Codeword `index` of the interleaved sequence, when codewords are stored as
+    // data blocks followed by correction blocks
+    constexpr uint8_t Interleaved(const uint8_t* codewords, size_t index) const
+    {
+        if (index < data_bytes)
+        {
+            size_t round = index / count;
+            size_t block = index % count;
+            if (round == bytes_per_block)
+                block += ordinary;
+            return codewords[Offset(block) + round];
+        }
+
+        index -= data_bytes;
+        return codewords[data_bytes + (index % count) * n_correction_bytes + index / count];
+    }
+};
+
+// =============================================================================
+
+// Converts the data into codewords: data blocks followed by their correction blocks,
+// CodewordsCount(version) bytes in total
+constexpr Status EncodeCodewords(const char* data, size_t length, EncodingType encoding, CorrectionLevel cl,
+                                 uint8_t* codewords, size_t capacity, size_t& version)
+{
+    if (!IsDataSupported(data, length, encoding))
+        return Status::UNSUPPORTED_DATA;
+
+    Layout layout;
+    if (Status s = ChooseLayout(PayloadBits(length, encoding), encoding, cl, layout); s != Status::OK)
+        return s;
+    if (capacity < CodewordsCount(layout.version))
+        return Status::BUFFER_TOO_SMALL;
+
+    for (size_t i = 0; i < capacity; i++)
+        codewords[i] = 0;
+
+    BitWriter writer(codewords);
+    writer.Append(static_cast<uint8_t>(encoding), 4);
+    writer.Append(static_cast<uint32_t>(length), layout.data_size_field_width);
+    AppendPayload(data, length, encoding, writer);
+
+    // zero bits up to the byte boundary, then filler bytes
+    constexpr uint8_t tail_bytes[] = {0b11101100, 0b00010001};
+    const Blocks blocks(layout.version, cl);
+    size_t n_bytes = (writer.Size() + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    for (size_t i = n_bytes; i < blocks.data_bytes; i++)
+        codewords[i] = tail_bytes[(i - n_bytes) % 2];
+
+    for (size_t b = 0; b < blocks.count; b++)
+        CorrectionBytes(codewords + blocks.Offset(b), blocks.Size(b), blocks.n_correction_bytes,
+                        codewords + blocks.data_bytes + b * blocks.n_correction_bytes);
+
+    version = layout.version;
+    return Status::OK;
+}
+
+// =============================================================================
+
+// Function pattern modules, shared with CanvasBase
+
+// Module (r, c) of a search pattern with its separator, counted from the top left
+// separator module: white separator, black frame, white frame and black 3x3 square
+constexpr uint8_t SearchPatternModule(int r, int c)
+{
+    int d = (r < c) ? r : c;
+    d = (d < SEARCH_PATTERN_SIZE - r) ? d : SEARCH_PATTERN_SIZE - r;
+    d = (d < SEARCH_PATTERN_SIZE - c) ? d : SEARCH_PATTERN_SIZE - c;
+    return (d == 1 || d >= 3) ? BLACK : WHITE;
+}
+
+inline constexpr int LEVELING_HALF_SIZE = 2;
+
+// Module (dr, dc) of a leveling pattern relative to its center: black border and center
+constexpr uint8_t LevelingPatternModule(int dr, int dc)
+{
+    bool border = dr == -LEVELING_HALF_SIZE || dr == LEVELING_HALF_SIZE || dc == -LEVELING_HALF_SIZE || dc == LEVELING_HALF_SIZE;
+    return (border || (dr == 0 && dc == 0)) ? BLACK : WHITE;
+}
+
+// Module `a` of a sync line, they start and end with black modules
+constexpr uint8_t SyncModule(int a)
+{
+    return (a % 2 == 0) ? BLACK : WHITE;
+}
+
+inline constexpr int VERSION_CODE_ROWS = 3;
+inline constexpr int VERSION_CODE_COLS = 6;
+
+// Bit of the version information in row r and column c of the block left to the
+// top right search pattern, the block below the bottom left one is transposed
+constexpr uint8_t VersionCodeBit(uint32_t code, int r, int c)
+{
+    return (code >> ((VERSION_CODE_ROWS - 1 - r) * VERSION_CODE_COLS + VERSION_CODE_COLS - 1 - c)) & 1;
+}
+
+// Calls f(row, col) for every module in data placement order: two columns wide
+// strips from the right to the left, going up and down in turn, the vertical sync
+// line is skipped. Function modules are not skipped.
+template <typename F>
+constexpr void ForEachPlacementModule(size_t version, F f)
+{
+    const int size = SymbolSize(version);
+    for (int i = 0; i < size / 2; i++)
+    {
+        bool down = i % 2;
+        int c = size - 1 - 2 * i;
+        if (c <= SEARCH_PATTERN_SIZE - 2)
+            c--;
+
+        for (int k = 0; k < size; k++)
+        {
+            int r = down ? k : size - 1 - k;
+            f(r, c);
+            f(r, c - 1);
+        }
+    }
+}
+
+// =============================================================================
+
+namespace detail
+{
+
+constexpr void PlaceSearchPattern(uint8_t* modules, int size, int row, int col)
+{
+    for (int r = row; r <= row + SEARCH_PATTERN_SIZE; r++)
+    {
+        for (int c = col; c <= col + SEARCH_PATTERN_SIZE; c++)
+        {
+            if (r < 0 || r >= size || c < 0 || c >= size) continue;
+            modules[r * size + c] = MODULE_FUNCTION | MODULE_SEARCH | SearchPatternModule(r - row, c - col);
+        }
+    }
+}
+
+constexpr void PlaceLevelingPattern(uint8_t* modules, int size, int row, int col)
+{
+    for (int r = row - LEVELING_HALF_SIZE; r <= row + LEVELING_HALF_SIZE; r++)
+        for (int c = col - LEVELING_HALF_SIZE; c <= col + LEVELING_HALF_SIZE; c++)
+            if (modules[r * size + c] & MODULE_SEARCH)
+                return;
+
+    for (int r = row - LEVELING_HALF_SIZE; r <= row + LEVELING_HALF_SIZE; r++)
+        for (int c = col - LEVELING_HALF_SIZE; c <= col + LEVELING_HALF_SIZE; c++)
+            modules[r * size + c] = MODULE_FUNCTION | LevelingPatternModule(r - row, c - col);
+}
+
+} // namespace detail
+
+// =============================================================================
+
+// Calls f(row, col, shift) for every module of format information except the
+// always dark one, the module holds bit `shift` of the format code
+template <typename F>
+constexpr void ForEachFormatModule(size_t version, F f)
+{
+    constexpr int code_size = 2 * SEARCH_PATTERN_SIZE - 1;
+    const int size = SymbolSize(version);
+
+    for (int r = 0; r < SEARCH_PATTERN_SIZE - 1; r++)
+        f(size - 1 - r, SEARCH_PATTERN_SIZE, code_size - r - 1);
+
+    for (int c = 0; c < SEARCH_PATTERN_SIZE; c++)
+        f(SEARCH_PATTERN_SIZE, size - SEARCH_PATTERN_SIZE + c, code_size - c - SEARCH_PATTERN_SIZE);
+
+    for (int c = 0; c < SEARCH_PATTERN_SIZE - 1; c++)
+        f(SEARCH_PATTERN_SIZE, (c >= SEARCH_PATTERN_SIZE - 2) ? c + 1 : c, code_size - c - 1);
+
+    for (int r = 0; r < SEARCH_PATTERN_SIZE; r++)
+    {
+        int row = SEARCH_PATTERN_SIZE - r;
+        f((row <= SEARCH_PATTERN_SIZE - 2) ? row - 1 : row, SEARCH_PATTERN_SIZE, code_size - r - SEARCH_PATTERN_SIZE);
+    }
+}
+
+// Format information (correction level and mask), see Canvas::PlaceCorrectionMaskCode
+constexpr void PlaceCorrectionMaskCode(uint8_t* modules, size_t version, CorrectionLevel cl, size_t mask_id)
+{
+    const size_t code = CorrectionLevelMaskCode.at(cl)[mask_id];
+    const int size = SymbolSize(version);
+
+    ForEachFormatModule(version, [modules, size, code](int r, int c, int shift) {
+        modules[r * size + c] = MODULE_FUNCTION | static_cast<uint8_t>((code >> shift) & 1);
+    });
+    modules[(size - SEARCH_PATTERN_SIZE) * size + SEARCH_PATTERN_SIZE] = MODULE_FUNCTION | BLACK;
+}
+
+// Clears SymbolSize(version)^2 modules and places all function patterns. Format
+// information is placed with mask 0 to reserve its modules.
+constexpr void PlaceFunctionPatterns(uint8_t* modules, size_t version)
+{
+    const int size = SymbolSize(version);
+    for (int i = 0; i < size * size; i++)
+        modules[i] = 0;
+
+    detail::PlaceSearchPattern(modules, size, -1, -1);
+    detail::PlaceSearchPattern(modules, size, -1, size - SEARCH_PATTERN_SIZE);
+    detail::PlaceSearchPattern(modules, size, size - SEARCH_PATTERN_SIZE, -1);
+
+    if (version >= 2)
+        for (size_t p: LevelingPatterns[version - 1])
+            for (size_t q: LevelingPatterns[version - 1])
+                detail::PlaceLevelingPattern(modules, size, p, q);
+
+    constexpr int b = SEARCH_PATTERN_SIZE - 2;
+    for (int a = size - SEARCH_PATTERN_SIZE + 1; a > b; a--)
+    {
+        if (modules[a * size + b] == 0)
+            modules[a * size + b] = MODULE_FUNCTION | SyncModule(a);
+        if (modules[b * size + a] == 0)
+            modules[b * size + a] = MODULE_FUNCTION | SyncModule(a);
+    }
+
+    if (version >= 7)
+    {
+        const uint32_t code = VersionCode[version - 1];
+        const int start = size - SEARCH_PATTERN_SIZE - VERSION_CODE_ROWS;
+        for (int r = 0; r < VERSION_CODE_ROWS; r++)
+        {
+            for (int c = 0; c < VERSION_CODE_COLS; c++)
+            {
+                uint8_t bit = VersionCodeBit(code, r, c);
+                modules[(start + r) * size + c] = MODULE_FUNCTION | bit;
+                modules[c * size + start + r] = MODULE_FUNCTION | bit;
+            }
+        }
+    }
+
+    PlaceCorrectionMaskCode(modules, version, CorrectionLevel::L, MIN_MASK_ID);
+}
+
+// =============================================================================
+
+// Places interleaved codewords (see EncodeCodewords) into the non-function modules
+// in zigzag order, remainder modules are light
+constexpr void PlaceData(uint8_t* modules, size_t version, CorrectionLevel cl, const uint8_t* codewords)
+{
+    const int size = SymbolSize(version);
+    const Blocks blocks(version, cl);
+    const size_t n_bits = CodewordsCount(version) * BITS_PER_BYTE;
+
+    size_t bit = 0;
+    uint8_t byte = 0;
+    ForEachPlacementModule(version, [&](int r, int c)
+    {
+        uint8_t& module = modules[r * size + c];
+        if (module & MODULE_FUNCTION) return;
+
+        if (bit % BITS_PER_BYTE == 0 && bit < n_bits)
+            byte = blocks.Interleaved(codewords, bit / BITS_PER_BYTE);
+        module = (bit < n_bits) ? (byte >> (BITS_PER_BYTE - 1 - bit % BITS_PER_BYTE)) & 1 : 0;
+        bit++;
+    });
+}
+
+// XORs non-function modules with the mask, applying it twice removes it
+constexpr void ApplyMask(uint8_t* modules, size_t version, size_t mask_id)
+{
+    const size_t size = SymbolSize(version);
+    for (size_t r = 0; r < size; r++)
+        for (size_t c = 0; c < size; c++)
+            if (!(modules[r * size + c] & MODULE_FUNCTION))
+                modules[r * size + c] ^= MaskBit(mask_id, r, c);
+}
+
+// =============================================================================
+
+// Mask penalty rules over `lines` lines of `width` modules, value(line, i) is 0 or 1.
+// They are also the bodies of the penalty kernels, see Kernels.
+
+inline constexpr size_t SQUARE_PENALTY = 3;
+inline constexpr size_t PATTERN_PENALTY = 120;
+
+// Bars 5+ modules long. A run of length L >= 5 gives L - 2: one for every window
+// of 5 equal modules inside it plus 2 for the window which starts the run.
+template <typename V>
+constexpr size_t PenaltyRuns(V value, size_t width, size_t lines)
+{
+    constexpr size_t min_len = 5;
+    if (width < min_len) return 0;
+
+    size_t result = 0;
+    for (size_t l = 0; l < lines; l++)
+    {
+        uint8_t v0 = value(l, 0);
+        uint32_t windows = (value(l, 1) == v0) & (value(l, 2) == v0) & (value(l, 3) == v0) & (value(l, 4) == v0);
+        uint32_t starts = windows;
+        for (size_t i = 1; i + min_len <= width; i++)
+        {
+            uint8_t v = value(l, i);
+            uint32_t w = (value(l, i + 1) == v) & (value(l, i + 2) == v) & (value(l, i + 3) == v) & (value(l, i + 4) == v);
+            windows += w;
+            starts += w & (value(l, i - 1) != v);
+        }
+        result += windows + 2 * starts;
+    }
+    return result;
+}
+
+// 2x2 squares of the same color in pairs of adjacent lines
+template <typename V>
+constexpr size_t PenaltySquares(V value, size_t width, size_t lines)
+{
+    size_t result = 0;
+    for (size_t l = 0; l + 1 < lines; l++)
+    {
+        uint32_t count = 0;
+        for (size_t i = 0; i + 1 < width; i++)
+        {
+            uint8_t v = value(l, i);
+            count += (value(l, i + 1) == v) & (value(l + 1, i) == v) & (value(l + 1, i + 1) == v);
+        }
+        result += count;
+    }
+    return result;
+}
+
+// "# ### #" with at least 4 white modules before or after it. A match with white
+// modules after it is skipped together with them, a match with white modules
+// before it is skipped alone.
+template <typename V>
+constexpr size_t PenaltyFinders(V value, size_t width, size_t lines)
+{
+    constexpr size_t pat_len = 7;
+    constexpr size_t strip_len = 4;
+
+    size_t result = 0;
+    for (size_t l = 0; l < lines; l++)
+    {
+        auto is_white = [&value, l](size_t i) { return (value(l, i) | value(l, i + 1) | value(l, i + 2) | value(l, i + 3)) == 0; };
+        for (size_t i = 0; i + pat_len <= width;)
+        {
+            if (value(l, i) == 1 && value(l, i + 1) == 0 && value(l, i + 2) == 1 && value(l, i + 3) == 1 &&
+                value(l, i + 4) == 1 && value(l, i + 5) == 0 && value(l, i + 6) == 1)
+            {
+                bool has_before = i > strip_len && is_white(i - strip_len);
+                bool has_after = i + pat_len + strip_len <= width && is_white(i + pat_len);
+
+                if (has_before || has_after)
+                    result++;
+
+                i += has_after ? pat_len + strip_len : has_before ? pat_len : 1;
+            }
+            else
+                ++i;
+        }
+    }
+    return result;
+}
+
+// Deviation of dark modules from a half, 2 points per percent
+constexpr size_t BalancePenalty(size_t count_black, size_t count)
+{
+    float deviation = 100 * static_cast<float>(count_black) / count - 50;
+    return static_cast<size_t>(deviation < 0 ? -deviation : deviation) * 2;
+}
+
+// Penalty of the symbol, the same value as Canvas::Penalty
+constexpr size_t Penalty(const uint8_t* modules, size_t version)
+{
+    const size_t size = SymbolSize(version);
+    auto rows = [modules, size](size_t r, size_t c) { return static_cast<uint8_t>(modules[r * size + c] & MODULE_DARK); };
+    auto cols = [modules, size](size_t c, size_t r) { return static_cast<uint8_t>(modules[r * size + c] & MODULE_DARK); };
+
+    size_t result = PenaltyRuns(rows, size, size) + PenaltyRuns(cols, size, size);
+    result += SQUARE_PENALTY * PenaltySquares(rows, size, size);
+    result += PATTERN_PENALTY * (PenaltyFinders(rows, size, size) + PenaltyFinders(cols, size, size));
+
+    size_t count_black = 0;
+    for (size_t i = 0; i < size * size; i++)
+        count_black += modules[i] & MODULE_DARK;
+
+    return result + BalancePenalty(count_black, size * size);
+}
+
+// =============================================================================
+
+// Renders codewords from EncodeCodewords into SymbolSize(version)^2 modules with
+// given mask, or with the mask of the lowest penalty if mask_id < 0
+constexpr Status RenderModules(const uint8_t* codewords, size_t version, CorrectionLevel cl, int mask_id,
+                               uint8_t* modules, size_t capacity, size_t& chosen_mask)
+{
+    if (version < MIN_VERSION || version > MAX_VERSION || mask_id > static_cast<int>(MAX_MASK_ID))
+        return Status::INVALID_ARGUMENT;
+    if (capacity < SymbolSize(version) * SymbolSize(version))
+        return Status::BUFFER_TOO_SMALL;
+
+    PlaceFunctionPatterns(modules, version);
+    PlaceData(modules, version, cl, codewords);
+
+    chosen_mask = (mask_id < 0) ? MIN_MASK_ID : static_cast<size_t>(mask_id);
+    if (mask_id < 0)
+    {
+        size_t min_penalty = static_cast<size_t>(-1);
+        for (size_t m = MIN_MASK_ID; m <= MAX_MASK_ID; m++)
+        {
+            ApplyMask(modules, version, m);
+            PlaceCorrectionMaskCode(modules, version, cl, m);
+            size_t penalty = Penalty(modules, version);
+            ApplyMask(modules, version, m);
+
+            if (penalty < min_penalty)
+            {
+                min_penalty = penalty;
+                chosen_mask = m;
+            }
+        }
+    }
+
+    ApplyMask(modules, version, chosen_mask);
+    PlaceCorrectionMaskCode(modules, version, cl, chosen_mask);
+    return Status::OK;
+}
+
+// =============================================================================
+
+} // namespace myqro::core
+
+// =============================================================================
@@ -18,8 +18,6 @@ namespace myqro
 
 // =============================================================================
 
-constexpr size_t BITS_PER_BYTE = 8;
-
 class DataStream
 {
 private:
@@ -43,6 +41,7 @@ public:
     size_t Size() const { return bit_size_; }
     size_t ByteSize() const { return data_.size(); }
     uint8_t ByteAt(size_t idx) const { return data_.at(idx); }
+    const uint8_t* Data() const { return data_.data(); }
 
     std::vector<Block> GenerateBlocks(size_t count);
 
@@ -1,15 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <initializer_list>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include "utils.hpp"
-
 
 // =============================================================================
 
@@ -59,6 +58,10 @@ struct Block
 
 // =============================================================================
 
+inline constexpr size_t BITS_PER_BYTE = 8;
+
+// =============================================================================
+
 inline constexpr size_t MIN_VERSION = 1;
 inline constexpr size_t MAX_VERSION = 40;
 inline constexpr size_t VERSION_ARRAY_SIZE = MAX_VERSION - MIN_VERSION + 1;
@@ -80,7 +83,80 @@ inline constexpr uint8_t WHITE = 0;
 
 // =============================================================================
 
-inline const std::unordered_map<CorrectionLevel, std::array<size_t, VERSION_ARRAY_SIZE>> VersionCorrectionMaxDataSize{
+// Number of modules in a row of the symbol of given version
+constexpr size_t SymbolSize(size_t version) { return 21 + (version - 1) * 4; }
+
+// =============================================================================
+
+// Throws std::out_of_range, used by lookups of the constant tables below. It is not
+// constexpr, so a failed lookup during constant evaluation is a compile error.
+[[noreturn]] void ThrowOutOfRange(const char* what);
+
+// Up to N values stored inline, usable in constant expressions
+template <typename T, size_t N>
+struct FixedList
+{
+    std::array<T, N> values{};
+    size_t count = 0;
+
+    constexpr FixedList() = default;
+    constexpr FixedList(std::initializer_list<T> l) : count(l.size())
+    {
+        if (l.size() > N)
+            ThrowOutOfRange("FixedList: too many values");
+        std::copy(l.begin(), l.end(), values.begin());
+    }
+
+    constexpr const T* begin() const { return values.data(); }
+    constexpr const T* end() const { return values.data() + count; }
+    constexpr size_t size() const { return count; }
+    constexpr const T& operator[](size_t i) const { return values[i]; }
+};
+
+// Constant key-value table with the lookup interface of std::unordered_map (at, count,
+// iteration over pairs), but usable in constant expressions and without heap
+template <typename K, typename V, size_t N>
+struct ConstMap
+{
+    std::array<std::pair<K, V>, N> items{};
+
+    constexpr ConstMap() = default;
+    constexpr ConstMap(std::initializer_list<std::pair<K, V>> l)
+    {
+        if (l.size() != N)
+            ThrowOutOfRange("ConstMap: wrong number of items");
+        std::copy(l.begin(), l.end(), items.begin());
+    }
+
+    constexpr const V& at(const K& key) const
+    {
+        for (const auto& item: items)
+            if (item.first == key)
+                return item.second;
+        ThrowOutOfRange("ConstMap: no such key");
+    }
+
+    constexpr size_t count(const K& key) const
+    {
+        for (const auto& item: items)
+            if (item.first == key)
+                return 1;
+        return 0;
+    }
+
+    constexpr auto begin() const { return items.begin(); }
+    constexpr auto end() const { return items.end(); }
+    constexpr size_t size() const { return N; }
+};
+
+inline constexpr size_t CORRECTION_LEVELS_COUNT = 4;
+
+template <typename V>
+using CorrectionLevelMap = ConstMap<CorrectionLevel, V, CORRECTION_LEVELS_COUNT>;
+
+// =============================================================================
+
+inline constexpr CorrectionLevelMap<std::array<size_t, VERSION_ARRAY_SIZE>> VersionCorrectionMaxDataSize{
     {CorrectionLevel::L, {152, 272, 440, 640, 864, 1088, 1248, 1552, 1856, 2192, 2592, 2960, 3424, 3688, 4184, 4712, 5176, 5768, 6360, 6888, 7456, 8048, 8752, 9392, 10208, 10960, 11744, 12248, 13048, 13880, 14744, 15640, 16568, 17528, 18448, 19472, 20528, 21616, 22496, 23648}},
     {CorrectionLevel::M, {128, 224, 352, 512, 688,  864,  992, 1232, 1456, 1728, 2032, 2320, 2672, 2920, 3320, 3624, 4056, 4504, 5016, 5352, 5712, 6256, 6880, 7312,  8000,  8496,  9024,  9544, 10136, 10984, 11640, 12328, 13048, 13800, 14496, 15312, 15936, 16816, 17728, 18672}},
     {CorrectionLevel::Q, {104, 176, 272, 384, 496,  608,  704,  880, 1056, 1232, 1440, 1648, 1952, 2088, 2360, 2600, 2936, 3176, 3560, 3880, 4096, 4544, 4912, 5312,  5744,  6032,  6464,  6968,  7288,  7880,  8264,  8920,  9368,  9848, 10288, 10832, 11408, 12016, 12656, 13328}},
@@ -89,7 +165,8 @@ inline const std::unordered_map<CorrectionLevel, std::array<size_t, VERSION_ARRA
 
 // =============================================================================
 
-inline const std::unordered_map<EncodingType, std::unordered_map<size_t, size_t>> DataSizeFieldWidth{
+// Width of the data size field by the last version of a range of versions (9, 26, 40)
+inline constexpr ConstMap<EncodingType, ConstMap<size_t, size_t, 3>, 3> DataSizeFieldWidth{
     {EncodingType::NUNERIC,      {{9, 10}, {26, 12}, {MAX_VERSION, 14}}},
     {EncodingType::ALPHANUMERIC, {{9,  9}, {26, 11}, {MAX_VERSION, 13}}},
     {EncodingType::BYTES,        {{9,  8}, {26, 16}, {MAX_VERSION, 16}}},
@@ -97,21 +174,24 @@ inline const std::unordered_map<EncodingType, std::unordered_map<size_t, size_t>
 
 // =============================================================================
 
-inline const std::unordered_map<CorrectionLevel, std::array<size_t, VERSION_ARRAY_SIZE>> BlocksCount{
+inline constexpr CorrectionLevelMap<std::array<size_t, VERSION_ARRAY_SIZE>> BlocksCount{
     {CorrectionLevel::L, {1, 1, 1, 1, 1, 2, 2, 2, 2, 4,  4,  4,  4,  4,  6,  6,  6,  6,  7,  8,  8,  9,  9, 10, 12, 12, 12, 13, 14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25}},
     {CorrectionLevel::M, {1, 1, 1, 2, 2, 4, 4, 4, 5, 5,  5,  8,  9,  9, 10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25, 26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49}},
     {CorrectionLevel::Q, {1, 1, 2, 2, 4, 4, 6, 6, 8, 8,  8, 10, 12, 16, 12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34, 35, 38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68}},
     {CorrectionLevel::H, {1, 1, 2, 4, 4, 4, 5, 6, 8, 8, 11, 11, 16, 16, 18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40, 42, 45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}},
 };
 
-inline const std::unordered_map<CorrectionLevel, std::array<size_t, VERSION_ARRAY_SIZE>> CorrBlockBytes{
+inline constexpr CorrectionLevelMap<std::array<size_t, VERSION_ARRAY_SIZE>> CorrBlockBytes{
     {CorrectionLevel::L, { 7, 10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30, 22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}},
     {CorrectionLevel::M, {10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24, 24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28}},
     {CorrectionLevel::Q, {13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20, 30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}},
     {CorrectionLevel::H, {17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24, 24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}},
 };
 
-inline const std::unordered_map<size_t, std::vector<size_t>> GeneratingPolynomial{
+inline constexpr size_t MAX_CORRECTION_BYTES = 30;
+
+// Generating polynomials (exponents of alpha) by number of correction bytes
+inline constexpr ConstMap<size_t, FixedList<size_t, MAX_CORRECTION_BYTES>, 13> GeneratingPolynomial{
     {7,  { 87, 229, 146, 149, 238, 102,  21}},
     {10, {251,  67,  46,  61, 118,  70,  64,  94,  32,  45}},
     {13, { 74, 152, 176, 100,  86, 100, 106, 104, 130, 218, 206, 140,  78}},
@@ -128,7 +208,7 @@ inline const std::unordered_map<size_t, std::vector<size_t>> GeneratingPolynomia
 };
 
 // TODO: calculate at compile-time: https://habr.com/ru/articles/916740/
-inline const std::array<uint8_t, 256> GaloisField{
+inline constexpr std::array<uint8_t, 256> GaloisField{
     1,   2,   4,   8,  16,  32,  64, 128,  29,  58, 116, 232, 205, 135,  19,  38,
    76, 152,  45,  90, 180, 117, 234, 201, 143,   3,   6,  12,  24,  48,  96, 192,
   157,  39,  78, 156,  37,  74, 148,  53, 106, 212, 181, 119, 238, 193, 159,  35,
@@ -148,7 +228,7 @@ inline const std::array<uint8_t, 256> GaloisField{
 };
 
 // TODO: calculate at compile-time: https://habr.com/ru/articles/916740/
-inline const std::array<uint8_t, 256> ReverseGaloisField{
+inline constexpr std::array<uint8_t, 256> ReverseGaloisField{
     0,   0,   1,  25,   2,  50,  26, 198,   3, 223,  51, 238,  27, 104, 199,  75,
     4, 100, 224,  14,  52, 141, 239, 129,  28, 193, 105, 248, 200,   8,  76, 113,
     5, 138, 101,  47, 225,  36,  15,  33,  53, 147, 142, 218, 240,  18, 130,  69,
@@ -169,8 +249,13 @@ inline const std::array<uint8_t, 256> ReverseGaloisField{
 
 // =============================================================================
 
-inline const std::array<std::vector<size_t>, VERSION_ARRAY_SIZE> LevelingPatterns{
-    std::vector<size_t>{}, {18}, {22}, {26}, {30}, {34}, {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50},
+inline constexpr size_t MAX_LEVELING_CENTERS = 7;
+
+// Row/column coordinates of leveling pattern centers of one version
+using LevelingCenters = FixedList<size_t, MAX_LEVELING_CENTERS>;
+
+inline constexpr std::array<LevelingCenters, VERSION_ARRAY_SIZE> LevelingPatterns{
+    LevelingCenters{}, {18}, {22}, {26}, {30}, {34}, {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50},
     {6, 30, 54}, {6, 32, 58}, {6, 34, 62}, {6, 26, 46, 66}, {6, 26, 48, 70}, {6, 26, 50, 74},
     {6, 30, 54, 78}, {6, 30, 56, 82}, {6, 30, 58, 86}, {6, 34, 62, 90}, {6, 28, 50, 72, 94},
     {6, 26, 50, 74, 98}, {6, 30, 54, 78, 102}, {6, 28, 54, 80, 106}, {6, 32, 58, 84, 110},
@@ -181,7 +266,7 @@ inline const std::array<std::vector<size_t>, VERSION_ARRAY_SIZE> LevelingPattern
     {6, 26, 54, 82, 110, 138, 166}, {6, 30, 58, 86, 114, 142, 170},
 };
 
-inline const std::array<uint32_t, VERSION_ARRAY_SIZE> VersionCode{
+inline constexpr std::array<uint32_t, VERSION_ARRAY_SIZE> VersionCode{
     0, 0, 0, 0, 0, 0,
     0b000010011110100110, 0b010001011100111000, 0b110111011000000100, 0b101001111110000000,
     0b001111111010111100, 0b001101100100011010, 0b101011100000100110, 0b110101000110100010,
@@ -197,18 +282,18 @@ inline const std::array<uint32_t, VERSION_ARRAY_SIZE> VersionCode{
 
 // =============================================================================
 
-inline const std::array<std::function<uint8_t(size_t, size_t)>, MASK_ARRAY_SIZE> MaskFunctions{
-    [](size_t X, size_t Y) { return (X+Y) % 2; },
-    [](size_t X, size_t Y) { UNUSED(X); return Y % 2; },
-    [](size_t X, size_t Y) { UNUSED(Y); return X % 3; },
-    [](size_t X, size_t Y) { return (X + Y) % 3; },
-    [](size_t X, size_t Y) { return (X/3 + Y/2) % 2; },
-    [](size_t X, size_t Y) { return (X*Y) % 2 + (X*Y) % 3; },
-    [](size_t X, size_t Y) { return ((X*Y) % 2 + (X*Y) % 3) % 2; },
-    [](size_t X, size_t Y) { return ((X*Y) % 3 + (X+Y) % 2) % 2; },
+inline constexpr std::array<uint8_t (*)(size_t, size_t), MASK_ARRAY_SIZE> MaskFunctions{
+    [](size_t X, size_t Y) -> uint8_t { return (X+Y) % 2; },
+    [](size_t, size_t Y) -> uint8_t { return Y % 2; },
+    [](size_t X, size_t) -> uint8_t { return X % 3; },
+    [](size_t X, size_t Y) -> uint8_t { return (X + Y) % 3; },
+    [](size_t X, size_t Y) -> uint8_t { return (X/3 + Y/2) % 2; },
+    [](size_t X, size_t Y) -> uint8_t { return (X*Y) % 2 + (X*Y) % 3; },
+    [](size_t X, size_t Y) -> uint8_t { return ((X*Y) % 2 + (X*Y) % 3) % 2; },
+    [](size_t X, size_t Y) -> uint8_t { return ((X*Y) % 3 + (X+Y) % 2) % 2; },
 };
 
-inline const std::unordered_map<CorrectionLevel, std::array<size_t, MASK_ARRAY_SIZE>> CorrectionLevelMaskCode{
+inline constexpr CorrectionLevelMap<std::array<size_t, MASK_ARRAY_SIZE>> CorrectionLevelMaskCode{
     {CorrectionLevel::L, {0b111011111000100, 0b111001011110011, 0b111110110101010, 0b111100010011101,
                           0b110011000101111, 0b110001100011000, 0b110110001000001, 0b110100101110110}},
     {CorrectionLevel::M, {0b101010000010010, 0b101000100100101, 0b101111001111100, 0b101101101001011,
@@ -219,6 +304,12 @@ inline const std::unordered_map<CorrectionLevel, std::array<size_t, MASK_ARRAY_S
                           0b000011101100010, 0b000001001010101, 0b000110100001100, 0b000100000111011}},
 };
 
+// 1 if mask inverts data module at (row, col), 0 otherwise
+constexpr uint8_t MaskBit(size_t mask_id, size_t row, size_t col)
+{
+    return MaskFunctions[mask_id](col, row) == 0;
+}
+
 // =============================================================================
 
 } // namespace myqro
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Checksums can be computed incrementally: pass the result of the previous call
+uint32_t Crc32(std::span<const uint8_t> data, uint32_t crc = 0);
+uint32_t Adler32(std::span<const uint8_t> data, uint32_t adler = 1);
+
+// =============================================================================
+
+enum class DeflateFormat
+{
+    RAW,        // RFC 1951 stream only
+    ZLIB,       // RFC 1950, used by PNG and PDF
+    GZIP,       // RFC 1952
+};
+
+// Streaming deflate compressor. Uses fixed Huffman codes and greedy LZ77 matching
+// over a 32K window, which suits QR rasters: long runs of equal bytes and rows
+// repeated `scale` times compress to a few matches. Level 0 writes stored blocks,
+// levels 1-9 search longer hash chains.
+class Deflater
+{
+public:
+    static constexpr int DEFAULT_LEVEL = 6;
+
+    Deflater(DeflateFormat format = DeflateFormat::ZLIB, int level = DEFAULT_LEVEL);
+
+    // Compressed bytes are appended to Output() as soon as they are ready
+    void Write(std::span<const uint8_t> data);
+    void Finish();
+
+    std::vector<uint8_t>& Output() { return output_; }
+
+    // Compresses the data in one call
+    static std::vector<uint8_t> Compress(std::span<const uint8_t> data, DeflateFormat format = DeflateFormat::ZLIB,
+                                         int level = DEFAULT_LEVEL);
+
+private:
+    void WriteHeader();
+    void WriteTrailer();
+
+    void Deflate(bool finish);
+    void Store(bool finish);
+
+    void Insert(size_t pos);
+    size_t LongestMatch(size_t pos, size_t end, size_t& distance) const;
+
+    void PutBits(uint32_t value, int count);
+    void PutCode(uint32_t code, int length);
+    void AlignToByte();
+    void Symbol(uint32_t symbol);
+    void Literal(uint8_t byte);
+    void Match(size_t length, size_t distance);
+
+    uint8_t At(size_t pos) const { return window_[pos - base_]; }
+
+private:
+    DeflateFormat format_;
+    int level_;
+    size_t max_chain_;
+    bool finished_;
+
+    uint32_t crc_;
+    uint32_t adler_;
+    uint32_t input_size_;
+
+    std::vector<uint8_t> window_;       // history and pending input, window_[0] is at position base_
+    size_t base_;
+    size_t pos_;                        // next position to compress
+    std::vector<size_t> head_;          // last position + 1 of every hash
+    std::vector<size_t> prev_;          // previous position + 1 with the same hash
+
+    uint64_t bits_;
+    int n_bits_;
+    std::vector<uint8_t> output_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
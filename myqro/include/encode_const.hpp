@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "canvas.hpp"
+#include "core.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// String literal usable as a template argument
+template <size_t N>
+struct FixedString
+{
+    char data[N] {};
+
+    constexpr FixedString(const char (&s)[N]) { std::copy_n(s, N, data); }
+    constexpr size_t size() const { return N - 1; }
+};
+
+// =============================================================================
+
+// Symbol encoded at compile time: modules packed row by row, 8 per byte MSB first
+template <size_t V>
+struct ConstSymbol
+{
+    static constexpr size_t VERSION = V;
+    static constexpr size_t SIZE = SymbolSize(V);
+    static constexpr size_t STRIDE = (SIZE + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+
+    std::array<uint8_t, SIZE * STRIDE> rows{};
+    size_t mask_id = 0;
+
+    constexpr uint8_t At(size_t row, size_t col) const
+    {
+        return (rows[row * STRIDE + col / BITS_PER_BYTE] >> (BITS_PER_BYTE - 1 - col % BITS_PER_BYTE)) & 1;
+    }
+
+    // Canvas with the same module values (kinds of modules are not kept), e.g. for outputters
+    Canvas ToCanvas() const
+    {
+        Canvas canvas(VERSION);
+        for (size_t row = 0; row < SIZE; row++)
+            for (size_t col = 0; col < SIZE; col++)
+                canvas.At(row, col).value = At(row, col);
+        return canvas;
+    }
+};
+
+// =============================================================================
+
+template <FixedString Text, CorrectionLevel CL, EncodingType Encoding>
+consteval core::Layout ConstLayout()
+{
+    core::Layout layout;
+    core::ChooseLayout(core::PayloadBits(Text.size(), Encoding), Encoding, CL, layout);
+    return layout;
+}
+
+// Encodes the text at compile time, e.g.
+//     constexpr auto symbol = EncodeConst<"https://example.com", CorrectionLevel::M>();
+// The best mask is chosen if MaskId < 0. Unsupported or too long text is a compile error.
+template <FixedString Text, CorrectionLevel CL = CorrectionLevel::M,
+          EncodingType Encoding = EncodingType::BYTES, int MaskId = -1>
+consteval auto EncodeConst()
+{
+    static_assert(core::IsDataSupported(Text.data, Text.size(), Encoding), "Text is not supported by the encoding");
+    static_assert(MaskId <= static_cast<int>(MAX_MASK_ID), "No such mask_id");
+
+    constexpr core::Layout layout = ConstLayout<Text, CL, Encoding>();
+    static_assert(layout.version != 0, "Text is too big for the correction level");
+
+    constexpr size_t V = layout.version;
+    constexpr size_t size = SymbolSize(V);
+
+    std::array<uint8_t, core::CodewordsCount(V)> codewords{};
+    std::array<uint8_t, size * size> modules{};
+    size_t version = 0;
+    size_t mask_id = 0;
+    core::EncodeCodewords(Text.data, Text.size(), Encoding, CL, codewords.data(), codewords.size(), version);
+    core::RenderModules(codewords.data(), V, CL, MaskId, modules.data(), modules.size(), mask_id);
+
+    ConstSymbol<V> symbol;
+    symbol.mask_id = mask_id;
+    for (size_t row = 0; row < size; row++)
+    {
+        for (size_t col = 0; col < size; col++)
+        {
+            uint8_t bit = modules[row * size + col] & core::MODULE_DARK;
+            symbol.rows[row * symbol.STRIDE + col / BITS_PER_BYTE] |= bit << (BITS_PER_BYTE - 1 - col % BITS_PER_BYTE);
+        }
+    }
+    return symbol;
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -2,8 +2,6 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
 
 #include "context.hpp"
 
@@ -23,7 +21,12 @@ public:
     virtual const char* GetProviderName() const = 0;
     virtual EncodingType GetEncodingType() const = 0;
 
-    Context Encode(const std::string& data, CorrectionLevel cl = CorrectionLevel::M) const;
+    Context Encode(const std::string& data, CorrectionLevel cl = CorrectionLevel::M,
+                   const EncodeOptions& options = EncodeOptions()) const;
+
+    // Data codewords only: everything Encode does before correction blocks are generated
+    Context PrepareData(const std::string& data, CorrectionLevel cl = CorrectionLevel::M,
+                        const EncodeOptions& options = EncodeOptions()) const;
 
     virtual bool IsDataSupported(const std::string& data) const = 0;
     virtual void ConvertInput(const std::string& data, Context& context) const = 0;
@@ -32,9 +35,6 @@ public:
     void AddRequiredVersionTailBytes(Context& context) const;
     void PrepareBlocks(Context& context) const;
     void PrepareOutput(Context& context) const;
-
-private:
-    static std::pair<size_t, size_t> EstimateVersion(const DataStream& stream, CorrectionLevel cl);
 };
 
 using EncodeProviderPtr = std::unique_ptr<EncodeProvider>;
@@ -50,9 +50,6 @@ public:
     EncodingType GetEncodingType() const final { return EncodingType::NUNERIC; }
 
     void ConvertInput(const std::string& data, Context& context) const final;
-
-private:
-    static const std::unordered_set<char> digits_;
 };
 
 // =============================================================================
@@ -66,9 +63,6 @@ public:
     EncodingType GetEncodingType() const final { return EncodingType::ALPHANUMERIC; }
 
     void ConvertInput(const std::string& data, Context& context) const final;
-
-private:
-    static const std::unordered_map<char, uint8_t> chars_;
 };
 
 // =============================================================================
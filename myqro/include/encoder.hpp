@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "canvas.hpp"
 #include "encode_provider.hpp"
 
@@ -15,10 +17,16 @@ class Encoder
 {
 public:
     static Canvas Encode(const std::string& msg, CorrectionLevel cl = CorrectionLevel::M,
-                         EncodingType encoding = EncodingType::BYTES, int mask_id = 0);
+                         EncodingType encoding = EncodingType::BYTES, int mask_id = 0,
+                         const EncodeOptions& options = EncodeOptions());
+
+    // Canvas of given version with all function patterns placed
+    static Canvas CreateCanvas(size_t version);
 
-private:
-    static Canvas FindBestMask(Canvas& c, const Context& ctx);
+    // Calls trial(mask_id) for every mask (concurrently for large versions) and
+    // returns the mask with the lowest penalty reported by the trial
+    static size_t ChooseMask(size_t version, const EncodeOptions& options,
+                             const std::function<size_t(size_t)>& trial);
 };
 
 // =============================================================================
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "canvas.hpp"
+#include "context.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Canvas of one version known at compile time: cells are stored in std::array
+// without a heap allocation, size, leveling pattern centers and version code are
+// constants and the data placement order is computed once per version. Penalty
+// scans go through the same runtime-sized kernels as Canvas. Function patterns
+// are placed on construction.
+template <size_t V>
+class FixedCanvas : public CanvasBase<FixedCanvas<V>>
+{
+    static_assert(V >= MIN_VERSION && V <= MAX_VERSION, "No such version");
+
+public:
+    static constexpr size_t VERSION = V;
+    static constexpr size_t SIZE = SymbolSize(V);
+
+    FixedCanvas()
+    {
+        this->SetupSearchPatterns();
+        this->SetupLevelingPatterns();
+        this->SetupSyncLines();
+        this->SetupVersionCode();
+    }
+
+    static constexpr size_t Version() { return VERSION; }
+    static constexpr size_t Size() { return SIZE; }
+
+    std::span<Cell, SIZE * SIZE> Cells() { return cells_; }
+    std::span<const Cell, SIZE * SIZE> Cells() const { return cells_; }
+
+    Canvas ToCanvas() const { return Canvas(VERSION, cells_); }
+
+private:
+    friend class CanvasBase<FixedCanvas<V>>;
+
+    static constexpr LevelingCenters LEVELING = LevelingPatterns[V - 1];
+    static constexpr uint32_t VERSION_BITS = VersionCode[V - 1];
+
+    static constexpr const LevelingCenters& Leveling() { return LEVELING; }
+    static constexpr uint32_t VersionBits() { return VERSION_BITS; }
+
+    // Placement order depends on the version only, so it is computed once
+    static const std::vector<size_t>& DataOrder()
+    {
+        static const std::vector<size_t> order = []()
+        {
+            auto canvas = std::make_unique<FixedCanvas>();
+            canvas->PlaceCorrectionMaskCode(CorrectionLevel::L, MIN_MASK_ID);
+            return canvas->ModulesOrder(Pattern::UNKNOWN);
+        }();
+        return order;
+    }
+
+    static std::array<uint8_t, SIZE * SIZE> Plane() { return {}; }
+
+private:
+    std::array<Cell, SIZE * SIZE> cells_;
+};
+
+// =============================================================================
+
+// Canvas of runtime version with function patterns placed, built by FixedCanvas
+// of that version
+Canvas CreateFixedCanvas(size_t version);
+
+// Places the stream with given mask (or the best one if mask_id < 0) on the canvas
+// of given version. Routed through a table of FixedCanvas specializations.
+Canvas EncodeFixedCanvas(size_t version, CorrectionLevel cl, int mask_id, const DataStream& stream,
+                         const EncodeOptions& options);
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "core.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Encoding API of myqro_freestanding library (also available in the regular one):
+// no heap, no exceptions, everything is written to buffers provided by the caller
+// and errors are returned as core::Status.
+
+// Buffers for symbols of versions up to MaxVersion
+template <size_t MaxVersion>
+struct SymbolBuffers
+{
+    static_assert(MaxVersion >= MIN_VERSION && MaxVersion <= MAX_VERSION, "No such version");
+
+    std::array<uint8_t, core::CodewordsCount(MaxVersion)> codewords;
+    std::array<uint8_t, SymbolSize(MaxVersion) * SymbolSize(MaxVersion)> modules;
+};
+
+// Encoded symbol, modules live in the caller's buffer
+struct SymbolRef
+{
+    size_t version = 0;
+    size_t size = 0;
+    size_t mask_id = 0;
+    const uint8_t* modules = nullptr;
+
+    uint8_t At(size_t row, size_t col) const { return modules[row * size + col] & core::MODULE_DARK; }
+};
+
+// =============================================================================
+
+// Encodes data with given mask (or the best one if mask_id < 0). Returns
+// BUFFER_TOO_SMALL if the data needs a version larger than the buffers allow.
+core::Status EncodeInto(const char* data, size_t length, CorrectionLevel cl, EncodingType encoding, int mask_id,
+                        std::span<uint8_t> codewords, std::span<uint8_t> modules, SymbolRef& symbol);
+
+template <size_t MaxVersion>
+core::Status EncodeInto(const char* data, size_t length, CorrectionLevel cl, EncodingType encoding, int mask_id,
+                        SymbolBuffers<MaxVersion>& buffers, SymbolRef& symbol)
+{
+    return EncodeInto(data, length, cl, encoding, mask_id, buffers.codewords, buffers.modules, symbol);
+}
+
+// Packs modules into rows of `stride` bytes, 8 modules per byte MSB first, dark
+// modules are 1. Bits past the end of a row are 0.
+core::Status PackRows(const SymbolRef& symbol, std::span<uint8_t> out, size_t stride);
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
-#include <format>
-#include <fstream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "error.hpp"
 #include "canvas.hpp"
+#include "deflate.hpp"
+#include "sink.hpp"
+#include "symbol_view.hpp"
 
 
 // =============================================================================
@@ -30,112 +39,514 @@ struct OutputOptions
 
 // =============================================================================
 
+class RowSink;
+
 class Outputter
 {
 public:
     Outputter() {}
+    Outputter(std::unique_ptr<ByteSink> sink) : sink_(std::move(sink)) {}
     virtual ~Outputter() {}
 
+    // Writes into the sink given in the constructor
     void Output(const Canvas& canvas, const OutputOptions& options = OutputOptions())
     {
-        OutputImpl(canvas, options);
+        Output(CanvasRows(canvas), options);
+    }
+
+    void Output(const SymbolRows& symbol, const OutputOptions& options = OutputOptions())
+    {
+        Output(symbol, options, OwnSink());
+    }
+
+    void Output(const Canvas& canvas, const OutputOptions& options, ByteSink& sink)
+    {
+        Output(CanvasRows(canvas), options, sink);
+    }
+
+    void Output(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+    {
+        OutputImpl(symbol, options, sink);
+        sink.Flush();
+    }
+
+    // Exact number of bytes Output writes, e.g. to allocate a buffer for SpanSink
+    size_t OutputSize(const SymbolRows& symbol, const OutputOptions& options = OutputOptions())
+    {
+        CountingSink sink;
+        OutputImpl(symbol, options, sink);
+        return sink.Size();
     }
 
+    // Raster formats are written from the rows of RenderRows: returns the row
+    // sink writing this format into the sink, nullptr for other formats
+    std::unique_ptr<RowSink> OpenRows(ByteSink& sink);
+
+    // Writes the symbol with every outputter into its own sink. Raster formats
+    // share one RenderRows pass, the others read the symbol on their own.
+    static void OutputAll(const SymbolRows& symbol, const OutputOptions& options,
+                          std::span<Outputter* const> outputters);
+
+    static void OutputAll(const Canvas& canvas, const OutputOptions& options,
+                          std::span<Outputter* const> outputters)
+    {
+        OutputAll(CanvasRows(canvas), options, outputters);
+    }
+
+protected:
+    ByteSink& OwnSink()
+    {
+        if (!sink_)
+            throw Error("Outputter has no sink of its own, pass one to Output");
+        return *sink_;
+    }
+
+private:
+    // Symbol is read row by row, so outputters need memory for one row only
+    virtual void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) = 0;
+
+    virtual std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink);
+
 private:
-    virtual void OutputImpl(const Canvas& canvas, const OutputOptions& options) = 0;
+    std::unique_ptr<ByteSink> sink_;
 };
 
 // =============================================================================
 
+// Writes into the file when constructed with a path, into the sinks passed to
+// Output otherwise
 class FileOutputter : public Outputter
 {
 public:
+    FileOutputter() {}
     FileOutputter(const std::filesystem::path& path) :
-        Outputter(),
-        path_(path),
-        stream_(path)
-    {
-        if (!stream_.is_open())
-            throw Error(std::format("Error opening file {}", path_.string()));
-    }
-
-    virtual ~FileOutputter()
-    {
-        if (stream_.is_open()) stream_.close();
-    }
+        Outputter(std::make_unique<FileSink>(path)),
+        path_(path)
+    {}
 
-    std::ofstream& Stream() { return stream_; }
     const std::filesystem::path& Path() const { return path_; }
 
 private:
     std::filesystem::path path_;
-    std::ofstream stream_;
 };
 
 // =============================================================================
 
+enum class ConsoleStyle
+{
+    ASCII,          // one character per pixel, `#` is dark
+    HALF_BLOCKS,    // two pixel rows per line drawn with Unicode half blocks
+};
+
+// The whole symbol is built in one buffer and written once. Inverse mode wraps
+// every line into ANSI inverse video, so dark modules get the terminal background
+// color, which is what terminals with light text on dark background need.
 class ConsoleOutputter : public Outputter
 {
 public:
-    ConsoleOutputter(std::ostream& os) :
-        Outputter(),
-        stream_(os)
+    ConsoleOutputter(ConsoleStyle style = ConsoleStyle::ASCII, bool inverse = false) :
+        style_(style),
+        inverse_(inverse)
+    {}
+
+    ConsoleOutputter(std::ostream& os, ConsoleStyle style = ConsoleStyle::ASCII, bool inverse = false) :
+        Outputter(std::make_unique<StreamSink>(os)),
+        style_(style),
+        inverse_(inverse)
     {}
 
-    void OutputImpl(const Canvas& canvas, const OutputOptions& options) final;
 private:
-    std::ostream& stream_;
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+
+private:
+    ConsoleStyle style_;
+    bool inverse_;
 };
 
 // =============================================================================
 
 class ImprintOutputter : public Outputter
 {
-    public:
+public:
+    ImprintOutputter() {}
     ImprintOutputter(std::ostream& os) :
-        Outputter(),
-        stream_(os)
+        Outputter(std::make_unique<StreamSink>(os))
     {}
 
-    void OutputImpl(const Canvas& canvas, const OutputOptions& options) final;
 private:
-    std::ostream& stream_;
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
 };
 
 // =============================================================================
 
+enum class PbmFormat
+{
+    ASCII,      // P1, one character per pixel
+    BINARY,     // P4, rows packed 8 pixels per byte
+};
+
 class PBMOutputter : public FileOutputter
 {
 public:
-    PBMOutputter(const std::filesystem::path& path) :
-        FileOutputter(path)
+    PBMOutputter(PbmFormat format = PbmFormat::BINARY) :
+        format_(format)
+    {}
+
+    PBMOutputter(const std::filesystem::path& path, PbmFormat format = PbmFormat::BINARY) :
+        FileOutputter(path),
+        format_(format)
     {}
 
-    void OutputImpl(const Canvas& canvas, const OutputOptions& options) final;
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+    std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink) final;
+
+    // Every module row is expanded once and written as a band of `scale` equal rows
+    void OutputAscii(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink);
+    void OutputBinary(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink);
+
+private:
+    PbmFormat format_;
 };
 
 // =============================================================================
 
+enum class MappedFormat
+{
+    PBM,        // binary P4
+    BMP,        // 1-bit BMP, rows bottom-up and padded to 4 bytes
+};
+
+// Raster formats of fixed layout written straight into a preallocated, memory
+// mapped file whose bands of rows are filled in parallel, see RenderBands. Meant
+// for poster scales, where files take hundreds of megabytes. Every Output
+// replaces the file.
+class MappedOutputter
+{
+public:
+    MappedOutputter(const std::filesystem::path& path, MappedFormat format = MappedFormat::PBM) :
+        path_(path),
+        format_(format)
+    {}
+
+    void Output(const Canvas& canvas, const OutputOptions& options = OutputOptions())
+    {
+        Output(CanvasRows(canvas), options);
+    }
+
+    void Output(const SymbolRows& symbol, const OutputOptions& options = OutputOptions());
+
+    const std::filesystem::path& Path() const { return path_; }
+
+private:
+    static constexpr uint32_t BMP_HEADER_SIZE = 14 + 40 + 2 * 4;   // file and info headers, palette
+    static constexpr uint32_t BMP_PIXELS_PER_METER = 2835;         // 72 dpi
+
+private:
+    std::filesystem::path path_;
+    MappedFormat format_;
+};
+
+// =============================================================================
+
+// 1-bit grayscale PNG compressed with the built-in Deflater, see PngRowSink
+class PngOutputter : public FileOutputter
+{
+public:
+    PngOutputter(int level = Deflater::DEFAULT_LEVEL) :
+        level_(level)
+    {}
+
+    PngOutputter(const std::filesystem::path& path, int level = Deflater::DEFAULT_LEVEL) :
+        FileOutputter(path),
+        level_(level)
+    {}
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+    std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink) final;
+
+private:
+    int level_;
+};
+
+// =============================================================================
+
+// Bilevel TIFF compressed with CCITT Group 4, see TiffG4RowSink. OutputPages
+// writes a batch of codes as one multi-page file.
+class TiffG4Outputter : public FileOutputter
+{
+public:
+    static constexpr uint32_t DEFAULT_DPI = 300;
+
+    TiffG4Outputter(uint32_t dpi = DEFAULT_DPI) :
+        dpi_(dpi)
+    {}
+
+    TiffG4Outputter(const std::filesystem::path& path, uint32_t dpi = DEFAULT_DPI) :
+        FileOutputter(path),
+        dpi_(dpi)
+    {}
+
+    void OutputPages(std::span<const Canvas> canvases, const OutputOptions& options = OutputOptions())
+    {
+        OutputPages(canvases, options, OwnSink());
+    }
+
+    void OutputPages(std::span<const Canvas> canvases, const OutputOptions& options, ByteSink& sink);
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+    std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink) final;
+
+private:
+    uint32_t dpi_;
+};
+
+// =============================================================================
+
+// Raw ESC/POS raster commands for receipt and label printers, see EscPosRowSink
+class EscPosOutputter : public FileOutputter
+{
+public:
+    static constexpr size_t DEFAULT_BAND_ROWS = 128;
+
+    EscPosOutputter(size_t band_rows = DEFAULT_BAND_ROWS) :
+        band_rows_(band_rows)
+    {}
+
+    EscPosOutputter(const std::filesystem::path& path, size_t band_rows = DEFAULT_BAND_ROWS) :
+        FileOutputter(path),
+        band_rows_(band_rows)
+    {}
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+    std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink) final;
+
+private:
+    size_t band_rows_;
+};
+
+// =============================================================================
+
+// ZPL label for Zebra printers, see ZplRowSink
+class ZplOutputter : public FileOutputter
+{
+public:
+    static constexpr size_t DEFAULT_BAND_ROWS = 128;
+
+    ZplOutputter(size_t band_rows = DEFAULT_BAND_ROWS) :
+        band_rows_(band_rows)
+    {}
+
+    ZplOutputter(const std::filesystem::path& path, size_t band_rows = DEFAULT_BAND_ROWS) :
+        FileOutputter(path),
+        band_rows_(band_rows)
+    {}
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+    std::unique_ptr<RowSink> OpenRowsImpl(ByteSink& sink) final;
+
+private:
+    size_t band_rows_;
+};
+
+// =============================================================================
+
+enum class SvgShapes
+{
+    RUNS,           // horizontal runs of dark modules
+    RECTANGLES,     // runs of equal rows merged into rectangles
+};
+
 class SvgOutputter : public FileOutputter
 {
 public:
-    SvgOutputter(const std::filesystem::path& path) :
-        FileOutputter(path)
+    SvgOutputter(SvgShapes shapes = SvgShapes::RUNS) :
+        shapes_(shapes)
+    {}
+
+    SvgOutputter(const std::filesystem::path& path, SvgShapes shapes = SvgShapes::RUNS) :
+        FileOutputter(path),
+        shapes_(shapes)
+    {}
+
+    // The whole document, written with a single write
+    std::string Render(const SymbolRows& symbol, const OutputOptions& options) const;
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+
+private:
+    SvgShapes shapes_;
+};
+
+// Gzip-compressed SVG (.svgz). The document is compressed while it is generated,
+// compressed bytes reach the sink in chunks.
+class SvgzOutputter : public FileOutputter
+{
+public:
+    SvgzOutputter(SvgShapes shapes = SvgShapes::RUNS, int level = Deflater::DEFAULT_LEVEL) :
+        shapes_(shapes),
+        level_(level)
     {}
 
-    void OutputImpl(const Canvas& canvas, const OutputOptions& options) final;
+    SvgzOutputter(const std::filesystem::path& path, SvgShapes shapes = SvgShapes::RUNS,
+                  int level = Deflater::DEFAULT_LEVEL) :
+        FileOutputter(path),
+        shapes_(shapes),
+        level_(level)
+    {}
+
+private:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+
+private:
+    SvgShapes shapes_;
+    int level_;
 };
 
 // =============================================================================
 
+enum class EpsFormat
+{
+    HEX,            // 1-bit imagemask, ASCIIHex encoded rows
+    ASCII85,        // 1-bit imagemask, ASCII85 encoded rows
+    RECTFILL,       // one rectfill per horizontal run of dark modules
+};
+
+// Module is `scale` points wide, the whole document is written with a single write
 class EpsOutputter : public FileOutputter
 {
 public:
-    EpsOutputter(const std::filesystem::path& path) :
-        FileOutputter(path)
+    EpsOutputter(EpsFormat format = EpsFormat::ASCII85) :
+        format_(format)
     {}
 
-    void OutputImpl(const Canvas& canvas, const OutputOptions& options) final;
+    EpsOutputter(const std::filesystem::path& path, EpsFormat format = EpsFormat::ASCII85) :
+        FileOutputter(path),
+        format_(format)
+    {}
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+
+private:
+    EpsFormat format_;
+};
+
+// =============================================================================
+
+enum class PdfShapes
+{
+    PATH,       // filled path of run-merged rectangles
+    IMAGE,      // 1-bit image mask with one sample per module, scaled on the page
+};
+
+// Grid of codes on every page, sizes are in points
+struct PdfLayout
+{
+    size_t columns = 1;
+    size_t rows = 1;
+
+    int cell = 0;       // 0 takes the size of the first code, quiet zone included
+    int margin = 0;     // around the grid
+    int spacing = 0;    // between cells
+};
+
+// Streaming PDF writer. Codes fill the pages left to right and top to bottom, a
+// module is `scale` points wide. The compressed content stream of the current page
+// goes to the sink as codes are added, its length, image masks and page object
+// follow when the page is full. The page tree, catalog and cross-reference table
+// are written by Close.
+class PdfWriter
+{
+public:
+    PdfWriter(ByteSink& out, const OutputOptions& options, PdfShapes shapes = PdfShapes::PATH,
+              const PdfLayout& layout = PdfLayout(), int level = Deflater::DEFAULT_LEVEL);
+
+    void Add(const SymbolRows& symbol);
+    void Close();
+
+    size_t Pages() const { return pages_.size() + (on_page_ > 0); }
+
+private:
+    // Objects written before the pages, the catalog and page tree are written last
+    static constexpr size_t CATALOG = 1;
+    static constexpr size_t PAGE_TREE = 2;
+    static constexpr size_t PROC_SET = 3;
+
+    struct Image
+    {
+        size_t size;                // modules
+        std::vector<uint8_t> data;  // compressed packed rows
+    };
+
+    void BeginPage();
+    void EndPage();
+    void WriteContent();
+
+    size_t Reserve();
+    void BeginObject(size_t number);
+    void Write(std::string_view text);
+    void Write(std::span<const uint8_t> data);
+
+private:
+    ByteSink& out_;
+    OutputOptions options_;
+    PdfShapes shapes_;
+    PdfLayout layout_;
+    int level_;
+
+    uint64_t position_;
+    std::vector<uint64_t> offsets_;     // of object n at n - 1
+    std::vector<size_t> pages_;         // object numbers of written pages
+    bool closed_;
+
+    int cell_;
+    int page_width_;
+    int page_height_;
+
+    size_t on_page_;                    // codes on the current page
+    std::optional<Deflater> content_;
+    size_t content_object_;
+    size_t content_size_;
+    std::vector<Image> images_;
+};
+
+// Single code on one page with Output, a batch of codes with OutputPages
+class PdfOutputter : public FileOutputter
+{
+public:
+    PdfOutputter(PdfShapes shapes = PdfShapes::PATH, const PdfLayout& layout = PdfLayout()) :
+        shapes_(shapes),
+        layout_(layout)
+    {}
+
+    PdfOutputter(const std::filesystem::path& path, PdfShapes shapes = PdfShapes::PATH,
+                 const PdfLayout& layout = PdfLayout()) :
+        FileOutputter(path),
+        shapes_(shapes),
+        layout_(layout)
+    {}
+
+    void OutputPages(std::span<const Canvas> canvases, const OutputOptions& options = OutputOptions())
+    {
+        OutputPages(canvases, options, OwnSink());
+    }
+
+    void OutputPages(std::span<const Canvas> canvases, const OutputOptions& options, ByteSink& sink);
+
+private:
+    void OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink) final;
+
+private:
+    PdfShapes shapes_;
+    PdfLayout layout_;
 };
 
 // =============================================================================
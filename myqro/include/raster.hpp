@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "outputter.hpp"
+#include "symbol_view.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Pixel rows of a symbol scaled by options.scale and padded with the quiet zone,
+// shared by raster outputters. Rows are packed 8 pixels per byte, first pixel in
+// the most significant bit, dark pixels are 1. A module row is expanded once by
+// the expand_bits kernel and returned for all `scale` pixel rows it covers.
+class Raster
+{
+public:
+    Raster(const SymbolRows& symbol, const OutputOptions& options);
+
+    // Width and height in pixels
+    size_t Size() const { return size_; }
+
+    // Bytes of one pixel row
+    size_t Stride() const { return stride_; }
+
+    // Pixel row y, 0 <= y < Size(). The span is valid until the next call.
+    std::span<const uint8_t> Row(size_t y);
+
+private:
+    const SymbolRows& symbol_;
+    OutputOptions options_;
+    size_t size_;
+    size_t stride_;
+
+    int cached_;                        // module row held in pixels_
+    std::vector<uint8_t> modules_;
+    std::vector<uint8_t> pixels_;
+    std::vector<uint8_t> blank_;
+};
+
+// =============================================================================
+
+inline constexpr size_t RENDER_BAND_ROWS = 256;
+
+// Placement of pixel rows in a caller-owned buffer
+struct RowLayout
+{
+    size_t offset = 0;          // of the first row in memory
+    size_t stride = 0;          // bytes between rows, at least Raster::Stride()
+    bool bottom_up = false;     // the last pixel row comes first, as in BMP
+};
+
+// Writes all pixel rows of the Raster into dst, bytes of the stride past a row
+// are zeroed. Bands of `band_rows` rows are filled in parallel by the shared
+// thread pool, each band expands its module rows from SymbolRows::PackedRow on
+// its own, so the symbol is read from several threads at once.
+void RenderBands(const SymbolRows& symbol, const OutputOptions& options, std::span<std::byte> dst,
+                 const RowLayout& layout, size_t band_rows = RENDER_BAND_ROWS);
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
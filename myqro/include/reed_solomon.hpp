@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "defines.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Generating polynomial converted from exponents (as stored in GeneratingPolynomial)
+// to plain Galois field coefficients, highest degree first
+std::vector<uint8_t> GeneratorCoefficients(size_t n_correction_bytes);
+
+// =============================================================================
+
+// Computes correction bytes of `lanes` blocks at once. Blocks are stored transposed
+// (structure-of-arrays): byte j of block l is data[j * lanes + l], and correction
+// byte i of block l is written to parity[i * lanes + l]. Every parity update is then
+// a Galois field multiply-accumulate over a whole row of lanes.
+void GenerateCorrectionLanes(const uint8_t* data, size_t block_size, size_t lanes,
+                             const std::vector<uint8_t>& generator, uint8_t* parity);
+
+// Generates correction blocks (exactly n_correction_bytes each) for blocks of equal
+// size, e.g. the blocks of one group of a symbol or blocks of many messages with the
+// same version and correction level
+std::vector<ArrayType> GenerateCorrectionBlocks(std::span<const Block> blocks, size_t n_correction_bytes);
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
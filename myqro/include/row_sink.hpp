@@ -0,0 +1,246 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ccitt.hpp"
+#include "deflate.hpp"
+#include "outputter.hpp"
+#include "sink.hpp"
+#include "symbol_view.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Consumer of an image pushed row by row from top to bottom. Rows are packed 8
+// pixels per byte, first pixel in the most significant bit, dark pixels are 1.
+class RowSink
+{
+public:
+    virtual ~RowSink() {}
+
+    // Called once before the first row
+    virtual void Begin(size_t width, size_t height) = 0;
+
+    // Returning false cancels rendering, then Abort is called instead of End.
+    // Blocking here holds the renderer back.
+    virtual bool Row(std::span<const uint8_t> pixels) = 0;
+
+    virtual void End() {}
+    virtual void Abort() {}
+};
+
+// Pushes pixel rows of the symbol scaled and padded according to options. Returns
+// false if the sink or the stop token cancelled rendering.
+bool RenderRows(const SymbolRows& symbol, const OutputOptions& options, RowSink& sink,
+                std::stop_token stop = {});
+
+// =============================================================================
+
+// Binary PBM (P4)
+class PbmRowSink : public RowSink
+{
+public:
+    PbmRowSink(ByteSink& out) : out_(out) {}
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+
+private:
+    ByteSink& out_;
+};
+
+// =============================================================================
+
+// 1-bit grayscale PNG, compressed data is written in IDAT chunks as it accumulates
+class PngRowSink : public RowSink
+{
+public:
+    PngRowSink(ByteSink& out, int level = Deflater::DEFAULT_LEVEL);
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+    void End() final;
+
+private:
+    static constexpr size_t IDAT_SIZE = 1 << 16;
+
+    void WriteChunk(const char* type, std::span<const uint8_t> data);
+
+private:
+    ByteSink& out_;
+    Deflater deflater_;
+    std::vector<uint8_t> line_;
+};
+
+// =============================================================================
+
+// Bilevel TIFF compressed with CCITT Group 4, every Begin/End adds a page. A page
+// is kept compressed in memory until End, its directory is written after the
+// data of the next page, so Close must follow the last page.
+class TiffG4RowSink : public RowSink
+{
+public:
+    TiffG4RowSink(ByteSink& out, uint32_t dpi = TiffG4Outputter::DEFAULT_DPI);
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+    void End() final;
+    void Abort() final { encoder_.reset(); }
+
+    void Close();
+
+private:
+    static constexpr uint32_t IFD_ENTRIES = 12;
+    static constexpr uint32_t IFD_SIZE = 2 + 12 * IFD_ENTRIES + 4;
+    static constexpr uint32_t DIRECTORY_SIZE = IFD_SIZE + 2 * 8;   // and the resolutions
+
+    struct Page
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t offset;        // of the compressed data
+        uint32_t size;
+    };
+
+    void WriteDirectory(const Page& page, uint32_t next);
+    void Write(std::span<const uint8_t> data);
+
+private:
+    ByteSink& out_;
+    uint32_t dpi_;
+    uint32_t position_;         // bytes written so far
+
+    std::optional<G4Encoder> encoder_;
+    size_t width_;
+    size_t height_;
+    std::optional<Page> pending_;   // page whose directory is not written yet
+};
+
+// =============================================================================
+
+// ESC/POS raster graphics: `GS v 0` commands of at most `band_rows` rows each,
+// since printers hold one command in their line buffer before printing it
+class EscPosRowSink : public RowSink
+{
+public:
+    EscPosRowSink(ByteSink& out, size_t band_rows = EscPosOutputter::DEFAULT_BAND_ROWS);
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+
+private:
+    ByteSink& out_;
+    size_t band_rows_;
+    size_t height_;
+    size_t row_;
+};
+
+// =============================================================================
+
+// ZPL label with the image split into `^GFA` graphic fields of at most
+// `band_rows` rows. Rows use the compressed ASCII hex of ^GF: repeated digits are
+// prefixed with a count, trailing zero or one bytes become ',' or '!' and a row
+// equal to the previous one is ':'.
+class ZplRowSink : public RowSink
+{
+public:
+    ZplRowSink(ByteSink& out, size_t band_rows = ZplOutputter::DEFAULT_BAND_ROWS);
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+    void End() final;
+
+private:
+    void EncodeRow(std::span<const uint8_t> pixels);
+
+private:
+    ByteSink& out_;
+    size_t band_rows_;
+    size_t stride_;
+    size_t height_;
+    size_t row_;
+    std::vector<uint8_t> previous_;     // previous row of the current field
+    std::string line_;
+};
+
+// =============================================================================
+
+// Forwards every call to all added sinks, so one rendering pass feeds several
+// formats. A sink refusing a row cancels the others too.
+class TeeRowSink : public RowSink
+{
+public:
+    TeeRowSink() {}
+
+    void Add(RowSink& sink) { sinks_.push_back(&sink); }
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+    void End() final;
+    void Abort() final;
+
+private:
+    std::vector<RowSink*> sinks_;
+};
+
+// =============================================================================
+
+// Hands rows to another sink running on its own thread, so a slow consumer
+// (compression, printer, network) overlaps with rendering. At most `capacity`
+// rows are queued, Row blocks while the queue is full. Exceptions of the consumer
+// are rethrown from End or Abort.
+class AsyncRowSink : public RowSink
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    AsyncRowSink(RowSink& sink, size_t capacity = DEFAULT_CAPACITY);
+    ~AsyncRowSink();
+
+    void Begin(size_t width, size_t height) final;
+    bool Row(std::span<const uint8_t> pixels) final;
+    void End() final;
+    void Abort() final;
+
+    // Consumer refused a row or failed
+    bool Cancelled() const;
+
+private:
+    void Run();
+    void Stop(bool finish);
+
+private:
+    RowSink& sink_;
+    size_t capacity_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::vector<uint8_t>> slots_;   // ring of queued rows
+    size_t head_;
+    size_t count_;
+    bool finishing_;
+    bool aborted_;
+    bool cancelled_;
+    std::exception_ptr error_;
+    std::thread worker_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "canvas.hpp"
+#include "encode_provider.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Encodes sequences of messages made of a fixed prefix and a counter padded with
+// zeros to a fixed width, e.g. serial numbers of labels. Such messages differ in a
+// few data codewords only. Reed-Solomon is linear, so instead of encoding every
+// message from scratch only the message tail that holds the counter is converted
+// again, the parity of each block is updated with the contribution of every
+// changed byte, only modules of changed codewords are redrawn and the penalty of
+// every candidate mask is rescanned in the lines holding these modules only.
+class SerialEncoder
+{
+public:
+    SerialEncoder(const std::string& prefix, size_t width, CorrectionLevel cl = CorrectionLevel::M,
+                  EncodingType encoding = EncodingType::BYTES, int mask_id = 0,
+                  const EncodeOptions& options = EncodeOptions());
+
+    // Encodes prefix followed by the number padded to `width` digits. The canvas
+    // stays valid until the next call.
+    const Canvas& Encode(uint64_t number);
+
+    std::string Message(uint64_t number) const;
+
+    // Encodes `count` consecutive numbers starting from `start`, counter width is
+    // the number of digits of the last one
+    static std::vector<Canvas> EncodeRange(const std::string& prefix, uint64_t start, size_t count,
+                                           CorrectionLevel cl = CorrectionLevel::M,
+                                           EncodingType encoding = EncodingType::BYTES, int mask_id = 0,
+                                           const EncodeOptions& options = EncodeOptions());
+
+private:
+    // Penalty of a candidate mask kept up to date with the redrawn modules
+    struct MaskPenalty
+    {
+        std::vector<uint8_t> rows;                  // module values row by row
+        std::vector<uint8_t> cols;                  // module values column by column
+        std::vector<size_t> row_scores;             // LinesPenalty of every row
+        std::vector<size_t> col_scores;             // LinesPenalty of every column
+        std::vector<size_t> square_scores;          // SquaresPenalty of rows r and r + 1
+        size_t lines;                               // sum of all scores
+        size_t count_black;
+    };
+
+    void Init(const std::string& message);
+    // Updates data codewords starting from `first` with `data`
+    void Update(size_t first, const ArrayType& data);
+    void UpdateMessage(const std::string& message);
+    void Redraw(const std::vector<size_t>& changed);
+    void InitPenalties();
+    // Rescans dirty lines of the mask planes and returns the penalty of the mask
+    size_t RescanPenalty(MaskPenalty& penalty) const;
+
+    // Parity of unit blocks: row j is the parity of a block of `size` bytes with a
+    // single 1 at position j
+    const std::vector<ArrayType>& ContributionTable(size_t size);
+
+private:
+    EncodeProviderPtr provider_;
+    std::string prefix_;
+    size_t width_;
+    CorrectionLevel cl_;
+    int mask_id_;
+    EncodeOptions options_;
+
+    bool initialized_;
+    size_t version_;
+    size_t n_correction_bytes_;
+
+    ArrayType stream_;                              // data codewords of the last message
+    ArrayType output_;                              // interleaved codewords of the last message
+    std::vector<size_t> block_of_;                  // block of every data codeword
+    std::vector<size_t> index_in_block_;            // position of every data codeword in its block
+    std::vector<size_t> block_sizes_;
+    std::vector<size_t> data_position_;             // position of every data codeword in output
+    std::vector<std::vector<size_t>> parity_position_;
+    std::map<size_t, std::vector<ArrayType>> contribution_;
+
+    std::vector<size_t> order_;                     // data modules in placement order
+    std::vector<size_t> masks_;                     // candidate masks
+    std::vector<Canvas> canvases_;                  // one canvas per candidate mask
+
+    size_t tail_start_;                             // first message char converted for every number
+    size_t tail_bit_;                               // first data stream bit of the converted tail
+
+    std::vector<MaskPenalty> penalties_;            // per candidate mask, if the mask is chosen
+    std::vector<uint8_t> dirty_rows_;               // lines with modules redrawn since the last scan
+    std::vector<uint8_t> dirty_cols_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
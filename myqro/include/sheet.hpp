@@ -0,0 +1,86 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+
+#include "canvas.hpp"
+#include "outputter.hpp"
+#include "row_sink.hpp"
+#include "sink.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Grid of cells, sizes are in pixels
+struct SheetLayout
+{
+    size_t columns = 1;
+
+    // 0 fits the largest code and its caption
+    size_t cell_width = 0;
+    size_t cell_height = 0;
+
+    size_t margin = 0;              // around the sheet
+    size_t spacing = 0;             // between cells
+
+    OutputOptions symbol;           // scale and quiet zone of every code
+    size_t caption_scale = 1;       // pixels per dot of the caption font
+};
+
+// Tiles the codes into one raster, left to right and top to bottom. Codes are
+// centered horizontally at the top of their cells, captions are drawn below them
+// with a built-in 5x7 font (lowercase letters are uppercased, other characters
+// outside ASCII 32-95 become '?') and clipped to the cell. Captions are either
+// empty or one per code. Only the codes of one grid row are read at a time.
+bool RenderSheet(std::span<const Canvas> canvases, const SheetLayout& layout, RowSink& sink,
+                 std::span<const std::string> captions = {}, std::stop_token stop = {});
+
+// =============================================================================
+
+enum class SheetFormat
+{
+    PBM,        // binary P4
+    PNG,
+};
+
+// Writes many codes as one image, rows are streamed as soon as they are composed
+class SheetOutputter
+{
+public:
+    SheetOutputter(const SheetLayout& layout, SheetFormat format = SheetFormat::PNG) :
+        layout_(layout),
+        format_(format)
+    {}
+
+    SheetOutputter(const std::filesystem::path& path, const SheetLayout& layout,
+                   SheetFormat format = SheetFormat::PNG) :
+        layout_(layout),
+        format_(format),
+        sink_(std::make_unique<FileSink>(path))
+    {}
+
+    // Writes into the file given in the constructor
+    void Output(std::span<const Canvas> canvases, std::span<const std::string> captions = {});
+    void Output(std::span<const Canvas> canvases, std::span<const std::string> captions, ByteSink& sink);
+
+    const SheetLayout& Layout() const { return layout_; }
+
+private:
+    SheetLayout layout_;
+    SheetFormat format_;
+    std::unique_ptr<ByteSink> sink_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Instruction set used by the hot kernels. SSE2 is the baseline build (the only
+// level on non-x86 targets), AVX2 requires BMI2 as well, AVX512 requires AVX-512BW,
+// GFNI and BMI2.
+enum class SimdLevel : uint8_t
+{
+    SSE2    = 0,
+    AVX2    = 1,
+    AVX512  = 2,
+};
+
+const char* SimdLevelToString(SimdLevel l);
+SimdLevel SimdLevelFromString(const std::string& s);
+
+// Best level supported by the running CPU
+SimdLevel DetectSimdLevel();
+
+// =============================================================================
+
+inline constexpr size_t CORRECTION_TILE_LANES = 64;
+
+struct Kernels
+{
+    SimdLevel level;
+
+    // Reed-Solomon parity of up to CORRECTION_TILE_LANES transposed blocks,
+    // see GenerateCorrectionLanes
+    void (*correction_tile)(const uint8_t* data, size_t block_size, size_t stride, size_t width,
+                            const uint8_t* generator, size_t n_correction_bytes, uint8_t* parity);
+
+    // Unpacks `count` bits of MSB-first bitstream into bytes 0/1
+    void (*unpack_bits)(const uint8_t* src, size_t count, uint8_t* dst);
+
+    // dst[i] ^= src[i]
+    void (*xor_bytes)(uint8_t* dst, const uint8_t* src, size_t count);
+
+    // Penalty scans over `rows` rows of `width` modules (one byte per module):
+    // sum of (length - 2) over runs of 5+ equal modules, number of 2x2 squares of
+    // equal modules and number of penalized "# ### #" patterns
+    size_t (*penalty_runs)(const uint8_t* plane, size_t width, size_t rows);
+    size_t (*penalty_squares)(const uint8_t* plane, size_t width, size_t rows);
+    size_t (*penalty_finders)(const uint8_t* plane, size_t width, size_t rows);
+
+    // Number of non-zero bytes
+    size_t (*count_ones)(const uint8_t* data, size_t count);
+
+    // Scales a packed MSB-first row of `count` modules: every module becomes `scale`
+    // equal bits, written from bit `offset` of dst. The bits before `offset` in its
+    // first byte are kept (the written bits are ORed into that byte), all following
+    // bytes are overwritten and the rest of the last written byte is cleared, so
+    // rows composed of several calls are written left to right.
+    void (*expand_bits)(const uint8_t* src, size_t count, size_t scale, size_t offset, uint8_t* dst);
+};
+
+// Kernels selected on first use: the best level supported by the CPU, or the
+// level from MYQRO_SIMD environment variable (sse2, avx2, avx512) if it is lower
+const Kernels& GetKernels();
+
+// Kernels of specific level. Throws if the CPU does not support it.
+const Kernels& GetKernels(SimdLevel level);
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
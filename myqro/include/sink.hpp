@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Destination of the bytes written by outputters
+class ByteSink
+{
+public:
+    virtual ~ByteSink() {}
+
+    virtual void Write(std::span<const uint8_t> data) = 0;
+    virtual void Flush() {}
+
+    void Write(std::string_view text)
+    {
+        Write(std::span(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+    }
+};
+
+// =============================================================================
+
+// Growable buffer in memory
+class MemorySink : public ByteSink
+{
+public:
+    using ByteSink::Write;
+
+    MemorySink() {}
+
+    void Write(std::span<const uint8_t> data) final { data_.insert(data_.end(), data.begin(), data.end()); }
+
+    const std::vector<uint8_t>& Data() const { return data_; }
+    std::vector<uint8_t> Release() { return std::move(data_); }
+
+private:
+    std::vector<uint8_t> data_;
+};
+
+// =============================================================================
+
+// Counts bytes without storing them, see Outputter::OutputSize
+class CountingSink : public ByteSink
+{
+public:
+    using ByteSink::Write;
+
+    CountingSink() : size_(0) {}
+
+    void Write(std::span<const uint8_t> data) final { size_ += data.size(); }
+
+    size_t Size() const { return size_; }
+
+private:
+    size_t size_;
+};
+
+// =============================================================================
+
+// Buffer provided by the caller, writing past its end throws Error
+class SpanSink : public ByteSink
+{
+public:
+    using ByteSink::Write;
+
+    SpanSink(std::span<std::byte> buffer) : buffer_(buffer), size_(0) {}
+
+    void Write(std::span<const uint8_t> data) final;
+
+    // Bytes written so far
+    size_t Size() const { return size_; }
+    std::span<std::byte> Written() const { return buffer_.first(size_); }
+
+private:
+    std::span<std::byte> buffer_;
+    size_t size_;
+};
+
+// =============================================================================
+
+// Wraps a stream, flushes it only on Flush()
+class StreamSink : public ByteSink
+{
+public:
+    using ByteSink::Write;
+
+    StreamSink(std::ostream& os) : stream_(os) {}
+
+    void Write(std::span<const uint8_t> data) final;
+    void Flush() final { stream_.flush(); }
+
+private:
+    std::ostream& stream_;
+};
+
+// =============================================================================
+
+// Raw file descriptor (not owned) written through a large internal buffer
+class FdSink : public ByteSink
+{
+public:
+    using ByteSink::Write;
+
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    FdSink(int fd, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    virtual ~FdSink();
+
+    void Write(std::span<const uint8_t> data) final;
+    void Flush() final;
+
+protected:
+    void SetFd(int fd) { fd_ = fd; }
+    int Fd() const { return fd_; }
+
+private:
+    void WriteAll(const uint8_t* data, size_t size);
+
+private:
+    int fd_;
+    std::vector<uint8_t> buffer_;
+    size_t size_;
+};
+
+// =============================================================================
+
+// File opened (created or truncated) in the constructor and closed in the destructor
+class FileSink : public FdSink
+{
+public:
+    FileSink(const std::filesystem::path& path, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    ~FileSink();
+
+    const std::filesystem::path& Path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+// =============================================================================
+
+// File of a fixed size created (or truncated) and mapped into memory for writing,
+// unmapped and closed in the destructor. A new file reads as zeros.
+class MappedFile
+{
+public:
+    MappedFile(const std::filesystem::path& path, size_t size);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<std::byte> Data() { return std::span(data_, size_); }
+    const std::filesystem::path& Path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+    int fd_;
+    std::byte* data_;
+    size_t size_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "canvas.hpp"
+#include "core.hpp"
+#include "defines.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Read-only modules of a symbol, the way outputters see it: Canvas and SymbolView
+// are both output through this interface
+class SymbolRows
+{
+public:
+    virtual ~SymbolRows() {}
+
+    virtual size_t Size() const = 0;
+
+    // WHITE or BLACK
+    virtual uint8_t Module(size_t row, size_t col) const = 0;
+
+    // Writes Size() module values of the row
+    virtual void Row(size_t row, std::span<uint8_t> values) const;
+
+    // Writes the row packed 8 modules per byte, first module in the most significant
+    // bit, unused bits of the last byte are zero
+    virtual void PackedRow(size_t row, std::span<uint8_t> bits) const;
+
+    size_t PackedRowSize() const { return (Size() + BITS_PER_BYTE - 1) / BITS_PER_BYTE; }
+
+    bool IsInside(int row, int col) const
+    {
+        int size = static_cast<int>(Size());
+        return row >= 0 && row < size && col >= 0 && col < size;
+    }
+};
+
+// =============================================================================
+
+class CanvasRows : public SymbolRows
+{
+public:
+    CanvasRows(const Canvas& canvas) : canvas_(canvas) {}
+
+    size_t Size() const final { return canvas_.Size(); }
+    uint8_t Module(size_t row, size_t col) const final { return canvas_.At(row, col).value; }
+    void PackedRow(size_t row, std::span<uint8_t> bits) const final { canvas_.PackedRow(row, bits); }
+
+private:
+    const Canvas& canvas_;
+};
+
+// =============================================================================
+
+// Symbol which keeps only its codewords (data blocks followed by correction blocks,
+// see core::EncodeCodewords), version, correction level and mask. Every module is
+// computed when asked from the placement map of the version, which is built once
+// and shared by all views of that version.
+class SymbolView : public SymbolRows
+{
+public:
+    SymbolView(std::vector<uint8_t> codewords, size_t version, CorrectionLevel cl, size_t mask_id);
+
+    // Mask with the lowest penalty is chosen if mask_id < 0. Choosing it needs the
+    // whole symbol once, one byte per module, which is released afterwards.
+    static SymbolView Encode(const std::string& msg, CorrectionLevel cl = CorrectionLevel::M,
+                             EncodingType encoding = EncodingType::BYTES, int mask_id = 0);
+
+    size_t Version() const { return version_; }
+    size_t Size() const final { return size_; }
+    CorrectionLevel Level() const { return cl_; }
+    size_t MaskId() const { return mask_id_; }
+    std::span<const uint8_t> Codewords() const { return codewords_; }
+
+    uint8_t Module(size_t row, size_t col) const final;
+    void Row(size_t row, std::span<uint8_t> values) const final;
+    void PackedRow(size_t row, std::span<uint8_t> bits) const final;
+
+private:
+    // Throws before any table indexed by them is read, returns the version
+    static size_t Validate(size_t version, size_t mask_id);
+
+    // Every module of a version is either a bit of the interleaved codewords (its
+    // index, remainder bits past the last codeword are light), a fixed function
+    // module or a bit of the format code
+    struct Placement
+    {
+        static constexpr int32_t FUNCTION = -1;
+        static constexpr int32_t FORMAT = -2;       // FORMAT - shift for bit `shift` of the code
+
+        std::vector<int32_t> bits;
+        std::vector<uint8_t> functions;             // WHITE or BLACK for fixed function modules
+    };
+
+    static const Placement& PlacementOf(size_t version);
+
+    uint8_t Value(size_t index, size_t row, size_t col) const;
+
+private:
+    std::vector<uint8_t> codewords_;
+    size_t version_;
+    size_t size_;
+    CorrectionLevel cl_;
+    size_t mask_id_;
+    core::Blocks blocks_;
+    size_t n_bits_;
+    size_t format_code_;
+    const Placement* placement_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
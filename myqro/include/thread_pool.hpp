@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+// Fixed-size pool of worker threads. The calling thread always takes part in
+// ParallelFor, so a pool without workers degrades to a plain loop.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t n_workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls f(i) for every i in [0, count) and returns when all calls are finished.
+    // The first exception thrown by f is rethrown in the calling thread.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& f);
+
+    size_t WorkersCount() const { return workers_.size(); }
+
+    // Pool shared by the library: one worker per hardware thread (excluding the
+    // calling one), but no more than MAX_SHARED_WORKERS.
+    static ThreadPool& Shared();
+
+    static constexpr size_t MAX_SHARED_WORKERS = 7;
+
+private:
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+};
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -1,15 +1,16 @@
 #include "canvas.hpp"
 
-#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
-#include <numeric>
 #include <format>
 #include <fstream>
 
-#include "bits.hpp"
 #include "defines.hpp"
 #include "error.hpp"
 #include "logger.hpp"
+#include "simd.hpp"
 #include "utils.hpp"
 
 
@@ -20,6 +21,47 @@ namespace myqro
 
 // =============================================================================
 
+namespace
+{
+
+// Multiplying a word of eight 0/1 bytes gathers them into its top byte: the first
+// byte in memory goes to bit 7 or to bit 0 depending on the byte order
+constexpr uint64_t GATHER_REVERSED = 0x8040201008040201;
+constexpr uint64_t GATHER_IN_ORDER = 0x0102040810204080;
+
+uint64_t GatherMultiplier(bool msb_first)
+{
+    const bool little = std::endian::native == std::endian::little;
+    return (msb_first == little) ? GATHER_REVERSED : GATHER_IN_ORDER;
+}
+
+// Copies `count` bits of `line` starting at bit `offset` of its first byte into
+// dst, the other bits of the first and the last byte of dst are kept
+void MergeBits(const uint8_t* line, size_t offset, size_t count, std::byte* dst)
+{
+    const size_t end = offset + count;
+    const size_t n_bytes = (end + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    const uint8_t head = 0xFF >> offset;
+    const uint8_t tail = static_cast<uint8_t>(0xFF << (n_bytes * BITS_PER_BYTE - end));
+
+    auto merge = [line, dst](size_t i, uint8_t mask) {
+        dst[i] = std::byte((std::to_integer<uint8_t>(dst[i]) & ~mask) | (line[i] & mask));
+    };
+
+    if (n_bytes == 1)
+    {
+        merge(0, head & tail);
+        return;
+    }
+    merge(0, head);
+    std::memcpy(dst + 1, line + 1, n_bytes - 2);
+    merge(n_bytes - 1, tail);
+}
+
+} // namespace
+
+// =============================================================================
+
 const char* PatternNameToString(Pattern p)
 {
     switch (p)
@@ -40,109 +82,136 @@ const char* PatternNameToString(Pattern p)
 
 Canvas::Canvas(size_t version) :
     version_(version),
-    size_(21 + (version - 1) * 4)
+    size_(SymbolSize(version))
 {
     cells_.resize(size_*size_);
 }
 
-// =============================================================================
-
-void Canvas::SetupSearchPatterns()
+Canvas::Canvas(size_t version, std::span<const Cell> cells) :
+    version_(version),
+    size_(SymbolSize(version)),
+    cells_(cells.begin(), cells.end())
 {
-    PlaceSearchPattern(-1, -1);
-    PlaceSearchPattern(-1, size_ - SEARCH_PATTERN_SIZE);
-    PlaceSearchPattern(size_ - SEARCH_PATTERN_SIZE, -1);
+    if (cells_.size() != size_*size_)
+        throw Error(std::format("Canvas of version {} needs {} cells, got {}", version_, size_*size_, cells_.size()));
 }
 
 // =============================================================================
 
-void Canvas::SetupLevelingPatterns()
+void Canvas::PackedRow(size_t row, std::span<uint8_t> bits, bool msb_first) const
 {
-    if (version_ >= 2)
-    {
-        const auto& centers = LevelingPatterns[version_ - 1];
-        for (size_t p: centers)
-            for (size_t q: centers)
-                PlaceLevelingPattern(p, q);
-    }
-}
-
-// =============================================================================
+    const size_t n_bytes = (size_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    if (bits.size() < n_bytes)
+        throw Error(std::format("Packed row of {} modules needs {} bytes, got {}", size_, n_bytes, bits.size()));
 
-void Canvas::SetupSyncLines()
-{
-    uint8_t value = BLACK;
-    static const int b = SEARCH_PATTERN_SIZE - 2;
-    for (int a = size_ - SEARCH_PATTERN_SIZE + 1; a > b; a--)
+    const uint64_t gather = GatherMultiplier(msb_first);
+    const Cell* cells = &cells_[row * size_];
+    for (size_t i = 0; i < n_bytes; i++)
     {
-        Cell& c1 = At(a, b);
-        if (c1.kind == Pattern::UNKNOWN)
-        {
-            c1.kind = Pattern::SYNC;
-            c1.value = value;
-        }
+        const size_t first = i * BITS_PER_BYTE;
+        const size_t count = std::min(BITS_PER_BYTE, size_ - first);
 
-        Cell& c2 = At(b, a);
-        if (c2.kind == Pattern::UNKNOWN)
-        {
-            c2.kind = Pattern::SYNC;
-            c2.value = value;
-        }
+        uint8_t values[BITS_PER_BYTE] = {};
+        for (size_t k = 0; k < count; k++)
+            values[k] = cells[first + k].value & 1;
 
-        value = 1 - value;
+        uint64_t word;
+        std::memcpy(&word, values, sizeof(word));
+        bits[i] = static_cast<uint8_t>((word * gather) >> 56);
     }
 }
 
 // =============================================================================
 
-void Canvas::SetupVersionCode()
+void Canvas::ExportPacked(std::span<std::byte> dst, size_t stride, bool msb_first) const
 {
-    static constexpr int mask_size = 3;
-    static constexpr int bit_size = 6;
-    if (version_ >= 7)
+    const size_t n_bytes = (size_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    if (stride < n_bytes)
+        throw Error(std::format("Stride {} is less than {} bytes of a packed row", stride, n_bytes));
+    if (dst.size() < (size_ - 1) * stride + n_bytes)
+        throw Error(std::format("Packed symbol of size {} does not fit {} bytes", size_, dst.size()));
+
+    for (size_t row = 0; row < size_; row++)
     {
-        uint32_t code = VersionCode[version_ - 1];
-        uint32_t mask[mask_size] = {
-            (code & 0b111111000000000000) >> (2*bit_size),
-            (code & 0b000000111111000000) >> (1*bit_size),
-            (code & 0b000000000000111111) >> (0*bit_size),
-        };
-
-        int start = size_ - SEARCH_PATTERN_SIZE - mask_size;
-        for (int r = 0; r < mask_size; r++)
-        {
-            uint32_t m = mask[r];
-            for (int c = 0; c < bit_size; c++)
-            {
-                uint8_t value = GetBit(m, bit_size - c - 1);
-                At(start + r, c) = {Pattern::VERSION, value};
-                At(c, start + r) = {Pattern::VERSION, value};
-            }
-        }
+        std::span<uint8_t> bits(reinterpret_cast<uint8_t*>(dst.data() + row * stride), n_bytes);
+        PackedRow(row, bits, msb_first);
     }
 }
 
 // =============================================================================
 
-void Canvas::FillData(CorrectionLevel cl, size_t mask_id, const DataStream& stream)
+void Canvas::BlitScaled(std::span<std::byte> dst, size_t stride, size_t x, size_t y, size_t scale, size_t indent,
+                        PixelFormat format) const
 {
-    if (mask_id >= MaskFunctions.size())
-        throw Error(std::format("No such mask_id: {}", mask_id));
+    if (scale == 0)
+        throw Error("Scale must be positive");
+
+    const size_t side = (size_ + 2 * indent) * scale;
+    const size_t pixels_per_row = (format == PixelFormat::MONO) ? stride * BITS_PER_BYTE : stride;
+    if (x + side > pixels_per_row)
+        throw Error(std::format("Symbol of {} pixels at x {} does not fit rows of {} pixels", side, x, pixels_per_row));
+    if ((y + side) * stride > dst.size())
+        throw Error(std::format("Symbol of {} pixels at y {} does not fit {} bytes", side, y, dst.size()));
+
+    const Kernels& kernels = GetKernels();
+    std::vector<uint8_t> modules((size_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+
+    // one line of pixels per module row, copied to its `scale` rows
+    std::vector<uint8_t> line;
+    size_t offset = 0;
+    std::byte* origin = nullptr;
+    if (format == PixelFormat::MONO)
+    {
+        offset = x % BITS_PER_BYTE;
+        line.resize((offset + side + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+        origin = dst.data() + y * stride + x / BITS_PER_BYTE;
+    }
+    else
+    {
+        line.resize(side);
+        origin = dst.data() + y * stride + x;
+    }
 
-    auto mask = MaskFunctions[mask_id];
-    PlaceCorrectionMaskCode(cl, mask_id);
+    auto put = [&](size_t first_row) {
+        for (size_t r = first_row; r < first_row + scale; r++)
+        {
+            if (format == PixelFormat::MONO)
+                MergeBits(line.data(), offset, side, origin + r * stride);
+            else
+                std::memcpy(origin + r * stride, line.data(), side);
+        }
+    };
 
-    auto fun = [&stream, mask, this](size_t index, size_t r, size_t c)
+    // quiet zone
+    std::fill(line.begin(), line.end(), (format == PixelFormat::MONO) ? 0x00 : 0xFF);
+    for (size_t row = 0; row < indent; row++)
     {
-        uint8_t value = (index >= stream.Size()) ? 0 : stream.BitAt(index);
-        uint8_t module_value = 1 - (value ^ (mask(c, r) != 0));
-        At(r, c) = {Pattern::DATA, module_value};
-        index++;
-    };
+        put(row * scale);
+        put((indent + size_ + row) * scale);
+    }
 
-    IterateDataModules(Pattern::UNKNOWN, fun);
-}
+    std::vector<uint8_t> values;
+    if (format == PixelFormat::GRAY8)
+        values.resize(size_);
 
+    for (size_t row = 0; row < size_; row++)
+    {
+        PackedRow(row, modules);
+        if (format == PixelFormat::MONO)
+        {
+            std::fill(line.begin(), line.end(), 0);
+            kernels.expand_bits(modules.data(), size_, scale, offset + indent * scale, line.data());
+        }
+        else
+        {
+            kernels.unpack_bits(modules.data(), size_, values.data());
+            uint8_t* pixels = line.data() + indent * scale;
+            for (size_t col = 0; col < size_; col++)
+                std::memset(pixels + col * scale, values[col] ? 0x00 : 0xFF, scale);
+        }
+        put((indent + row) * scale);
+    }
+}
 
 // =============================================================================
 
@@ -189,316 +258,6 @@ void Canvas::DebugOutputFillDataOrder(std::ostream& os)
 
 // =============================================================================
 
-size_t Canvas::Penalty(size_t mask_id) const
-{
-    size_t result = 0;
-
-    static const size_t square_penalty = 3;
-    static const size_t pattern_penalty = 120;
-
-    // Find horizontal bars 5+ units long
-    static const size_t min_len = 5;
-    for (size_t row = 0; row < size_; ++row)
-    {
-        for (size_t col = 0; col < size_;)
-        {
-            uint8_t color = At(row, col).value;
-            size_t i = 1;
-            while (col + i < size_ && At(row, col + i).value == color)
-                ++i;
-
-            if (i >= min_len) result += (i - 2);
-            col += i;
-        }
-    }
-    // Find vertical bars 5+ units long
-    for (size_t col = 0; col < size_; ++col)
-    {
-        for (size_t row = 0; row < size_;)
-        {
-            uint8_t color = At(row, col).value;
-            size_t i = 1;
-            while (row + i < size_ && At(row + i, col).value == color)
-                ++i;
-
-            if (i >= min_len) result += (i - 2);
-            row += i;
-        }
-    }
-
-    // Find 2x2 squares of same color
-    const size_t sq = 2;
-    for (size_t row = 0; row + sq < size_ + 1; ++row)
-    {
-        for (size_t col = 0; col + sq < size_ + 1; ++col)
-            if (HasSameColorSquare(row, col, sq)) result += square_penalty;
-    }
-
-    // Find horizontal "# ### #" with at least 4 possible white modules at one of the sides (or both)
-    static const size_t pat_len = 7;
-    static const size_t strip_len = 4;
-    for (size_t row = 0; row < size_; ++row)
-    {
-        for (size_t col = 0; col + pat_len < size_ + 1;)
-        {
-            if (At(row, col+0).value == BLACK &&
-                At(row, col+1).value == WHITE &&
-                At(row, col+2).value == BLACK &&
-                At(row, col+3).value == BLACK &&
-                At(row, col+4).value == BLACK &&
-                At(row, col+5).value == WHITE &&
-                At(row, col+6).value == BLACK)
-            {
-                bool has_before = (col > strip_len) ? HasColorStripe(row, col - 1, 0, -1, strip_len) : false;
-                bool has_after = (col + pat_len < size_) ? HasColorStripe(row, col + pat_len, 0, 1, strip_len) : false;
-
-                if (has_before || has_after)
-                    result += pattern_penalty;
-
-                if (has_after)
-                    col += pat_len + strip_len;
-                else if (has_before)
-                    col += pat_len;
-                else
-                    col += 1;
-            }
-            else
-                ++col;
-        }
-    }
-
-    // Find vertical "# ### #" with at least 4 possible white modules at one of the sides (or both)
-    for (size_t col = 0; col < size_; ++col)
-    {
-        for (size_t row = 0; row + pat_len < size_ + 1;)
-        {
-            if (At(row+0, col).value == BLACK &&
-                At(row+1, col).value == WHITE &&
-                At(row+2, col).value == BLACK &&
-                At(row+3, col).value == BLACK &&
-                At(row+4, col).value == BLACK &&
-                At(row+5, col).value == WHITE &&
-                At(row+6, col).value == BLACK)
-            {
-                bool has_before = (row > strip_len) ? HasColorStripe(row-1, col, -1, 0, strip_len) : false;
-                bool has_after = (row + pat_len < size_) ? HasColorStripe(row+pat_len, col, 1, 0, strip_len) : false;
-
-                if (has_before || has_after)
-                    result += pattern_penalty;
-
-                if (has_after)
-                    row += pat_len + strip_len;
-                else if (has_before)
-                    row += pat_len;
-                else
-                    row += 1;
-            }
-            else
-                ++row;
-        }
-    }
-
-    size_t count_black = std::accumulate(cells_.begin(), cells_.end(), 0ULL,
-                                         [](size_t acc, const Cell& c) { return acc + c.value; });
-
-    result += static_cast<size_t>(std::fabs(100 * static_cast<float>(count_black) / (size_ * size_) - 50)) * 2;
-
-    LogDebug("Penalty: mask={} result={}", mask_id, result);
-    return result;
-}
-
-// =============================================================================
-
-void Canvas::PlaceSearchPattern(int row, int col)
-{
-    for (int r = row; r <= row + SEARCH_PATTERN_SIZE; r++)
-    {
-        for (int c = col; c <= col + SEARCH_PATTERN_SIZE; c++)
-        {
-            if (!IsInside(r, c)) continue;
-
-            Cell& cell = At(r, c);
-            cell.kind = Pattern::SEARCH;
-
-            // самая внешняя белая граница
-            if (r == row || r == row + SEARCH_PATTERN_SIZE || c == col || c == col + SEARCH_PATTERN_SIZE)
-            {
-                cell.value = WHITE;
-                continue;
-            }
-
-            // внешняя чёрная граница
-            if (r == row + 1 || r == row + SEARCH_PATTERN_SIZE - 1 || c == col + 1 || c == col + SEARCH_PATTERN_SIZE - 1)
-            {
-                cell.value = BLACK;
-                continue;
-            }
-
-            // внутренняя белая рамка
-            if (r == row + 2 || r == row + SEARCH_PATTERN_SIZE - 2 || c == col + 2 || c == col + SEARCH_PATTERN_SIZE - 2)
-            {
-                cell.value = WHITE;
-                continue;
-            }
-
-            // внутренний чёрный квадрат 3x3
-            cell.value = BLACK;
-        }
-    }
-}
-
-// =============================================================================
-
-void Canvas::PlaceLevelingPattern(int row, int col)
-{
-    static const int half_size = 2;
-    // check if leveling pattern intersects with search pattern
-    for (int r = row - half_size; r <= row + half_size; r++)
-    {
-        for (int c = col - half_size; c <= col + half_size; c++)
-        {
-            if (!IsInside(r, c))
-                throw Error("Trying to place leveling pattern outside of the code canvas");
-            Cell& cell = At(r, c);
-            if (cell.kind == Pattern::SEARCH)
-            {
-                LogDebug("Can't place leveling pattern module at ({},{}): module is occupied with {}",
-                         r, c, PatternNameToString(cell.kind));
-                return;
-            }
-        }
-    }
-
-    for (int r = row - half_size; r <= row + half_size; r++)
-    {
-        for (int c = col - half_size; c <= col + half_size; c++)
-        {
-            Cell& cell = At(r, c);
-            cell.kind = Pattern::LEVELING;
-            if ((r == row - half_size) || (r == row + half_size) ||
-                (c == col - half_size) || (c == col + half_size) ||
-                (r == row && c == col))
-                cell.value = BLACK;
-            else
-                cell.value = WHITE;
-        }
-    }
-}
-
-// =============================================================================
-
-void Canvas::PlaceCorrectionMaskCode(CorrectionLevel cl, size_t mask_id)
-{
-    static constexpr size_t code_size = 2*SEARCH_PATTERN_SIZE - 1;
-    size_t code = CorrectionLevelMaskCode.at(cl)[mask_id];
-
-    // vertical part of code right to the bottom left search square
-    for (int r = 0; r < SEARCH_PATTERN_SIZE - 1; r++)
-    {
-        uint8_t value = GetBit(code, code_size - r - 1);
-        At(size_ - 1 - r, SEARCH_PATTERN_SIZE) = {Pattern::MASK_CORRECTION, value};
-    }
-
-    // this square must always be black
-    At(size_ - SEARCH_PATTERN_SIZE, SEARCH_PATTERN_SIZE) = {Pattern::MASK_CORRECTION, 1};
-
-    // horisontal part of code below the top right search square
-    for (int c = 0; c < SEARCH_PATTERN_SIZE; c++)
-    {
-        uint8_t value = GetBit(code, code_size - c - SEARCH_PATTERN_SIZE);
-        At(SEARCH_PATTERN_SIZE, size_ - SEARCH_PATTERN_SIZE + c) = {Pattern::MASK_CORRECTION, value};
-    }
-
-    // horisontal part of code below the top left search square
-    for (int c = 0; c < SEARCH_PATTERN_SIZE - 1; c++)
-    {
-        uint8_t value = GetBit(code, code_size - c - 1);
-        int col = c;
-        if (col >= SEARCH_PATTERN_SIZE - 2)
-            col += 1;
-
-        At(SEARCH_PATTERN_SIZE, col) = {Pattern::MASK_CORRECTION, value};
-    }
-
-    // vertical part of code right to the top left search square
-    for (int r = 0; r < SEARCH_PATTERN_SIZE; r++)
-    {
-        uint8_t value = GetBit(code, code_size - r - SEARCH_PATTERN_SIZE);
-        int row = SEARCH_PATTERN_SIZE - r;
-        if (row <= SEARCH_PATTERN_SIZE - 2)
-            row -= 1;
-
-        At(row, SEARCH_PATTERN_SIZE) = {Pattern::MASK_CORRECTION, value};
-    }
-}
-
-// =============================================================================
-
-bool Canvas::HasSameColorSquare(size_t row, size_t col, size_t sq) const
-{
-    uint8_t color = At(row, col).value;
-    for (size_t dr = 0; dr < sq; ++dr)
-    {
-        for (size_t dc = 0; dc < sq; ++dc)
-        {
-            if (!IsInside(row+dr, col+dc) || At(row+dr, col+dc).value != color)
-                return false;
-        }
-    }
-    return true;
-}
-
-// =============================================================================
-
-bool Canvas::HasColorStripe(size_t row, size_t col, int dr, int dc, size_t len, uint8_t color) const
-{
-    int r = static_cast<int>(row);
-    int c = static_cast<int>(col);
-    for (size_t i = 0; i < len; (r+=dr, c+=dc, ++i))
-    {
-        if (!IsInside(r, c) || At(r, c).value != color) return false;
-    }
-    return true;
-}
-
-// =============================================================================
-
-void Canvas::IterateDataModules(Pattern pattern, std::function<void(size_t, size_t, size_t)> f)
-{
-    static const std::array<Dir, 2> dd[2]{
-        {Dir{0, -1}, Dir{-1, 1}},   // up
-        {Dir{0, -1}, Dir{1,  1}},   // down
-    };
-
-    size_t index = 0;
-    size_t n_strip = size_ / 2;
-    for (size_t i = 0; i < n_strip; i++)
-    {
-        uint8_t down = i % 2;
-        int r = down ? 0 : size_ - 1;
-        int c = size_ - 1 - 2 * i;
-        if (c <= SEARCH_PATTERN_SIZE - 2)
-            c--;
-
-        uint8_t d = 0;
-        while (IsInside(r, c))
-        {
-            if (At(r, c).kind == pattern)
-            {
-                f(index, r, c);
-                index++;
-            }
-
-            const Dir& dir = dd[down][d];
-            r += dir.dr;
-            c += dir.dc;
-            d = 1 - d;
-        }
-    }
-}
-
-// =============================================================================
-
 } // namespace myqro
 
 // =============================================================================
@@ -0,0 +1,241 @@
+#include "ccitt.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "defines.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+struct Code
+{
+    uint16_t code;
+    uint8_t length;
+};
+
+// T.4 run length codes: terminating codes for runs 0-63, make-up codes for
+// multiples of 64 up to 1728 and extended make-up codes 1792-2560 shared by both
+// colors
+constexpr Code WhiteTerminating[] = {
+    {0x035, 8}, {0x007, 6}, {0x007, 4}, {0x008, 4},
+    {0x00B, 4}, {0x00C, 4}, {0x00E, 4}, {0x00F, 4},
+    {0x013, 5}, {0x014, 5}, {0x007, 5}, {0x008, 5},
+    {0x008, 6}, {0x003, 6}, {0x034, 6}, {0x035, 6},
+    {0x02A, 6}, {0x02B, 6}, {0x027, 7}, {0x00C, 7},
+    {0x008, 7}, {0x017, 7}, {0x003, 7}, {0x004, 7},
+    {0x028, 7}, {0x02B, 7}, {0x013, 7}, {0x024, 7},
+    {0x018, 7}, {0x002, 8}, {0x003, 8}, {0x01A, 8},
+    {0x01B, 8}, {0x012, 8}, {0x013, 8}, {0x014, 8},
+    {0x015, 8}, {0x016, 8}, {0x017, 8}, {0x028, 8},
+    {0x029, 8}, {0x02A, 8}, {0x02B, 8}, {0x02C, 8},
+    {0x02D, 8}, {0x004, 8}, {0x005, 8}, {0x00A, 8},
+    {0x00B, 8}, {0x052, 8}, {0x053, 8}, {0x054, 8},
+    {0x055, 8}, {0x024, 8}, {0x025, 8}, {0x058, 8},
+    {0x059, 8}, {0x05A, 8}, {0x05B, 8}, {0x04A, 8},
+    {0x04B, 8}, {0x032, 8}, {0x033, 8}, {0x034, 8},
+};
+
+constexpr Code WhiteMakeup[] = {
+    {0x01B, 5}, {0x012, 5}, {0x017, 6}, {0x037, 7},
+    {0x036, 8}, {0x037, 8}, {0x064, 8}, {0x065, 8},
+    {0x068, 8}, {0x067, 8}, {0x0CC, 9}, {0x0CD, 9},
+    {0x0D2, 9}, {0x0D3, 9}, {0x0D4, 9}, {0x0D5, 9},
+    {0x0D6, 9}, {0x0D7, 9}, {0x0D8, 9}, {0x0D9, 9},
+    {0x0DA, 9}, {0x0DB, 9}, {0x098, 9}, {0x099, 9},
+    {0x09A, 9}, {0x018, 6}, {0x09B, 9},
+};
+
+constexpr Code BlackTerminating[] = {
+    {0x037, 10}, {0x002, 3}, {0x003, 2}, {0x002, 2},
+    {0x003, 3}, {0x003, 4}, {0x002, 4}, {0x003, 5},
+    {0x005, 6}, {0x004, 6}, {0x004, 7}, {0x005, 7},
+    {0x007, 7}, {0x004, 8}, {0x007, 8}, {0x018, 9},
+    {0x017, 10}, {0x018, 10}, {0x008, 10}, {0x067, 11},
+    {0x068, 11}, {0x06C, 11}, {0x037, 11}, {0x028, 11},
+    {0x017, 11}, {0x018, 11}, {0x0CA, 12}, {0x0CB, 12},
+    {0x0CC, 12}, {0x0CD, 12}, {0x068, 12}, {0x069, 12},
+    {0x06A, 12}, {0x06B, 12}, {0x0D2, 12}, {0x0D3, 12},
+    {0x0D4, 12}, {0x0D5, 12}, {0x0D6, 12}, {0x0D7, 12},
+    {0x06C, 12}, {0x06D, 12}, {0x0DA, 12}, {0x0DB, 12},
+    {0x054, 12}, {0x055, 12}, {0x056, 12}, {0x057, 12},
+    {0x064, 12}, {0x065, 12}, {0x052, 12}, {0x053, 12},
+    {0x024, 12}, {0x037, 12}, {0x038, 12}, {0x027, 12},
+    {0x028, 12}, {0x058, 12}, {0x059, 12}, {0x02B, 12},
+    {0x02C, 12}, {0x05A, 12}, {0x066, 12}, {0x067, 12},
+};
+
+constexpr Code BlackMakeup[] = {
+    {0x00F, 10}, {0x0C8, 12}, {0x0C9, 12}, {0x05B, 12},
+    {0x033, 12}, {0x034, 12}, {0x035, 12}, {0x06C, 13},
+    {0x06D, 13}, {0x04A, 13}, {0x04B, 13}, {0x04C, 13},
+    {0x04D, 13}, {0x072, 13}, {0x073, 13}, {0x074, 13},
+    {0x075, 13}, {0x076, 13}, {0x077, 13}, {0x052, 13},
+    {0x053, 13}, {0x054, 13}, {0x055, 13}, {0x05A, 13},
+    {0x05B, 13}, {0x064, 13}, {0x065, 13},
+};
+
+constexpr Code ExtendedMakeup[] = {
+    {0x008, 11}, {0x00C, 11}, {0x00D, 11}, {0x012, 12},
+    {0x013, 12}, {0x014, 12}, {0x015, 12}, {0x016, 12},
+    {0x017, 12}, {0x01C, 12}, {0x01D, 12}, {0x01E, 12},
+    {0x01F, 12},
+};
+constexpr size_t MAX_MAKEUP = 2560;
+constexpr size_t FIRST_EXTENDED = 1792;
+
+// Vertical mode codes for a1 - b1 = -3 .. 3
+constexpr Code Vertical[] = {
+    {0x02, 7}, {0x02, 6}, {0x02, 3}, {0x01, 1}, {0x03, 3}, {0x03, 6}, {0x03, 7},
+};
+constexpr Code Pass = {0x1, 4};
+constexpr Code Horizontal = {0x1, 3};
+constexpr Code EndOfLine = {0x001, 12};
+
+} // namespace
+
+// =============================================================================
+
+G4Encoder::G4Encoder(size_t width) :
+    width_(width),
+    reference_(SENTINELS, width),
+    bits_(0),
+    n_bits_(0)
+{}
+
+// =============================================================================
+
+// Mode selection of T.6 section 2.2: a0 is the last coded position of the row
+// (-1 before the first pixel), a1 and a2 the next changes of the row, b1 the next
+// change of the reference row to the color opposite to a0 and b2 the change after it
+void G4Encoder::Row(std::span<const uint8_t> pixels)
+{
+    FindChanges(pixels, coding_);
+
+    const int64_t width = static_cast<int64_t>(width_);
+    int64_t a0 = -1;
+    bool black = false;
+    size_t i = 0;
+    size_t j = 0;
+    while (a0 < width)
+    {
+        while (static_cast<int64_t>(coding_[i]) <= a0)
+            i++;
+        // a0 can move left of a change of the reference row skipped before
+        while (j > 0 && static_cast<int64_t>(reference_[j - 1]) > a0)
+            j--;
+        while (static_cast<int64_t>(reference_[j]) <= a0)
+            j++;
+        // even changes turn pixels black
+        if ((j % 2 == 1) != black)
+            j++;
+
+        const int64_t a1 = coding_[i];
+        const int64_t b1 = reference_[j];
+        const int64_t b2 = reference_[j + 1];
+        if (b2 < a1)
+        {
+            PutBits(Pass.code, Pass.length);
+            a0 = b2;
+        }
+        else if (a1 - b1 >= -3 && a1 - b1 <= 3)
+        {
+            const Code& code = Vertical[a1 - b1 + 3];
+            PutBits(code.code, code.length);
+            a0 = a1;
+            black = !black;
+        }
+        else
+        {
+            const int64_t a2 = coding_[i + 1];
+            PutBits(Horizontal.code, Horizontal.length);
+            PutRun(a1 - std::max<int64_t>(a0, 0), black);
+            PutRun(a2 - a1, !black);
+            a0 = a2;
+        }
+    }
+
+    std::swap(reference_, coding_);
+}
+
+// =============================================================================
+
+void G4Encoder::Finish()
+{
+    PutBits(EndOfLine.code, EndOfLine.length);
+    PutBits(EndOfLine.code, EndOfLine.length);
+    if (n_bits_ > 0)
+        PutBits(0, BITS_PER_BYTE - n_bits_);
+}
+
+// =============================================================================
+
+// Whole bytes of the current color are skipped at once
+void G4Encoder::FindChanges(std::span<const uint8_t> pixels, std::vector<size_t>& changes) const
+{
+    changes.clear();
+    const size_t stride = (width_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    uint8_t invert = 0;
+    size_t x = 0;
+    while (x < width_)
+    {
+        size_t byte = x / BITS_PER_BYTE;
+        uint8_t bits = (pixels[byte] ^ invert) & (0xFF >> (x % BITS_PER_BYTE));
+        while (bits == 0 && ++byte < stride)
+            bits = pixels[byte] ^ invert;
+        if (bits == 0)
+            break;
+
+        x = byte * BITS_PER_BYTE + std::countl_zero(bits);
+        if (x >= width_)
+            break;
+        changes.push_back(x);
+        invert = ~invert;
+    }
+    changes.insert(changes.end(), SENTINELS, width_);
+}
+
+// =============================================================================
+
+void G4Encoder::PutBits(uint32_t code, int length)
+{
+    bits_ = (bits_ << length) | code;
+    n_bits_ += length;
+    while (n_bits_ >= static_cast<int>(BITS_PER_BYTE))
+    {
+        n_bits_ -= BITS_PER_BYTE;
+        output_.push_back(static_cast<uint8_t>(bits_ >> n_bits_));
+    }
+}
+
+void G4Encoder::PutRun(size_t run, bool black)
+{
+    const Code* terminating = black ? BlackTerminating : WhiteTerminating;
+    const Code* makeup = black ? BlackMakeup : WhiteMakeup;
+
+    for (; run > MAX_MAKEUP + 63; run -= MAX_MAKEUP)
+        PutBits(ExtendedMakeup[std::size(ExtendedMakeup) - 1].code, ExtendedMakeup[std::size(ExtendedMakeup) - 1].length);
+    if (run >= 64)
+    {
+        size_t length = run & ~size_t(63);
+        const Code& code = length >= FIRST_EXTENDED ? ExtendedMakeup[(length - FIRST_EXTENDED) / 64]
+                                                    : makeup[length / 64 - 1];
+        PutBits(code.code, code.length);
+        run -= length;
+    }
+    PutBits(terminating[run].code, terminating[run].length);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
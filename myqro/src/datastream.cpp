@@ -1,7 +1,9 @@
 #include "datastream.hpp"
 
 #include <format>
+#include <memory>
 
+#include "core.hpp"
 #include "defines.hpp"
 #include "error.hpp"
 
@@ -173,30 +175,11 @@ void DebugArray(const ArrayType& array, std::ostream& s)
 //      по модулю 2 (XOR, во многих языках программирования оператор ^) с i-м значением
 //      подготовленного массива и записать полученное значение в i-ю ячейку подготовленного массива.
 
-// TODO: use cyclic buffer instead of erase+push_back?
+// The same algorithm with a shift register instead of erase+push_back is in core::CorrectionBytes
 ArrayType GenerateCorrectionBlock(const Block& block, size_t n_correction_bytes)
 {
-    const auto& poly = GeneratingPolynomial.at(n_correction_bytes);
-
-    ArrayType result;
-    result.resize(std::max(block.Size(), n_correction_bytes));
-    std::copy(block.begin, block.end, result.begin());
-    for (size_t j = 0; j < block.Size(); j++)
-    {
-        uint8_t A = result.front();
-        result.erase(result.begin());
-        result.push_back(0);
-
-        if (A == 0) continue;
-
-        size_t B = static_cast<size_t>(ReverseGaloisField[A]);
-        for (size_t i = 0; i < n_correction_bytes; i++)
-        {
-            uint8_t C = (poly[i] + B) % 255;
-            result[i] ^= GaloisField[C];
-        }
-    }
-
+    ArrayType result(std::max(block.Size(), n_correction_bytes), 0);
+    core::CorrectionBytes(std::to_address(block.begin), block.Size(), n_correction_bytes, result.data());
     return result;
 }
 
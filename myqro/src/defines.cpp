@@ -1,7 +1,7 @@
 #include "defines.hpp"
 
 #include <format>
-// #include <stdexcept>
+#include <stdexcept>
 
 #include "error.hpp"
 
@@ -13,6 +13,13 @@ namespace myqro
 
 // =============================================================================
 
+void ThrowOutOfRange(const char* what)
+{
+    throw std::out_of_range(what);
+}
+
+// =============================================================================
+
 EncodingType EncodingTypeFromString(const std::string& type_str)
 {
     if (type_str == "num")   return EncodingType::NUNERIC;
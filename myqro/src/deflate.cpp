@@ -0,0 +1,380 @@
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+
+#include "error.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+constexpr std::array<uint32_t, 256> MakeCrcTable()
+{
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t n = 0; n < table.size(); n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CrcTable = MakeCrcTable();
+
+constexpr uint32_t ADLER_MOD = 65521;
+constexpr size_t ADLER_CHUNK = 5552;            // max bytes before the sums may overflow
+
+constexpr size_t WINDOW_SIZE = 1 << 15;
+constexpr size_t HASH_SIZE = 1 << 15;
+constexpr size_t MIN_MATCH = 3;
+constexpr size_t MAX_MATCH = 258;
+constexpr size_t MAX_STORED = 65535;
+
+constexpr std::array<size_t, 10> MaxChain = {0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+
+constexpr std::array<uint16_t, 29> LengthBase = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+constexpr std::array<uint8_t, 29> LengthExtra = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+constexpr std::array<uint16_t, 30> DistanceBase = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+constexpr std::array<uint8_t, 30> DistanceExtra = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+constexpr uint32_t END_OF_BLOCK = 256;
+constexpr uint32_t FIRST_LENGTH_CODE = 257;
+
+} // namespace
+
+// =============================================================================
+
+uint32_t Crc32(std::span<const uint8_t> data, uint32_t crc)
+{
+    crc ^= 0xFFFFFFFF;
+    for (uint8_t byte: data)
+        crc = CrcTable[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+uint32_t Adler32(std::span<const uint8_t> data, uint32_t adler)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (!data.empty())
+    {
+        size_t n = std::min(data.size(), ADLER_CHUNK);
+        for (uint8_t byte: data.first(n))
+        {
+            a += byte;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+        data = data.subspan(n);
+    }
+    return (b << 16) | a;
+}
+
+// =============================================================================
+
+Deflater::Deflater(DeflateFormat format, int level) :
+    format_(format),
+    level_(level),
+    max_chain_(0),
+    finished_(false),
+    crc_(0),
+    adler_(1),
+    input_size_(0),
+    base_(0),
+    pos_(0),
+    bits_(0),
+    n_bits_(0)
+{
+    if (level < 0 || level >= static_cast<int>(MaxChain.size()))
+        throw Error(std::format("Deflate level must be in range [0, {}], got {}", MaxChain.size() - 1, level));
+
+    max_chain_ = MaxChain[level];
+    if (level_ > 0)
+    {
+        head_.assign(HASH_SIZE, 0);
+        prev_.assign(WINDOW_SIZE, 0);
+    }
+
+    WriteHeader();
+
+    // all the data goes into one fixed Huffman block, the final block is empty
+    if (level_ > 0)
+    {
+        PutBits(0, 1);
+        PutBits(1, 2);
+    }
+}
+
+std::vector<uint8_t> Deflater::Compress(std::span<const uint8_t> data, DeflateFormat format, int level)
+{
+    Deflater deflater(format, level);
+    deflater.Write(data);
+    deflater.Finish();
+    return std::move(deflater.Output());
+}
+
+// =============================================================================
+
+void Deflater::Write(std::span<const uint8_t> data)
+{
+    if (finished_)
+        throw Error("Deflate stream is already finished");
+
+    if (format_ == DeflateFormat::GZIP)
+        crc_ = Crc32(data, crc_);
+    else if (format_ == DeflateFormat::ZLIB)
+        adler_ = Adler32(data, adler_);
+    input_size_ += static_cast<uint32_t>(data.size());
+
+    window_.insert(window_.end(), data.begin(), data.end());
+    if (level_ > 0)
+        Deflate(false);
+    else
+        Store(false);
+}
+
+void Deflater::Finish()
+{
+    if (finished_)
+        return;
+
+    if (level_ > 0)
+    {
+        Deflate(true);
+        Symbol(END_OF_BLOCK);
+        PutBits(1, 1);
+        PutBits(1, 2);
+        Symbol(END_OF_BLOCK);
+        AlignToByte();
+    }
+    else
+    {
+        Store(true);
+    }
+
+    WriteTrailer();
+    finished_ = true;
+}
+
+// =============================================================================
+
+void Deflater::WriteHeader()
+{
+    if (format_ == DeflateFormat::ZLIB)
+    {
+        // 32K window, the level hint only
+        uint8_t flags = (level_ <= 1) ? 0x01 : (level_ <= 5) ? 0x5E : (level_ == 6) ? 0x9C : 0xDA;
+        output_.insert(output_.end(), {0x78, flags});
+    }
+    else if (format_ == DeflateFormat::GZIP)
+    {
+        // no name, no modification time, unknown OS
+        output_.insert(output_.end(), {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF});
+    }
+}
+
+void Deflater::WriteTrailer()
+{
+    auto put = [this](uint32_t value, bool big_endian)
+    {
+        for (int i = 0; i < 4; i++)
+            output_.push_back(static_cast<uint8_t>(value >> (big_endian ? 24 - 8 * i : 8 * i)));
+    };
+
+    if (format_ == DeflateFormat::ZLIB)
+        put(adler_, true);
+    else if (format_ == DeflateFormat::GZIP)
+    {
+        put(crc_, false);
+        put(input_size_, false);
+    }
+}
+
+// =============================================================================
+
+void Deflater::Deflate(bool finish)
+{
+    const size_t end = base_ + window_.size();
+    while (pos_ < end)
+    {
+        // wait for more input unless the longest match fits
+        if (!finish && end - pos_ < MAX_MATCH)
+            break;
+
+        size_t distance = 0;
+        size_t length = LongestMatch(pos_, end, distance);
+        if (length >= MIN_MATCH)
+        {
+            Match(length, distance);
+            for (size_t i = 0; i < length; i++)
+                Insert(pos_ + i);
+            pos_ += length;
+        }
+        else
+        {
+            Literal(At(pos_));
+            Insert(pos_);
+            pos_++;
+        }
+    }
+
+    // keep the last window of history only
+    if (pos_ - base_ > 2 * WINDOW_SIZE)
+    {
+        size_t drop = pos_ - base_ - WINDOW_SIZE;
+        window_.erase(window_.begin(), window_.begin() + drop);
+        base_ += drop;
+    }
+}
+
+void Deflater::Store(bool finish)
+{
+    size_t offset = 0;
+    while (window_.size() - offset >= MAX_STORED || finish)
+    {
+        size_t length = std::min(window_.size() - offset, MAX_STORED);
+        bool last = finish && offset + length == window_.size();
+
+        PutBits(last ? 1 : 0, 1);
+        PutBits(0, 2);
+        AlignToByte();
+        output_.insert(output_.end(), {static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+                                       static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8)});
+        output_.insert(output_.end(), window_.begin() + offset, window_.begin() + offset + length);
+        offset += length;
+
+        if (last)
+            break;
+    }
+    window_.erase(window_.begin(), window_.begin() + offset);
+}
+
+// =============================================================================
+
+void Deflater::Insert(size_t pos)
+{
+    if (pos + MIN_MATCH > base_ + window_.size())
+        return;
+
+    size_t hash = ((At(pos) << 10) ^ (At(pos + 1) << 5) ^ At(pos + 2)) & (HASH_SIZE - 1);
+    prev_[pos & (WINDOW_SIZE - 1)] = head_[hash];
+    head_[hash] = pos + 1;
+}
+
+size_t Deflater::LongestMatch(size_t pos, size_t end, size_t& distance) const
+{
+    const size_t limit = std::min(end - pos, MAX_MATCH);
+    if (limit < MIN_MATCH)
+        return 0;
+
+    size_t hash = ((At(pos) << 10) ^ (At(pos + 1) << 5) ^ At(pos + 2)) & (HASH_SIZE - 1);
+    size_t best = 0;
+    size_t candidate = head_[hash];
+    for (size_t chain = max_chain_; candidate != 0 && chain > 0; chain--)
+    {
+        size_t start = candidate - 1;
+        if (start >= pos || pos - start > WINDOW_SIZE)
+            break;
+
+        size_t length = 0;
+        while (length < limit && At(start + length) == At(pos + length))
+            length++;
+
+        if (length > best)
+        {
+            best = length;
+            distance = pos - start;
+            if (length == limit)
+                break;
+        }
+        candidate = prev_[start & (WINDOW_SIZE - 1)];
+    }
+    return best;
+}
+
+// =============================================================================
+
+void Deflater::PutBits(uint32_t value, int count)
+{
+    bits_ |= static_cast<uint64_t>(value) << n_bits_;
+    n_bits_ += count;
+    while (n_bits_ >= 8)
+    {
+        output_.push_back(static_cast<uint8_t>(bits_));
+        bits_ >>= 8;
+        n_bits_ -= 8;
+    }
+}
+
+void Deflater::PutCode(uint32_t code, int length)
+{
+    // Huffman codes are packed starting from the most significant bit
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    PutBits(reversed, length);
+}
+
+void Deflater::AlignToByte()
+{
+    if (n_bits_ > 0)
+        PutBits(0, 8 - n_bits_);
+}
+
+void Deflater::Symbol(uint32_t symbol)
+{
+    if (symbol < 144)
+        PutCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        PutCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        PutCode(symbol - 256, 7);
+    else
+        PutCode(0xC0 + symbol - 280, 8);
+}
+
+void Deflater::Literal(uint8_t byte)
+{
+    Symbol(byte);
+}
+
+void Deflater::Match(size_t length, size_t distance)
+{
+    size_t code = std::upper_bound(LengthBase.begin(), LengthBase.end(), length) - LengthBase.begin() - 1;
+    Symbol(FIRST_LENGTH_CODE + code);
+    PutBits(length - LengthBase[code], LengthExtra[code]);
+
+    code = std::upper_bound(DistanceBase.begin(), DistanceBase.end(), distance) - DistanceBase.begin() - 1;
+    PutCode(code, 5);
+    PutBits(distance - DistanceBase[code], DistanceExtra[code]);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -3,7 +3,10 @@
 #include <algorithm>
 #include <format>
 
+#include "core.hpp"
 #include "logger.hpp"
+#include "reed_solomon.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 
@@ -14,53 +17,65 @@ namespace myqro
 
 // =============================================================================
 
+namespace
+{
+
+// Writer of core::AppendPayload
+struct StreamWriter
+{
+    DataStream& stream;
+
+    void Append(uint32_t value, size_t width) { stream.AppendBits(value, static_cast<uint8_t>(width)); }
+};
+
+} // namespace
+
+// =============================================================================
+
 // TODO: implement mixed encoding strategy (split string into chunks and encode them separately)
-Context EncodeProvider::Encode(const std::string& data, CorrectionLevel cl) const
+Context EncodeProvider::Encode(const std::string& data, CorrectionLevel cl, const EncodeOptions& options) const
+{
+    Context context = PrepareData(data, cl, options);
+    PrepareBlocks(context);
+    PrepareOutput(context);
+
+    return context;
+}
+
+Context EncodeProvider::PrepareData(const std::string& data, CorrectionLevel cl, const EncodeOptions& options) const
 {
     if (!IsDataSupported(data))
         throw Error(std::format("Unsupported data for {}: {}", GetProviderName(), data));
 
     Context context(data, cl);
+    context.options = options;
     ConvertInput(data, context);
     PrepareServiceFields(context);
     AddTailZeros(context);
     AddRequiredVersionTailBytes(context);
-    PrepareBlocks(context);
-    PrepareOutput(context);
 
     return context;
 }
 
 void EncodeProvider::PrepareServiceFields(Context& context) const
 {
-    auto [version, max_data_size] = EstimateVersion(context.stream, context.cl);
-    LogDebug("Estimated version={} max_data_size={}", version, max_data_size);
-
-    size_t max_version = (version <= 9) ? 9 : (version <= 26) ? 26 : MAX_VERSION;
     EncodingType encoding = GetEncodingType();
+    core::Layout layout;
+    if (core::ChooseLayout(context.stream.Size(), encoding, context.cl, layout) != core::Status::OK)
+        throw Error(std::format("Data stream ({}) with service fields is too big for correction level {}",
+                                context.stream.Size(), CorrectionLevelToString(context.cl)));
+    LogDebug("Estimated version={} max_data_size={}", layout.version, layout.max_data_size);
 
-    context.data_size_field_width = DataSizeFieldWidth.at(encoding).at(max_version);
-
-    if (context.stream.Size() + context.data_size_field_width + context.encoding_field_width > max_data_size)
-    {
-        version += 1;
-        if (version > MAX_VERSION)
-            throw Error(std::format("Data stream ({}) with service fields ({}, {}) "
-                                    "is too big for correction level {}",
-                                    context.stream.Size(), context.encoding_field_width,
-                                    context.data_size_field_width,
-                                    CorrectionLevelToString(context.cl)));
-        max_data_size = VersionCorrectionMaxDataSize.at(context.cl).at(version - 1);
-    }
+    context.data_size_field_width = layout.data_size_field_width;
 
     DataStream result;
     result.AppendBits(static_cast<uint8_t>(encoding), context.encoding_field_width);
     result.AppendBits(context.input_data_size, context.data_size_field_width);
     result << context.stream;
 
-    context.version = version;
+    context.version = layout.version;
     context.stream = result;
-    context.max_data_size = max_data_size;
+    context.max_data_size = layout.max_data_size;
 }
 
 void EncodeProvider::AddTailZeros(Context& context) const
@@ -94,9 +109,47 @@ void EncodeProvider::PrepareBlocks(Context& context) const
     LogDebug("# of corr bytes: {}", n_correction_bytes);
 
     context.data_blocks = context.stream.GenerateBlocks(blocks_count);
-    context.correction_blocks.reserve(blocks_count);
-    for (const Block& block: context.data_blocks)
-        context.correction_blocks.push_back(GenerateCorrectionBlock(block, n_correction_bytes));
+    context.correction_blocks.resize(blocks_count);
+
+    size_t min_cost = context.options.parallel_blocks_min_cost;
+    size_t cost = context.stream.ByteSize() * n_correction_bytes;
+    bool parallel = min_cost > 0 && cost >= min_cost && blocks_count > 1 && ThreadPool::Shared().WorkersCount() > 0;
+
+    // Blocks of equal size are encoded together in lanes. For concurrent generation
+    // every such group is split further into one range per pool thread.
+    size_t n_ranges_per_group = parallel ? ThreadPool::Shared().WorkersCount() + 1 : 1;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t begin = 0; begin < blocks_count;)
+    {
+        size_t end = begin;
+        while (end < blocks_count && context.data_blocks[end].Size() == context.data_blocks[begin].Size())
+            end++;
+
+        size_t step = (end - begin + n_ranges_per_group - 1) / n_ranges_per_group;
+        for (size_t b = begin; b < end; b += step)
+            ranges.emplace_back(b, std::min(b + step, end));
+        begin = end;
+    }
+
+    // every range writes only its own correction blocks
+    auto generate = [&context, &ranges, n_correction_bytes](size_t i)
+    {
+        auto [begin, end] = ranges[i];
+        std::span<const Block> blocks(context.data_blocks.begin() + begin, context.data_blocks.begin() + end);
+        std::vector<ArrayType> result = GenerateCorrectionBlocks(blocks, n_correction_bytes);
+        std::move(result.begin(), result.end(), context.correction_blocks.begin() + begin);
+    };
+
+    if (parallel && ranges.size() > 1)
+    {
+        LogDebug("Generating correction blocks concurrently, cost={}", cost);
+        ThreadPool::Shared().ParallelFor(ranges.size(), generate);
+    }
+    else
+    {
+        for (size_t i = 0; i < ranges.size(); i++)
+            generate(i);
+    }
 }
 
 void EncodeProvider::PrepareOutput(Context& context) const
@@ -123,85 +176,34 @@ void EncodeProvider::PrepareOutput(Context& context) const
     }
 }
 
-std::pair<size_t, size_t> EncodeProvider::EstimateVersion(const DataStream& stream, CorrectionLevel cl)
-{
-    const auto& sizes = VersionCorrectionMaxDataSize.at(cl);
-    size_t version = 1;
-    for (; version <= MAX_VERSION; version++)
-    {
-        if (sizes[version - 1] > stream.Size())
-            return {version, sizes[version - 1]};
-    }
-    throw Error(std::format("No versions available for correction level {} and data bit size {}",
-                            CorrectionLevelToString(cl) ,stream.Size()));
-};
-
-// =============================================================================
-
-const std::unordered_map<char, uint8_t> AlphaNumericEncodeProvider::chars_ = {
-    {'0', 0},  {'1', 1},  {'2', 2},  {'3', 3},  {'4', 4},  {'5', 5},  {'6', 6},  {'7', 7},  {'8', 8},  {'9', 9},
-    {'A', 10}, {'B', 11}, {'C', 12}, {'D', 13}, {'E', 14}, {'F', 15}, {'G', 16}, {'H', 17}, {'I', 18}, {'J', 19},
-    {'K', 20}, {'L', 21}, {'M', 22}, {'N', 23}, {'O', 24}, {'P', 25}, {'Q', 26}, {'R', 27}, {'S', 28}, {'T', 29},
-    {'U', 30}, {'V', 31}, {'W', 32}, {'X', 33}, {'Y', 34}, {'Z', 35}, {' ', 36}, {'$', 37}, {'%', 38}, {'*', 39},
-    {'+', 40}, {'-', 41}, {'.', 42}, {'/', 43}, {':', 44}
-};
-
 // =============================================================================
 
 bool AlphaNumericEncodeProvider::IsDataSupported(const std::string& data) const
 {
-    return std::all_of(data.begin(), data.end(), [](char c){ return chars_.count(c) > 0;});
+    return core::IsDataSupported(data.data(), data.size(), EncodingType::ALPHANUMERIC);
 }
 
 // =============================================================================
 
 void AlphaNumericEncodeProvider::ConvertInput(const std::string& data, Context& context) const
 {
-    static const size_t max_mask_size = 2;
-    static const std::array<uint8_t, max_mask_size> mask_sizes{6, 11};
-
-    for (size_t i = 0; i < data.size(); i += max_mask_size)
-    {
-        size_t tail = std::min(data.size() - i, max_mask_size);
-        uint8_t mask_size = mask_sizes[tail - 1];
-
-        uint16_t result = 0;
-        for (size_t j = 0; j < tail; j++)
-            result = result * 45 + chars_.at(data[i+j]);
-
-        context.stream.AppendBits(result, mask_size);
-    }
+    StreamWriter writer{context.stream};
+    core::AppendPayload(data.data(), data.size(), EncodingType::ALPHANUMERIC, writer);
 }
 
 // =============================================================================
 
-const std::unordered_set<char> NumericEncodeProvider::digits_ = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
-
-// =============================================================================
-
 bool NumericEncodeProvider::IsDataSupported(const std::string& data) const
 {
-    return std::all_of(data.begin(), data.end(), [](char c){ return digits_.count(c) > 0;});
+    return core::IsDataSupported(data.data(), data.size(), EncodingType::NUNERIC);
 }
 
 // =============================================================================
 
 void NumericEncodeProvider::ConvertInput(const std::string& data, Context& context) const
 {
-    static const size_t max_mask_size = 3;
-    static const std::array<uint8_t, max_mask_size> mask_sizes{4, 7, 10};
-
-    for (size_t i = 0; i < data.size(); i += max_mask_size)
-    {
-        size_t tail = std::min(data.size() - i, max_mask_size);
-        uint8_t mask_size = mask_sizes[tail - 1];
-
-        uint16_t result = 0;
-        for (size_t j = 0; j < tail; j++)
-            result = result * 10 + (data[i+j] - '0');
-
-        context.stream.AppendBits(result, mask_size);
-    }
+    StreamWriter writer{context.stream};
+    core::AppendPayload(data.data(), data.size(), EncodingType::NUNERIC, writer);
 }
 
 // =============================================================================
@@ -216,8 +218,8 @@ bool BytesEncodeProvider::IsDataSupported(const std::string&) const
 
 void BytesEncodeProvider::ConvertInput(const std::string& data, Context& context) const
 {
-    for (char c : data)
-        context.stream.AppendBits(static_cast<uint8_t>(c), BITS_PER_BYTE);
+    StreamWriter writer{context.stream};
+    core::AppendPayload(data.data(), data.size(), EncodingType::BYTES, writer);
 }
 
 // =============================================================================
@@ -1,8 +1,11 @@
 #include "encoder.hpp"
 
+#include <array>
 #include <limits>
 
+#include "fixed_canvas.hpp"
 #include "logger.hpp"
+#include "thread_pool.hpp"
 
 
 // =============================================================================
@@ -13,45 +16,48 @@ namespace myqro
 // =============================================================================
 
 Canvas Encoder::Encode(const std::string& msg, CorrectionLevel cl,
-                       EncodingType encoding, int mask_id)
+                       EncodingType encoding, int mask_id, const EncodeOptions& options)
 {
     EncodeProviderPtr provider = EncodeProviderFactory::GetProvider(encoding);
 
-    Context ctx = provider->Encode(msg, cl);
-    Canvas canvas = Canvas(ctx.version);
+    Context ctx = provider->Encode(msg, cl, options);
+    return EncodeFixedCanvas(ctx.version, ctx.cl, mask_id, DataStream(std::move(ctx.output)), ctx.options);
+}
 
-    canvas.SetupSearchPatterns();
-    canvas.SetupLevelingPatterns();
-    canvas.SetupSyncLines();
-    canvas.SetupVersionCode();
+Canvas Encoder::CreateCanvas(size_t version)
+{
+    return CreateFixedCanvas(version);
+}
+
+size_t Encoder::ChooseMask(size_t version, const EncodeOptions& options, const std::function<size_t(size_t)>& trial)
+{
+    std::array<size_t, MASK_ARRAY_SIZE> penalties;
+    auto run = [&penalties, &trial](size_t mask_id) { penalties[mask_id] = trial(mask_id); };
 
-    if (mask_id < 0)
+    size_t min_version = options.parallel_mask_min_version;
+    if (min_version > 0 && version >= min_version)
     {
-        LogDebug("Choosing best mask");
-        return FindBestMask(canvas, ctx);
+        LogDebug("Evaluating masks concurrently");
+        ThreadPool::Shared().ParallelFor(MASK_ARRAY_SIZE, run);
+    }
+    else
+    {
+        for (size_t mask_id = MIN_MASK_ID; mask_id <= MAX_MASK_ID; ++mask_id)
+            run(mask_id);
     }
 
-    canvas.FillData(ctx.cl, mask_id, DataStream(std::move(ctx.output)));
-    return canvas;
-}
-
-Canvas Encoder::FindBestMask(Canvas& c, const Context& ctx)
-{
-    std::vector<Canvas> tries(MASK_ARRAY_SIZE, c);
     size_t max_penalty = std::numeric_limits<size_t>::max();
     size_t idx = MIN_MASK_ID;
     for (size_t mask_id = MIN_MASK_ID; mask_id <= MAX_MASK_ID; ++mask_id)
     {
-        tries[mask_id].FillData(ctx.cl, mask_id, DataStream(ctx.output));
-        size_t penalty = tries[mask_id].Penalty(mask_id);
-        if (penalty < max_penalty)
+        if (penalties[mask_id] < max_penalty)
         {
-            max_penalty = penalty;
+            max_penalty = penalties[mask_id];
             idx = mask_id;
         }
     }
     LogDebug("Choose best mask: {}, penalty={}", idx, max_penalty);
-    return tries[idx];
+    return idx;
 }
 
 // =============================================================================
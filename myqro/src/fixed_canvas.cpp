@@ -0,0 +1,93 @@
+#include "fixed_canvas.hpp"
+
+#include <format>
+#include <utility>
+
+#include "encoder.hpp"
+#include "error.hpp"
+#include "logger.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+template <size_t V>
+Canvas CreateVersion()
+{
+    return std::make_unique<FixedCanvas<V>>()->ToCanvas();
+}
+
+template <size_t V>
+Canvas EncodeVersion(CorrectionLevel cl, int mask_id, const DataStream& stream, const EncodeOptions& options)
+{
+    // large versions don't fit well on the stack, so canvases always live on the heap
+    auto canvas = std::make_unique<FixedCanvas<V>>();
+
+    if (mask_id < 0)
+    {
+        LogDebug("Choosing best mask");
+
+        // every trial gets its own copy of the canvas, so they can be run concurrently
+        mask_id = Encoder::ChooseMask(V, options, [&canvas, cl, &stream](size_t id)
+        {
+            auto trial = std::make_unique<FixedCanvas<V>>(*canvas);
+            trial->FillData(cl, id, stream);
+            return trial->Penalty(id);
+        });
+    }
+
+    canvas->FillData(cl, mask_id, stream);
+    return canvas->ToCanvas();
+}
+
+struct VersionEntry
+{
+    Canvas (*create)();
+    Canvas (*encode)(CorrectionLevel cl, int mask_id, const DataStream& stream, const EncodeOptions& options);
+};
+
+template <size_t... I>
+constexpr std::array<VersionEntry, sizeof...(I)> MakeVersionTable(std::index_sequence<I...>)
+{
+    return {VersionEntry{&CreateVersion<I + MIN_VERSION>, &EncodeVersion<I + MIN_VERSION>}...};
+}
+
+constexpr std::array<VersionEntry, VERSION_ARRAY_SIZE> VersionTable =
+    MakeVersionTable(std::make_index_sequence<VERSION_ARRAY_SIZE>());
+
+const VersionEntry& GetVersionEntry(size_t version)
+{
+    if (version < MIN_VERSION || version > MAX_VERSION)
+        throw Error(std::format("No such version: {}", version));
+    return VersionTable[version - MIN_VERSION];
+}
+
+} // namespace
+
+// =============================================================================
+
+Canvas CreateFixedCanvas(size_t version)
+{
+    return GetVersionEntry(version).create();
+}
+
+// =============================================================================
+
+Canvas EncodeFixedCanvas(size_t version, CorrectionLevel cl, int mask_id, const DataStream& stream,
+                         const EncodeOptions& options)
+{
+    return GetVersionEntry(version).encode(cl, mask_id, stream, options);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
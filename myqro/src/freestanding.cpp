@@ -0,0 +1,55 @@
+#include "freestanding.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+core::Status EncodeInto(const char* data, size_t length, CorrectionLevel cl, EncodingType encoding, int mask_id,
+                        std::span<uint8_t> codewords, std::span<uint8_t> modules, SymbolRef& symbol)
+{
+    size_t version = 0;
+    core::Status status = core::EncodeCodewords(data, length, encoding, cl, codewords.data(), codewords.size(), version);
+    if (status != core::Status::OK)
+        return status;
+
+    size_t chosen_mask = 0;
+    status = core::RenderModules(codewords.data(), version, cl, mask_id, modules.data(), modules.size(), chosen_mask);
+    if (status != core::Status::OK)
+        return status;
+
+    symbol.version = version;
+    symbol.size = SymbolSize(version);
+    symbol.mask_id = chosen_mask;
+    symbol.modules = modules.data();
+    return core::Status::OK;
+}
+
+// =============================================================================
+
+core::Status PackRows(const SymbolRef& symbol, std::span<uint8_t> out, size_t stride)
+{
+    if (symbol.modules == nullptr)
+        return core::Status::INVALID_ARGUMENT;
+    if (stride * BITS_PER_BYTE < symbol.size || out.size() < stride * symbol.size)
+        return core::Status::BUFFER_TOO_SMALL;
+
+    for (size_t row = 0; row < symbol.size; row++)
+    {
+        uint8_t* dst = out.data() + row * stride;
+        for (size_t i = 0; i < stride; i++)
+            dst[i] = 0;
+        for (size_t col = 0; col < symbol.size; col++)
+            dst[col / BITS_PER_BYTE] |= symbol.At(row, col) << (BITS_PER_BYTE - 1 - col % BITS_PER_BYTE);
+    }
+    return core::Status::OK;
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
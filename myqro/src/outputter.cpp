@@ -1,5 +1,18 @@
 #include "outputter.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+
+#include "deflate.hpp"
+#include "raster.hpp"
+#include "row_sink.hpp"
+#include "simd.hpp"
+#include "utils.hpp"
+
 
 // =============================================================================
 
@@ -8,129 +21,866 @@ namespace myqro
 
 // =============================================================================
 
-void ConsoleOutputter::OutputImpl(const Canvas& canvas, const OutputOptions& options)
+namespace
 {
-    int size = (static_cast<int>(canvas.Size()) + 2*options.indent) * options.scale;
 
-    for (int row = 0; row < size; row++)
+// One character per pixel followed by a newline
+void RowToText(std::span<const uint8_t> pixels, size_t width, const char chars[2], std::string& line)
+{
+    line.resize(width + 1);
+    GetKernels().unpack_bits(pixels.data(), width, reinterpret_cast<uint8_t*>(line.data()));
+    for (size_t x = 0; x < width; x++)
+        line[x] = chars[static_cast<uint8_t>(line[x])];
+    line[width] = '\n';
+}
+
+// Text appended to a preallocated buffer, numbers are formatted with std::to_chars
+class TextBuffer
+{
+public:
+    TextBuffer(size_t capacity) { data_.reserve(capacity); }
+
+    TextBuffer& operator<<(std::string_view text)
     {
-        int r = row / options.scale;
-        for (int col = 0; col < size; col++)
+        data_.append(text);
+        return *this;
+    }
+
+    TextBuffer& operator<<(char c)
+    {
+        data_.push_back(c);
+        return *this;
+    }
+
+    TextBuffer& operator<<(int value)
+    {
+        char digits[16];
+        auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+        UNUSED(ec);
+        data_.append(digits, end);
+        return *this;
+    }
+
+    TextBuffer& operator<<(size_t value)
+    {
+        char digits[24];
+        auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+        UNUSED(ec);
+        data_.append(digits, end);
+        return *this;
+    }
+
+    size_t Size() const { return data_.size(); }
+    std::span<const uint8_t> Bytes() const { return std::span(reinterpret_cast<const uint8_t*>(data_.data()), data_.size()); }
+    void Clear() { data_.clear(); }
+
+    std::string Release() { return std::move(data_); }
+
+private:
+    std::string data_;
+};
+
+// ASCII85 encoding of a byte stream (PostScript level 2), lines are kept short
+class Ascii85Encoder
+{
+public:
+    Ascii85Encoder(TextBuffer& text) : text_(text), group_(0), n_bytes_(0), line_(0) {}
+
+    void Write(std::span<const uint8_t> data)
+    {
+        for (uint8_t byte: data)
+        {
+            group_ = (group_ << 8) | byte;
+            if (++n_bytes_ == 4)
+                Flush();
+        }
+    }
+
+    void Finish()
+    {
+        if (n_bytes_ > 0)
+            Flush();
+        text_ << "~>\n";
+    }
+
+private:
+    void Flush()
+    {
+        // a partial group is padded with zeros and written as n_bytes + 1 characters
+        size_t n_bytes = n_bytes_;
+        uint32_t value = group_ << (8 * (4 - n_bytes));
+        group_ = 0;
+        n_bytes_ = 0;
+
+        if (n_bytes == 4 && value == 0)
         {
-            int c = col / options.scale;
-            if (canvas.IsInside(r - options.indent, c - options.indent))
+            Put('z');
+            return;
+        }
+
+        char digits[5];
+        for (int i = 4; i >= 0; i--)
+        {
+            digits[i] = static_cast<char>('!' + value % 85);
+            value /= 85;
+        }
+        for (size_t i = 0; i <= n_bytes; i++)
+            Put(digits[i]);
+    }
+
+    void Put(char c)
+    {
+        text_ << c;
+        if (++line_ == LINE_SIZE)
+        {
+            text_ << '\n';
+            line_ = 0;
+        }
+    }
+
+private:
+    static constexpr size_t LINE_SIZE = 75;
+
+    TextBuffer& text_;
+    uint32_t group_;
+    size_t n_bytes_;
+    size_t line_;
+};
+
+// Calls rect(x, y, w, h) in modules for every horizontal run of dark modules.
+// With merge, runs equal to a run of the previous row extend its rectangle down
+// and rectangles are reported when they are closed.
+template<typename F>
+void ForEachRectangle(const SymbolRows& symbol, bool merge, F&& rect)
+{
+    struct Run
+    {
+        int x;
+        int w;
+        int y;          // first row of the rectangle
+    };
+    std::vector<Run> active, runs;
+    std::vector<uint8_t> values(symbol.Size());
+
+    for (size_t row = 0; row <= symbol.Size(); row++)
+    {
+        const int y = static_cast<int>(row);
+
+        runs.clear();
+        if (row < symbol.Size())
+        {
+            symbol.Row(row, values);
+            for (size_t col = 0; col < values.size();)
             {
-                const Cell& cell = canvas.At(r - options.indent, c - options.indent);
-                stream_ << " #"[cell.value];
+                if (values[col] == WHITE)
+                {
+                    col++;
+                    continue;
+                }
+                size_t end = col;
+                while (end < values.size() && values[end] == BLACK)
+                    end++;
+                runs.push_back({static_cast<int>(col), static_cast<int>(end - col), y});
+                col = end;
             }
-            else
+        }
+
+        if (!merge)
+        {
+            for (const Run& run: runs)
+                rect(run.x, run.y, run.w, 1);
+            continue;
+        }
+
+        size_t j = 0;
+        for (Run& run: runs)
+        {
+            while (j < active.size() && active[j].x < run.x)
             {
-                stream_ << ' ';
+                rect(active[j].x, active[j].y, active[j].w, y - active[j].y);
+                j++;
             }
+            if (j < active.size() && active[j].x == run.x && active[j].w == run.w)
+                run.y = active[j++].y;
         }
-        stream_ << std::endl;
+        for (; j < active.size(); j++)
+            rect(active[j].x, active[j].y, active[j].w, y - active[j].y);
+
+        std::swap(active, runs);
     }
 }
 
+// SVG document of the symbol. The text is handed to flush() whenever it grows
+// past `chunk` bytes, flush() empties it; the tail is left in the buffer.
+template<typename F>
+void WriteSvg(const SymbolRows& symbol, const OutputOptions& options, SvgShapes shapes, TextBuffer& text,
+              size_t chunk, F&& flush)
+{
+    const int size = static_cast<int>(symbol.Size()) + 2*options.indent;
+    const int pixels = size * options.scale;
+
+    text << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" "
+         << "\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n"
+         << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"" << pixels
+         << "\" height=\"" << pixels << "\" viewBox=\"0 0 " << size << " " << size << "\" stroke=\"none\">\n"
+         << "<rect width=\"100%\" height=\"100%\" fill=\"#FFFFFF\"/>\n"
+         << "<path d=\"";
+
+    // Subpaths are rectangles, each one starts relative to the start of the previous
+    // one, where `z` returns the current point
+    int px = 0, py = 0;
+    bool first = true;
+    ForEachRectangle(symbol, shapes == SvgShapes::RECTANGLES, [&](int x, int y, int w, int h)
+    {
+        x += options.indent;
+        y += options.indent;
+        if (first)
+            text << 'M' << x << ',' << y;
+        else
+            text << 'm' << x - px << ',' << y - py;
+        text << 'h' << w << 'v' << h << 'h' << -w << 'z';
+        px = x;
+        py = y;
+        first = false;
+        if (text.Size() >= chunk)
+            flush();
+    });
+
+    text << "\" fill=\"#000000\"/></svg>\n";
+}
+
+// Single page TIFF, its directory is written when the page ends
+class TiffPageRowSink : public RowSink
+{
+public:
+    TiffPageRowSink(ByteSink& out, uint32_t dpi) : tiff_(out, dpi) {}
+
+    void Begin(size_t width, size_t height) final { tiff_.Begin(width, height); }
+    bool Row(std::span<const uint8_t> pixels) final { return tiff_.Row(pixels); }
+    void Abort() final { tiff_.Abort(); }
+
+    void End() final
+    {
+        tiff_.End();
+        tiff_.Close();
+    }
+
+private:
+    TiffG4RowSink tiff_;
+};
+
+} // namespace
+
+// =============================================================================
+
+std::unique_ptr<RowSink> Outputter::OpenRows(ByteSink& sink)
+{
+    return OpenRowsImpl(sink);
+}
+
+std::unique_ptr<RowSink> Outputter::OpenRowsImpl(ByteSink& sink)
+{
+    UNUSED(sink);
+    return nullptr;
+}
+
+void Outputter::OutputAll(const SymbolRows& symbol, const OutputOptions& options,
+                          std::span<Outputter* const> outputters)
+{
+    TeeRowSink tee;
+    std::vector<std::unique_ptr<RowSink>> rows;
+    std::vector<ByteSink*> sinks;
+    for (Outputter* outputter: outputters)
+    {
+        ByteSink& sink = outputter->OwnSink();
+        std::unique_ptr<RowSink> format = outputter->OpenRowsImpl(sink);
+        if (!format)
+        {
+            outputter->Output(symbol, options, sink);
+            continue;
+        }
+        tee.Add(*format);
+        rows.push_back(std::move(format));
+        sinks.push_back(&sink);
+    }
+
+    if (rows.empty())
+        return;
+    RenderRows(symbol, options, tee);
+    for (ByteSink* sink: sinks)
+        sink->Flush();
+}
+
+// =============================================================================
+
+void ConsoleOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    constexpr std::string_view inverse_on = "\x1b[7m";
+    constexpr std::string_view inverse_off = "\x1b[27m";
+    // indexed by (top << 1) | bottom
+    constexpr std::string_view half_blocks[] = {" ", "\u2584", "\u2580", "\u2588"};
+
+    Raster raster(symbol, options);
+    const size_t width = raster.Size();
+    const size_t lines = (style_ == ConsoleStyle::HALF_BLOCKS) ? (raster.Size() + 1) / 2 : raster.Size();
+    const size_t char_size = (style_ == ConsoleStyle::HALF_BLOCKS) ? half_blocks[1].size() : 1;
+
+    std::string text;
+    text.reserve(lines * (width * char_size + inverse_on.size() + inverse_off.size() + 1));
+
+    std::string line;
+    std::vector<uint8_t> top(width), bottom(width);
+    for (size_t y = 0; y < raster.Size(); y++)
+    {
+        if (inverse_)
+            text.append(inverse_on);
+
+        if (style_ == ConsoleStyle::ASCII)
+        {
+            RowToText(raster.Row(y), width, " #", line);
+            text.append(line, 0, width);
+        }
+        else
+        {
+            GetKernels().unpack_bits(raster.Row(y).data(), width, top.data());
+            if (++y < raster.Size())
+                GetKernels().unpack_bits(raster.Row(y).data(), width, bottom.data());
+            else
+                std::fill(bottom.begin(), bottom.end(), 0);
+
+            for (size_t x = 0; x < width; x++)
+                text.append(half_blocks[(top[x] << 1) | bottom[x]]);
+        }
+
+        if (inverse_)
+            text.append(inverse_off);
+        text.push_back('\n');
+    }
+
+    sink.Write(text);
+}
+
 // =============================================================================
 
-void ImprintOutputter::OutputImpl(const Canvas& canvas, const OutputOptions& options)
+void ImprintOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
 {
     UNUSED(options);
-    for (size_t row = 0; row < canvas.Size(); row++)
+    std::vector<uint8_t> values(symbol.Size());
+    std::string line(symbol.Size(), ' ');
+    for (size_t row = 0; row < symbol.Size(); row++)
+    {
+        symbol.Row(row, values);
+        for (size_t col = 0; col < values.size(); col++)
+            line[col] = " #"[values[col]];
+        sink.Write(line);
+    }
+}
+
+// =============================================================================
+
+void PBMOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    if (format_ == PbmFormat::ASCII)
+        OutputAscii(symbol, options, sink);
+    else
+        OutputBinary(symbol, options, sink);
+}
+
+std::unique_ptr<RowSink> PBMOutputter::OpenRowsImpl(ByteSink& sink)
+{
+    if (format_ == PbmFormat::ASCII)
+        return nullptr;
+    return std::make_unique<PbmRowSink>(sink);
+}
+
+void PBMOutputter::OutputAscii(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    Raster raster(symbol, options);
+    sink.Write("P1\n" + std::to_string(raster.Size()) + " " + std::to_string(raster.Size()) + "\n");
+
+    std::string line;
+    for (size_t y = 0; y < raster.Size(); y++)
+    {
+        RowToText(raster.Row(y), raster.Size(), "01", line);
+        sink.Write(line);
+    }
+}
+
+void PBMOutputter::OutputBinary(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    PbmRowSink rows(sink);
+    RenderRows(symbol, options, rows);
+}
+
+// =============================================================================
+
+void MappedOutputter::Output(const SymbolRows& symbol, const OutputOptions& options)
+{
+    const size_t size = (symbol.Size() + 2*options.indent) * options.scale;
+
+    std::vector<uint8_t> header;
+    RowLayout layout;
+    if (format_ == MappedFormat::PBM)
     {
-        for (size_t col = 0; col < canvas.Size(); col++)
-            stream_ << " #"[canvas.At(row, col).value];
+        std::string text = "P4\n" + std::to_string(size) + " " + std::to_string(size) + "\n";
+        header.assign(text.begin(), text.end());
+        layout.stride = (size + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
     }
+    else
+    {
+        layout.stride = (size + 31) / 32 * 4;
+        layout.bottom_up = true;
+
+        const uint32_t image_size = static_cast<uint32_t>(layout.stride * size);
+        auto put = [&header](uint32_t value, int n_bytes)
+        {
+            for (int i = 0; i < n_bytes; i++)
+                header.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        };
+        header = {'B', 'M'};
+        put(BMP_HEADER_SIZE + image_size, 4);
+        put(0, 4);                                  // reserved
+        put(BMP_HEADER_SIZE, 4);                    // offset of the pixels
+        put(40, 4);                                 // BITMAPINFOHEADER
+        put(static_cast<uint32_t>(size), 4);
+        put(static_cast<uint32_t>(size), 4);        // positive height, bottom-up rows
+        put(1, 2);                                  // planes
+        put(1, 2);                                  // bits per pixel
+        put(0, 4);                                  // BI_RGB, uncompressed
+        put(image_size, 4);
+        put(BMP_PIXELS_PER_METER, 4);
+        put(BMP_PIXELS_PER_METER, 4);
+        put(2, 4);                                  // colors used
+        put(2, 4);                                  // colors important
+        put(0x00FFFFFF, 4);                         // index 0 is light
+        put(0x00000000, 4);                         // index 1 is dark
+    }
+    layout.offset = header.size();
+
+    MappedFile file(path_, layout.offset + layout.stride * size);
+    std::memcpy(file.Data().data(), header.data(), header.size());
+    RenderBands(symbol, options, file.Data(), layout);
 }
 
 // =============================================================================
 
-void PBMOutputter::OutputImpl(const Canvas& canvas, const OutputOptions& options)
+void PngOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    PngRowSink rows(sink, level_);
+    RenderRows(symbol, options, rows);
+}
+
+std::unique_ptr<RowSink> PngOutputter::OpenRowsImpl(ByteSink& sink)
 {
-    int size = (static_cast<int>(canvas.Size()) + 2*options.indent) * options.scale;
+    return std::make_unique<PngRowSink>(sink, level_);
+}
+
+// =============================================================================
 
-    Stream() << "P1" << std::endl;
-    Stream() << size << " " << size << std::endl;
+void TiffG4Outputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    TiffPageRowSink rows(sink, dpi_);
+    RenderRows(symbol, options, rows);
+}
+
+std::unique_ptr<RowSink> TiffG4Outputter::OpenRowsImpl(ByteSink& sink)
+{
+    return std::make_unique<TiffPageRowSink>(sink, dpi_);
+}
+
+void TiffG4Outputter::OutputPages(std::span<const Canvas> canvases, const OutputOptions& options, ByteSink& sink)
+{
+    TiffG4RowSink rows(sink, dpi_);
+    for (const Canvas& canvas: canvases)
+        RenderRows(CanvasRows(canvas), options, rows);
+    rows.Close();
+    sink.Flush();
+}
+
+// =============================================================================
+
+void EscPosOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    EscPosRowSink rows(sink, band_rows_);
+    RenderRows(symbol, options, rows);
+}
+
+std::unique_ptr<RowSink> EscPosOutputter::OpenRowsImpl(ByteSink& sink)
+{
+    return std::make_unique<EscPosRowSink>(sink, band_rows_);
+}
 
-    for (int row = 0; row < size; row++)
+// =============================================================================
+
+void ZplOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    ZplRowSink rows(sink, band_rows_);
+    RenderRows(symbol, options, rows);
+}
+
+std::unique_ptr<RowSink> ZplOutputter::OpenRowsImpl(ByteSink& sink)
+{
+    return std::make_unique<ZplRowSink>(sink, band_rows_);
+}
+
+// =============================================================================
+
+void SvgOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    std::string document = Render(symbol, options);
+    sink.Write(document);
+}
+
+std::string SvgOutputter::Render(const SymbolRows& symbol, const OutputOptions& options) const
+{
+    // about a third of modules start a run, each takes up to 20 characters
+    TextBuffer text(512 + symbol.Size() * symbol.Size() * 7);
+    WriteSvg(symbol, options, shapes_, text, SIZE_MAX, []() {});
+    return text.Release();
+}
+
+// =============================================================================
+
+void SvgzOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    Deflater deflater(DeflateFormat::GZIP, level_);
+    TextBuffer text(CHUNK_SIZE + 64);
+    auto flush = [&]()
+    {
+        deflater.Write(text.Bytes());
+        text.Clear();
+        sink.Write(deflater.Output());
+        deflater.Output().clear();
+    };
+
+    WriteSvg(symbol, options, shapes_, text, CHUNK_SIZE, flush);
+    flush();
+    deflater.Finish();
+    sink.Write(deflater.Output());
+}
+
+// =============================================================================
+
+void EpsOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    const int n = static_cast<int>(symbol.Size());
+    const int size = (n + 2*options.indent) * options.scale;
+    const size_t stride = symbol.PackedRowSize();
+
+    TextBuffer text(1024 + (format_ == EpsFormat::RECTFILL ? n * n * 4 : n * stride * 5 / 2));
+    text << "%!PS-Adobe-3.0 EPSF-3.0\n"
+         << "%%BoundingBox: 0 0 " << size << ' ' << size << '\n'
+         << "%%Title: QR-code generated using myqro library\n";
+    if (format_ != EpsFormat::RECTFILL)
+        text << "%%LanguageLevel: 2\n";
+    text << "%%EndComments\n"
+         << "gsave\n"
+         << "1 setgray 0 0 " << size << ' ' << size << " rectfill\n"
+         << "0 setgray\n"
+         << options.indent * options.scale << ' ' << options.indent * options.scale << " translate\n";
+
+    if (format_ == EpsFormat::RECTFILL)
     {
-        int r = row / options.scale;
-        for (int col = 0; col < size; col++)
+        // one module is a unit square, the first row is at the top
+        std::vector<uint8_t> values(n);
+        text << options.scale << ' ' << options.scale << " scale\n"
+             << "/f { 1 rectfill } bind def\n";
+        for (int row = 0; row < n; row++)
         {
-            int c = col / options.scale;
-            if (canvas.IsInside(r - options.indent, c - options.indent))
+            symbol.Row(row, values);
+            for (int col = 0; col < n;)
             {
-                const Cell& cell = canvas.At(r - options.indent, c - options.indent);
-                Stream() << "01"[cell.value];
+                if (values[col] == WHITE)
+                {
+                    col++;
+                    continue;
+                }
+                int end = col;
+                while (end < n && values[end] == BLACK)
+                    end++;
+                text << col << ' ' << n - 1 - row << ' ' << end - col << " f\n";
+                col = end;
+            }
+        }
+    }
+    else
+    {
+        // the symbol is a unit square image, dark modules are 1 and painted
+        const bool hex = format_ == EpsFormat::HEX;
+        text << n * options.scale << ' ' << n * options.scale << " scale\n"
+             << n << ' ' << n << " true [" << n << " 0 0 " << -n << " 0 " << n << "] currentfile "
+             << (hex ? "/ASCIIHexDecode" : "/ASCII85Decode") << " filter imagemask\n";
+
+        std::vector<uint8_t> bits(stride);
+        Ascii85Encoder ascii85(text);
+        for (int row = 0; row < n; row++)
+        {
+            symbol.PackedRow(row, bits);
+            if (hex)
+            {
+                for (uint8_t byte: bits)
+                    text << "0123456789ABCDEF"[byte >> 4] << "0123456789ABCDEF"[byte & 0xF];
+                text << '\n';
             }
             else
             {
-                Stream() << '0';
+                ascii85.Write(bits);
             }
         }
-        Stream() << std::endl;
+
+        if (hex)
+            text << ">\n";
+        else
+            ascii85.Finish();
     }
+
+    text << "grestore\n"
+         << "%%EOF\n";
+
+    std::string document = text.Release();
+    sink.Write(document);
+}
+
+// =============================================================================
+
+PdfWriter::PdfWriter(ByteSink& out, const OutputOptions& options, PdfShapes shapes, const PdfLayout& layout, int level) :
+    out_(out),
+    options_(options),
+    shapes_(shapes),
+    layout_(layout),
+    level_(level),
+    position_(0),
+    offsets_(PROC_SET, 0),
+    closed_(false),
+    cell_(0),
+    page_width_(0),
+    page_height_(0),
+    on_page_(0),
+    content_object_(0),
+    content_size_(0)
+{
+    if (layout_.columns == 0 || layout_.rows == 0)
+        throw Error("PDF page needs at least one cell");
+
+    // binary comment marks the file as binary for transfer tools
+    Write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+    BeginObject(PROC_SET);
+    Write("[/PDF /ImageB]\nendobj\n");
 }
 
 // =============================================================================
 
-void SvgOutputter::OutputImpl(const Canvas& canvas, const OutputOptions& options)
+void PdfWriter::Add(const SymbolRows& symbol)
 {
-    int size = (static_cast<int>(canvas.Size()) + 2*options.indent);
+    if (closed_)
+        throw Error("PDF document is closed");
+
+    const int s = options_.scale;
+    const int n = static_cast<int>(symbol.Size());
+    const int size = (n + 2*options_.indent) * s;
+    if (cell_ == 0)
+    {
+        cell_ = layout_.cell > 0 ? layout_.cell : size;
+        page_width_ = 2*layout_.margin + static_cast<int>(layout_.columns) * (cell_ + layout_.spacing) - layout_.spacing;
+        page_height_ = 2*layout_.margin + static_cast<int>(layout_.rows) * (cell_ + layout_.spacing) - layout_.spacing;
+    }
+    if (size > cell_)
+        throw Error(std::format("Code of {} points does not fit into cells of {} points", size, cell_));
+
+    if (on_page_ == 0)
+        BeginPage();
 
-    Stream() << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl
-             << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" "
-             << "\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">" << std::endl
-             << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 "
-             << size << " " << size << "\" stroke=\"none\">" << std::endl
-             << "<rect width=\"100%\" height=\"100%\" fill=\"#FFFFFF\"/>" << std::endl
-             << "<path d=\"";
-    for (size_t row = 0; row < canvas.Size(); row++)
+    // codes are centered in their cells, PDF y axis goes up
+    const int col = static_cast<int>(on_page_ % layout_.columns);
+    const int row = static_cast<int>(on_page_ / layout_.columns);
+    const int x = layout_.margin + col * (cell_ + layout_.spacing) + (cell_ - size) / 2 + options_.indent * s;
+    const int top = page_height_ - layout_.margin - row * (cell_ + layout_.spacing) - (cell_ - size) / 2 - options_.indent * s;
+
+    TextBuffer text(256);
+    if (shapes_ == PdfShapes::PATH)
     {
-        for (size_t col = 0; col < canvas.Size(); col++)
+        // module grid with the first row at the top
+        text << "q " << s << " 0 0 " << -s << ' ' << x << ' ' << top << " cm\n";
+        ForEachRectangle(symbol, true, [&text](int rx, int ry, int w, int h)
         {
-            const Cell& cell = canvas.At(row, col);
-            if (cell.value == WHITE)
-                continue;
+            text << rx << ' ' << ry << ' ' << w << ' ' << h << " re\n";
+        });
+        text << "f Q\n";
+    }
+    else
+    {
+        // image space is the unit square with the first row at the top
+        text << "q " << n * s << " 0 0 " << n * s << ' ' << x << ' ' << top - n * s << " cm /Im" << images_.size() << " Do Q\n";
 
-            Stream() << "M" << row + options.indent << ',' << col + options.indent << "h1v1h-1z ";
+        Deflater deflater(DeflateFormat::ZLIB, level_);
+        std::vector<uint8_t> bits(symbol.PackedRowSize());
+        for (size_t r = 0; r < symbol.Size(); r++)
+        {
+            symbol.PackedRow(r, bits);
+            deflater.Write(bits);
         }
+        deflater.Finish();
+        images_.push_back({symbol.Size(), std::move(deflater.Output())});
     }
-    Stream() << "\" fill=\"#000000\"/></svg>";
+
+    std::string commands = text.Release();
+    content_->Write(std::span(reinterpret_cast<const uint8_t*>(commands.data()), commands.size()));
+    WriteContent();
+
+    if (++on_page_ == layout_.columns * layout_.rows)
+        EndPage();
 }
 
 // =============================================================================
 
-void EpsOutputter::OutputImpl(const Canvas& canvas, const OutputOptions& options)
+void PdfWriter::Close()
 {
-    int llx, lly, urx, ury;
-    llx = lly = -options.indent;
-    urx = ury = (static_cast<int>(canvas.Size()) + options.indent);
+    if (closed_)
+        return;
+    if (on_page_ > 0)
+        EndPage();
+    if (pages_.empty())
+        throw Error("PDF needs at least one page");
+    closed_ = true;
 
-    Stream() << "%!PS-Adobe-3.0 EPSF-3.0" << std::endl
-             << "%%BoundingBox: " << llx << ' ' << lly
-                                  << ' ' << urx << ' ' << ury << std::endl
-             << "%%Title: QR-code generated using myqro library" << std::endl
-             << "%%EndComments" << std::endl;
+    // the page tree holds the resources shared by all pages
+    TextBuffer text(256 + pages_.size() * 12);
+    text << "<< /Type /Pages /Count " << pages_.size() << " /Resources << /ProcSet " << PROC_SET << " 0 R >>\n/Kids [";
+    for (size_t i = 0; i < pages_.size(); i++)
+        text << (i % 8 ? " " : "\n") << pages_[i] << " 0 R";
+    text << "] >>\nendobj\n";
+    BeginObject(PAGE_TREE);
+    Write(text.Release());
 
-    Stream() << "1.0 1.0 1.0 setrgbcolor" << std::endl
-             << llx << ' ' << lly << ' ' << urx << ' ' << ury << " rectfill" << std::endl;
+    BeginObject(CATALOG);
+    Write("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
 
-    Stream() << "0.0 0.0 0.0 setrgbcolor" << std::endl;
-    for (size_t row = 0; row < canvas.Size(); row++)
+    // every entry is exactly 20 bytes
+    const uint64_t xref = position_;
+    TextBuffer table(64 + offsets_.size() * 20);
+    table << "xref\n0 " << offsets_.size() + 1 << "\n0000000000 65535 f \n";
+    for (uint64_t offset: offsets_)
     {
-        for (size_t col = 0; col < canvas.Size(); col++)
-        {
-            const Cell& cell = canvas.At(row, col);
-            if (cell.value == WHITE)
-                continue;
+        std::string digits = std::to_string(offset);
+        table << std::string(10 - std::min<size_t>(10, digits.size()), '0') << digits << " 00000 n \n";
+    }
+    table << "trailer\n<< /Size " << offsets_.size() + 1 << " /Root 1 0 R >>\nstartxref\n"
+          << static_cast<size_t>(xref) << "\n%%EOF\n";
+    Write(table.Release());
+}
 
-            Stream() <<  col << ' ' << canvas.Size() - row << ' ' << "1 1 rectfill" << std::endl;
-        }
+// =============================================================================
+
+// The length of the content stream is an indirect object written after it, so
+// the compressed stream can go to the sink before its length is known
+void PdfWriter::BeginPage()
+{
+    content_object_ = Reserve();
+    size_t length_object = Reserve();
+    content_.emplace(DeflateFormat::ZLIB, level_);
+    content_size_ = 0;
+
+    BeginObject(content_object_);
+    TextBuffer text(64);
+    text << "<< /Length " << length_object << " 0 R /Filter /FlateDecode >>\nstream\n";
+    Write(text.Release());
+}
+
+void PdfWriter::EndPage()
+{
+    content_->Finish();
+    WriteContent();
+    content_.reset();
+    Write("\nendstream\nendobj\n");
+
+    BeginObject(content_object_ + 1);
+    Write(std::to_string(content_size_) + "\nendobj\n");
+
+    std::vector<size_t> image_objects;
+    for (const Image& image: images_)
+    {
+        image_objects.push_back(Reserve());
+        BeginObject(image_objects.back());
+        TextBuffer text(192);
+        text << "<< /Type /XObject /Subtype /Image /Width " << image.size << " /Height " << image.size
+             << " /ImageMask true /Decode [1 0] /BitsPerComponent 1 /Filter /FlateDecode /Length "
+             << image.data.size() << " >>\nstream\n";
+        Write(text.Release());
+        Write(image.data);
+        Write("\nendstream\nendobj\n");
     }
 
-    Stream() << "%%EOF" << std::endl;
+    size_t page = Reserve();
+    BeginObject(page);
+    TextBuffer text(128 + image_objects.size() * 16);
+    text << "<< /Type /Page /Parent " << PAGE_TREE << " 0 R /MediaBox [0 0 " << page_width_ << ' ' << page_height_
+         << "] /Contents " << content_object_ << " 0 R";
+    if (!image_objects.empty())
+    {
+        text << "\n/Resources << /ProcSet " << PROC_SET << " 0 R /XObject <<";
+        for (size_t i = 0; i < image_objects.size(); i++)
+            text << " /Im" << i << ' ' << image_objects[i] << " 0 R";
+        text << " >> >>";
+    }
+    text << " >>\nendobj\n";
+    Write(text.Release());
+
+    pages_.push_back(page);
+    images_.clear();
+    on_page_ = 0;
+}
+
+void PdfWriter::WriteContent()
+{
+    std::vector<uint8_t>& compressed = content_->Output();
+    content_size_ += compressed.size();
+    Write(compressed);
+    compressed.clear();
+}
+
+// =============================================================================
+
+size_t PdfWriter::Reserve()
+{
+    offsets_.push_back(0);
+    return offsets_.size();
+}
+
+void PdfWriter::BeginObject(size_t number)
+{
+    offsets_[number - 1] = position_;
+    Write(std::to_string(number) + " 0 obj\n");
+}
+
+void PdfWriter::Write(std::string_view text)
+{
+    out_.Write(text);
+    position_ += text.size();
+}
+
+void PdfWriter::Write(std::span<const uint8_t> data)
+{
+    out_.Write(data);
+    position_ += data.size();
+}
+
+// =============================================================================
+
+void PdfOutputter::OutputImpl(const SymbolRows& symbol, const OutputOptions& options, ByteSink& sink)
+{
+    PdfWriter writer(sink, options, shapes_, layout_);
+    writer.Add(symbol);
+    writer.Close();
+}
+
+void PdfOutputter::OutputPages(std::span<const Canvas> canvases, const OutputOptions& options, ByteSink& sink)
+{
+    PdfWriter writer(sink, options, shapes_, layout_);
+    for (const Canvas& canvas: canvases)
+        writer.Add(CanvasRows(canvas));
+    writer.Close();
+    sink.Flush();
 }
 
 // =============================================================================
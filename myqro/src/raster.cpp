@@ -0,0 +1,103 @@
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+#include "error.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+Raster::Raster(const SymbolRows& symbol, const OutputOptions& options) :
+    symbol_(symbol),
+    options_(options),
+    size_((symbol.Size() + 2*options.indent) * options.scale),
+    stride_((size_ + BITS_PER_BYTE - 1) / BITS_PER_BYTE),
+    cached_(-1),
+    modules_(symbol.PackedRowSize()),
+    pixels_(stride_),
+    blank_(stride_, 0)
+{}
+
+// =============================================================================
+
+std::span<const uint8_t> Raster::Row(size_t y)
+{
+    int row = static_cast<int>(y / options_.scale) - options_.indent;
+    if (row < 0 || row >= static_cast<int>(symbol_.Size()))
+        return blank_;
+
+    if (row != cached_)
+    {
+        symbol_.PackedRow(row, modules_);
+        std::fill(pixels_.begin(), pixels_.end(), 0);
+        GetKernels().expand_bits(modules_.data(), symbol_.Size(), options_.scale,
+                                 options_.indent * options_.scale, pixels_.data());
+        cached_ = row;
+    }
+    return pixels_;
+}
+
+// =============================================================================
+
+void RenderBands(const SymbolRows& symbol, const OutputOptions& options, std::span<std::byte> dst,
+                 const RowLayout& layout, size_t band_rows)
+{
+    const int n = static_cast<int>(symbol.Size());
+    const size_t size = (symbol.Size() + 2*options.indent) * options.scale;
+    const size_t row_size = (size + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    if (band_rows == 0)
+        throw Error("Bands need at least one row");
+    if (layout.stride < row_size)
+        throw Error(std::format("Stride {} is less than {} bytes of a pixel row", layout.stride, row_size));
+    if (layout.offset + size * layout.stride > dst.size())
+        throw Error(std::format("{} rows of {} bytes at offset {} do not fit {} bytes",
+                                size, layout.stride, layout.offset, dst.size()));
+
+    const Kernels& kernels = GetKernels();
+    auto render = [&](size_t band)
+    {
+        std::vector<uint8_t> modules(symbol.PackedRowSize());
+        std::vector<uint8_t> pixels(layout.stride);
+        int cached = -1;
+
+        const size_t first = band * band_rows;
+        const size_t last = std::min(size, first + band_rows);
+        for (size_t y = first; y < last; y++)
+        {
+            std::byte* out = dst.data() + layout.offset + (layout.bottom_up ? size - 1 - y : y) * layout.stride;
+            const int row = static_cast<int>(y / options.scale) - options.indent;
+            if (row < 0 || row >= n)
+            {
+                std::memset(out, 0, layout.stride);
+                continue;
+            }
+
+            if (row != cached)
+            {
+                symbol.PackedRow(row, modules);
+                std::fill(pixels.begin(), pixels.end(), 0);
+                kernels.expand_bits(modules.data(), symbol.Size(), options.scale,
+                                    options.indent * options.scale, pixels.data());
+                cached = row;
+            }
+            std::memcpy(out, pixels.data(), layout.stride);
+        }
+    };
+
+    ThreadPool::Shared().ParallelFor((size + band_rows - 1) / band_rows, render);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,80 @@
+#include "reed_solomon.hpp"
+
+#include <algorithm>
+#include <format>
+
+#include "error.hpp"
+#include "simd.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+std::vector<uint8_t> GeneratorCoefficients(size_t n_correction_bytes)
+{
+    const auto& poly = GeneratingPolynomial.at(n_correction_bytes);
+
+    std::vector<uint8_t> result(poly.size());
+    std::transform(poly.begin(), poly.end(), result.begin(), [](size_t e) { return GaloisField[e]; });
+    return result;
+}
+
+// =============================================================================
+
+void GenerateCorrectionLanes(const uint8_t* data, size_t block_size, size_t lanes,
+                             const std::vector<uint8_t>& generator, uint8_t* parity)
+{
+    if (generator.empty() || generator.size() > MAX_CORRECTION_BYTES)
+        throw Error(std::format("Unsupported number of correction bytes: {}", generator.size()));
+
+    const Kernels& kernels = GetKernels();
+    for (size_t offset = 0; offset < lanes; offset += CORRECTION_TILE_LANES)
+    {
+        size_t width = std::min(CORRECTION_TILE_LANES, lanes - offset);
+        kernels.correction_tile(data + offset, block_size, lanes, width,
+                                generator.data(), generator.size(), parity + offset);
+    }
+}
+
+// =============================================================================
+
+std::vector<ArrayType> GenerateCorrectionBlocks(std::span<const Block> blocks, size_t n_correction_bytes)
+{
+    std::vector<ArrayType> result(blocks.size());
+    if (blocks.empty()) return result;
+
+    const std::vector<uint8_t> generator = GeneratorCoefficients(n_correction_bytes);
+    const size_t lanes = blocks.size();
+    const size_t block_size = blocks.front().Size();
+
+    ArrayType data(block_size * lanes);
+    for (size_t l = 0; l < lanes; l++)
+    {
+        if (blocks[l].Size() != block_size)
+            throw Error(std::format("Blocks must have equal size: {} != {}", blocks[l].Size(), block_size));
+
+        for (size_t j = 0; j < block_size; j++)
+            data[j * lanes + l] = *(blocks[l].begin + j);
+    }
+
+    ArrayType parity(n_correction_bytes * lanes);
+    GenerateCorrectionLanes(data.data(), block_size, lanes, generator, parity.data());
+
+    for (size_t l = 0; l < lanes; l++)
+    {
+        result[l].resize(n_correction_bytes);
+        for (size_t i = 0; i < n_correction_bytes; i++)
+            result[l][i] = parity[i * lanes + l];
+    }
+    return result;
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,532 @@
+#include "row_sink.hpp"
+
+#include <algorithm>
+#include <format>
+#include <string>
+
+#include "defines.hpp"
+#include "error.hpp"
+#include "raster.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+bool RenderRows(const SymbolRows& symbol, const OutputOptions& options, RowSink& sink, std::stop_token stop)
+{
+    Raster raster(symbol, options);
+    sink.Begin(raster.Size(), raster.Size());
+
+    for (size_t y = 0; y < raster.Size(); y++)
+    {
+        if (stop.stop_requested() || !sink.Row(raster.Row(y)))
+        {
+            sink.Abort();
+            return false;
+        }
+    }
+
+    sink.End();
+    return true;
+}
+
+// =============================================================================
+
+void PbmRowSink::Begin(size_t width, size_t height)
+{
+    out_.Write("P4\n" + std::to_string(width) + " " + std::to_string(height) + "\n");
+}
+
+bool PbmRowSink::Row(std::span<const uint8_t> pixels)
+{
+    out_.Write(pixels);
+    return true;
+}
+
+// =============================================================================
+
+PngRowSink::PngRowSink(ByteSink& out, int level) :
+    out_(out),
+    deflater_(DeflateFormat::ZLIB, level)
+{}
+
+void PngRowSink::Begin(size_t width, size_t height)
+{
+    constexpr uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    constexpr uint8_t bit_depth = 1;
+    constexpr uint8_t color_type = 0;           // grayscale, 0 is black
+    constexpr uint8_t filter_none = 0;
+
+    out_.Write(signature);
+
+    std::vector<uint8_t> header;
+    for (size_t value: {width, height})
+        for (int shift = 24; shift >= 0; shift -= 8)
+            header.push_back(static_cast<uint8_t>(value >> shift));
+    header.insert(header.end(), {bit_depth, color_type, 0, 0, 0});
+    WriteChunk("IHDR", header);
+
+    // every scanline starts with its filter type
+    line_.assign((width + BITS_PER_BYTE - 1) / BITS_PER_BYTE + 1, 0);
+    line_[0] = filter_none;
+}
+
+bool PngRowSink::Row(std::span<const uint8_t> pixels)
+{
+    std::transform(pixels.begin(), pixels.end(), line_.begin() + 1, [](uint8_t byte) { return static_cast<uint8_t>(~byte); });
+    deflater_.Write(line_);
+
+    if (deflater_.Output().size() >= IDAT_SIZE)
+    {
+        WriteChunk("IDAT", deflater_.Output());
+        deflater_.Output().clear();
+    }
+    return true;
+}
+
+void PngRowSink::End()
+{
+    deflater_.Finish();
+    WriteChunk("IDAT", deflater_.Output());
+    WriteChunk("IEND", {});
+}
+
+void PngRowSink::WriteChunk(const char* type, std::span<const uint8_t> data)
+{
+    uint8_t head[8];
+    uint32_t length = static_cast<uint32_t>(data.size());
+    for (int i = 0; i < 4; i++)
+    {
+        head[i] = static_cast<uint8_t>(length >> (24 - 8 * i));
+        head[4 + i] = static_cast<uint8_t>(type[i]);
+    }
+
+    uint32_t crc = Crc32(data, Crc32(std::span(head).subspan(4)));
+    uint8_t tail[4];
+    for (int i = 0; i < 4; i++)
+        tail[i] = static_cast<uint8_t>(crc >> (24 - 8 * i));
+
+    out_.Write(head);
+    out_.Write(data);
+    out_.Write(tail);
+}
+
+// =============================================================================
+
+TiffG4RowSink::TiffG4RowSink(ByteSink& out, uint32_t dpi) :
+    out_(out),
+    dpi_(dpi),
+    position_(0),
+    width_(0),
+    height_(0)
+{}
+
+void TiffG4RowSink::Begin(size_t width, size_t height)
+{
+    encoder_.emplace(width);
+    width_ = width;
+    height_ = height;
+}
+
+bool TiffG4RowSink::Row(std::span<const uint8_t> pixels)
+{
+    encoder_->Row(pixels);
+    return true;
+}
+
+// Pages are laid out as data followed by their directory, so the offset of the
+// next directory is known once the next page is compressed
+void TiffG4RowSink::End()
+{
+    encoder_->Finish();
+    std::vector<uint8_t> data = std::move(encoder_->Output());
+    encoder_.reset();
+
+    const uint32_t size = static_cast<uint32_t>(data.size());
+    // directories start at word boundaries
+    if (data.size() % 2)
+        data.push_back(0);
+
+    if (!pending_)
+    {
+        uint8_t header[8] = {'I', 'I', 42, 0};
+        uint32_t first = static_cast<uint32_t>(sizeof(header) + data.size());
+        for (int i = 0; i < 4; i++)
+            header[4 + i] = static_cast<uint8_t>(first >> (8 * i));
+        Write(header);
+    }
+    else
+    {
+        WriteDirectory(*pending_, position_ + DIRECTORY_SIZE + static_cast<uint32_t>(data.size()));
+    }
+
+    pending_ = Page{static_cast<uint32_t>(width_), static_cast<uint32_t>(height_), position_, size};
+    Write(data);
+}
+
+void TiffG4RowSink::Close()
+{
+    if (!pending_)
+        throw Error("TIFF needs at least one page");
+    WriteDirectory(*pending_, 0);
+    pending_.reset();
+}
+
+void TiffG4RowSink::WriteDirectory(const Page& page, uint32_t next)
+{
+    constexpr uint16_t SHORT = 3;
+    constexpr uint16_t LONG = 4;
+    constexpr uint16_t RATIONAL = 5;
+    constexpr uint32_t COMPRESSION_G4 = 4;
+    constexpr uint32_t WHITE_IS_ZERO = 0;
+    constexpr uint32_t INCH = 2;
+
+    const uint32_t resolution = position_ + IFD_SIZE;
+    const struct
+    {
+        uint16_t tag;
+        uint16_t type;
+        uint32_t value;
+    } entries[IFD_ENTRIES] = {
+        {256, LONG, page.width},                // ImageWidth
+        {257, LONG, page.height},               // ImageLength
+        {258, SHORT, 1},                        // BitsPerSample
+        {259, SHORT, COMPRESSION_G4},           // Compression
+        {262, SHORT, WHITE_IS_ZERO},            // PhotometricInterpretation
+        {273, LONG, page.offset},               // StripOffsets
+        {277, SHORT, 1},                        // SamplesPerPixel
+        {278, LONG, page.height},               // RowsPerStrip
+        {279, LONG, page.size},                 // StripByteCounts
+        {282, RATIONAL, resolution},            // XResolution
+        {283, RATIONAL, resolution + 8},        // YResolution
+        {296, SHORT, INCH},                     // ResolutionUnit
+    };
+
+    std::vector<uint8_t> directory;
+    directory.reserve(DIRECTORY_SIZE);
+    auto put = [&directory](uint32_t value, int size) {
+        for (int i = 0; i < size; i++)
+            directory.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    };
+
+    put(IFD_ENTRIES, 2);
+    for (const auto& entry: entries)
+    {
+        put(entry.tag, 2);
+        put(entry.type, 2);
+        put(1, 4);
+        // values shorter than 4 bytes are left-justified
+        put(entry.value, entry.type == SHORT ? 2 : 4);
+        if (entry.type == SHORT)
+            put(0, 2);
+    }
+    put(next, 4);
+    for (int i = 0; i < 2; i++)
+    {
+        put(dpi_, 4);
+        put(1, 4);
+    }
+    Write(directory);
+}
+
+void TiffG4RowSink::Write(std::span<const uint8_t> data)
+{
+    out_.Write(data);
+    position_ += static_cast<uint32_t>(data.size());
+}
+
+// =============================================================================
+
+EscPosRowSink::EscPosRowSink(ByteSink& out, size_t band_rows) :
+    out_(out),
+    band_rows_(std::max<size_t>(band_rows, 1)),
+    height_(0),
+    row_(0)
+{}
+
+void EscPosRowSink::Begin(size_t width, size_t height)
+{
+    constexpr size_t MAX_SIZE = 0xFFFF;
+    size_t stride = (width + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    if (stride > MAX_SIZE)
+        throw Error(std::format("Image of {} pixels is too wide for ESC/POS", width));
+    height_ = height;
+    row_ = 0;
+    // the band height is written as 16 bits too
+    band_rows_ = std::min(band_rows_, MAX_SIZE);
+}
+
+bool EscPosRowSink::Row(std::span<const uint8_t> pixels)
+{
+    // GS v 0 m xL xH yL yH, m = 0 is the normal density
+    if (row_ % band_rows_ == 0)
+    {
+        size_t rows = std::min(band_rows_, height_ - row_);
+        const uint8_t command[] = {0x1D, 'v', '0', 0,
+                                   static_cast<uint8_t>(pixels.size()), static_cast<uint8_t>(pixels.size() >> 8),
+                                   static_cast<uint8_t>(rows), static_cast<uint8_t>(rows >> 8)};
+        out_.Write(command);
+    }
+    out_.Write(pixels);
+    row_++;
+    return true;
+}
+
+// =============================================================================
+
+ZplRowSink::ZplRowSink(ByteSink& out, size_t band_rows) :
+    out_(out),
+    band_rows_(std::max<size_t>(band_rows, 1)),
+    stride_(0),
+    height_(0),
+    row_(0)
+{}
+
+void ZplRowSink::Begin(size_t width, size_t height)
+{
+    stride_ = (width + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    height_ = height;
+    row_ = 0;
+    out_.Write("^XA\n^PW" + std::to_string(width) + "\n^LL" + std::to_string(height) + "\n");
+}
+
+// ^GFA,b,c,d: b and c are the byte size of the uncompressed field, d bytes per row
+bool ZplRowSink::Row(std::span<const uint8_t> pixels)
+{
+    if (row_ % band_rows_ == 0)
+    {
+        std::string field_size = std::to_string(std::min(band_rows_, height_ - row_) * stride_);
+        out_.Write("^FO0," + std::to_string(row_) + "^GFA," + field_size + "," + field_size + "," +
+                   std::to_string(stride_) + ",");
+        previous_.clear();
+    }
+
+    EncodeRow(pixels);
+    out_.Write(line_);
+
+    row_++;
+    if (row_ % band_rows_ == 0 || row_ == height_)
+        out_.Write("^FS\n");
+    return true;
+}
+
+void ZplRowSink::End()
+{
+    out_.Write("^XZ\n");
+}
+
+void ZplRowSink::EncodeRow(std::span<const uint8_t> pixels)
+{
+    line_.clear();
+    if (previous_.size() == pixels.size() && std::equal(pixels.begin(), pixels.end(), previous_.begin()))
+    {
+        line_ += ':';
+        return;
+    }
+    previous_.assign(pixels.begin(), pixels.end());
+
+    auto nibble = [&pixels](size_t i) { return (pixels[i / 2] >> (i % 2 ? 0 : 4)) & 0xF; };
+    const size_t count = pixels.size() * 2;
+
+    // ',' and '!' fill the rest of the row with 0 or 1 bits
+    size_t end = count;
+    while (end > 0 && nibble(end - 1) == 0)
+        end--;
+    char fill = end < count ? ',' : 0;
+    if (!fill)
+    {
+        while (end > 0 && nibble(end - 1) == 0xF)
+            end--;
+        fill = end < count ? '!' : 0;
+    }
+
+    // repeat counts: G-Y are 1-19, g-z are 20-400 in steps of 20, they add up
+    constexpr size_t MAX_REPEAT = 400;
+    for (size_t i = 0; i < end;)
+    {
+        const char digit = "0123456789ABCDEF"[nibble(i)];
+        size_t run = 1;
+        while (i + run < end && nibble(i + run) == nibble(i))
+            run++;
+        i += run;
+
+        for (; run > MAX_REPEAT; run -= MAX_REPEAT)
+            line_ += {'z', digit};
+        if (run > 1)
+        {
+            if (run >= 20)
+                line_ += static_cast<char>('g' + run / 20 - 1);
+            if (run % 20)
+                line_ += static_cast<char>('G' + run % 20 - 1);
+        }
+        line_ += digit;
+    }
+    if (fill)
+        line_ += fill;
+}
+
+// =============================================================================
+
+void TeeRowSink::Begin(size_t width, size_t height)
+{
+    for (RowSink* sink: sinks_)
+        sink->Begin(width, height);
+}
+
+bool TeeRowSink::Row(std::span<const uint8_t> pixels)
+{
+    for (RowSink* sink: sinks_)
+        if (!sink->Row(pixels))
+            return false;
+    return true;
+}
+
+void TeeRowSink::End()
+{
+    for (RowSink* sink: sinks_)
+        sink->End();
+}
+
+void TeeRowSink::Abort()
+{
+    for (RowSink* sink: sinks_)
+        sink->Abort();
+}
+
+// =============================================================================
+
+AsyncRowSink::AsyncRowSink(RowSink& sink, size_t capacity) :
+    sink_(sink),
+    capacity_(std::max<size_t>(capacity, 1)),
+    head_(0),
+    count_(0),
+    finishing_(false),
+    aborted_(false),
+    cancelled_(false)
+{}
+
+AsyncRowSink::~AsyncRowSink()
+{
+    if (worker_.joinable())
+    {
+        {
+            std::lock_guard lock(mutex_);
+            aborted_ = true;
+        }
+        changed_.notify_all();
+        worker_.join();
+    }
+}
+
+void AsyncRowSink::Begin(size_t width, size_t height)
+{
+    sink_.Begin(width, height);
+
+    size_t stride = (width + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    slots_.assign(capacity_, std::vector<uint8_t>(stride));
+    worker_ = std::thread(&AsyncRowSink::Run, this);
+}
+
+bool AsyncRowSink::Row(std::span<const uint8_t> pixels)
+{
+    std::unique_lock lock(mutex_);
+    changed_.wait(lock, [this] { return count_ < capacity_ || cancelled_; });
+    if (cancelled_)
+        return false;
+
+    std::vector<uint8_t>& slot = slots_[(head_ + count_) % capacity_];
+    std::copy(pixels.begin(), pixels.begin() + std::min(pixels.size(), slot.size()), slot.begin());
+    count_++;
+    lock.unlock();
+    changed_.notify_all();
+    return true;
+}
+
+// If the consumer refused a row after the last one was queued, it gets Abort
+// instead of End
+void AsyncRowSink::End()
+{
+    Stop(true);
+    if (error_)
+        std::rethrow_exception(error_);
+    if (cancelled_)
+        sink_.Abort();
+}
+
+void AsyncRowSink::Abort()
+{
+    Stop(false);
+    if (error_)
+        std::rethrow_exception(error_);
+    sink_.Abort();
+}
+
+bool AsyncRowSink::Cancelled() const
+{
+    std::lock_guard lock(mutex_);
+    return cancelled_;
+}
+
+void AsyncRowSink::Stop(bool finish)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (finish)
+            finishing_ = true;
+        else
+            aborted_ = true;
+    }
+    changed_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+// Rows stay in their slot while the consumer reads them, the producer can only
+// fill the slots released before
+void AsyncRowSink::Run()
+{
+    try
+    {
+        while (true)
+        {
+            std::unique_lock lock(mutex_);
+            changed_.wait(lock, [this] { return count_ > 0 || finishing_ || aborted_; });
+            if (aborted_)
+                return;
+            if (count_ == 0)
+                break;
+
+            const std::vector<uint8_t>& slot = slots_[head_];
+            lock.unlock();
+            bool accepted = sink_.Row(slot);
+            lock.lock();
+
+            head_ = (head_ + 1) % capacity_;
+            count_--;
+            cancelled_ = !accepted;
+            lock.unlock();
+            changed_.notify_all();
+            if (!accepted)
+                return;
+        }
+
+        sink_.End();
+    }
+    catch (...)
+    {
+        std::lock_guard lock(mutex_);
+        error_ = std::current_exception();
+        cancelled_ = true;
+        changed_.notify_all();
+    }
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,374 @@
+#include "serial_encoder.hpp"
+
+#include <algorithm>
+#include <format>
+
+#include "bits.hpp"
+#include "encoder.hpp"
+#include "error.hpp"
+#include "logger.hpp"
+#include "reed_solomon.hpp"
+#include "simd.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+uint8_t GaloisMultiply(uint8_t a, uint8_t b)
+{
+    if (a == 0 || b == 0) return 0;
+    return GaloisField[(ReverseGaloisField[a] + ReverseGaloisField[b]) % 255];
+}
+
+void Rescore(size_t& total, size_t& score, size_t value)
+{
+    total = total - score + value;
+    score = value;
+}
+
+} // namespace
+
+// =============================================================================
+
+SerialEncoder::SerialEncoder(const std::string& prefix, size_t width, CorrectionLevel cl,
+                             EncodingType encoding, int mask_id, const EncodeOptions& options) :
+    provider_(EncodeProviderFactory::GetProvider(encoding)),
+    prefix_(prefix),
+    width_(width),
+    cl_(cl),
+    mask_id_(mask_id),
+    options_(options),
+    initialized_(false),
+    version_(0),
+    n_correction_bytes_(0),
+    tail_start_(0),
+    tail_bit_(0)
+{
+    if (mask_id_ > static_cast<int>(MAX_MASK_ID))
+        throw Error(std::format("No such mask_id: {}", mask_id_));
+}
+
+// =============================================================================
+
+std::string SerialEncoder::Message(uint64_t number) const
+{
+    std::string digits = std::to_string(number);
+    if (digits.size() > width_)
+        throw Error(std::format("Number {} does not fit into {} digits", number, width_));
+    return prefix_ + std::string(width_ - digits.size(), '0') + digits;
+}
+
+// =============================================================================
+
+const Canvas& SerialEncoder::Encode(uint64_t number)
+{
+    std::string message = Message(number);
+    if (!initialized_)
+        Init(message);
+    else
+        UpdateMessage(message);
+
+    if (canvases_.size() == 1)
+        return canvases_.front();
+
+    size_t idx = Encoder::ChooseMask(version_, options_, [this](size_t mask_id)
+    {
+        return RescanPenalty(penalties_[mask_id]);
+    });
+    std::fill(dirty_rows_.begin(), dirty_rows_.end(), 0);
+    std::fill(dirty_cols_.begin(), dirty_cols_.end(), 0);
+    return canvases_[idx];
+}
+
+// =============================================================================
+
+std::vector<Canvas> SerialEncoder::EncodeRange(const std::string& prefix, uint64_t start, size_t count,
+                                               CorrectionLevel cl, EncodingType encoding, int mask_id,
+                                               const EncodeOptions& options)
+{
+    std::vector<Canvas> result;
+    if (count == 0) return result;
+
+    size_t width = std::to_string(start + count - 1).size();
+    SerialEncoder encoder(prefix, width, cl, encoding, mask_id, options);
+
+    result.reserve(count);
+    for (uint64_t number = start; number < start + count; number++)
+        result.push_back(encoder.Encode(number));
+    return result;
+}
+
+// =============================================================================
+
+void SerialEncoder::Init(const std::string& message)
+{
+    Context ctx = provider_->PrepareData(message, cl_, options_);
+    provider_->PrepareBlocks(ctx);
+    provider_->PrepareOutput(ctx);
+
+    version_ = ctx.version;
+    n_correction_bytes_ = ctx.GetCorrectionBytesCount();
+    stream_.assign(ctx.stream.Data(), ctx.stream.Data() + ctx.stream.ByteSize());
+    output_ = ctx.output;
+
+    // positions of codewords in the output, in the same order as PrepareOutput puts them
+    size_t blocks_count = ctx.data_blocks.size();
+    block_sizes_.resize(blocks_count);
+    block_of_.resize(stream_.size());
+    index_in_block_.resize(stream_.size());
+    data_position_.resize(stream_.size());
+    parity_position_.assign(blocks_count, std::vector<size_t>(n_correction_bytes_));
+
+    std::vector<size_t> block_start(blocks_count);
+    size_t max_block_size = 0;
+    for (size_t b = 0; b < blocks_count; b++)
+    {
+        const Block& block = ctx.data_blocks[b];
+        block_sizes_[b] = block.Size();
+        block_start[b] = block.begin - ctx.data_blocks.front().begin;
+        max_block_size = std::max(max_block_size, block.Size());
+
+        for (size_t j = 0; j < block.Size(); j++)
+        {
+            block_of_[block_start[b] + j] = b;
+            index_in_block_[block_start[b] + j] = j;
+        }
+    }
+
+    size_t position = 0;
+    for (size_t j = 0; j < max_block_size; j++)
+        for (size_t b = 0; b < blocks_count; b++)
+            if (j < block_sizes_[b])
+                data_position_[block_start[b] + j] = position++;
+
+    for (size_t i = 0; i < n_correction_bytes_; i++)
+        for (size_t b = 0; b < blocks_count; b++)
+            parity_position_[b][i] = position++;
+
+    if (mask_id_ >= 0)
+        masks_ = {static_cast<size_t>(mask_id_)};
+    else
+        for (size_t mask_id = MIN_MASK_ID; mask_id <= MAX_MASK_ID; mask_id++)
+            masks_.push_back(mask_id);
+
+    Canvas base = Encoder::CreateCanvas(version_);
+    const DataStream output(output_);
+    for (size_t mask_id: masks_)
+    {
+        canvases_.push_back(base);
+        canvases_.back().FillData(cl_, mask_id, output);
+    }
+    order_ = canvases_.front().DataModulesOrder();
+    if (canvases_.size() > 1)
+        InitPenalties();
+
+    // Groups of digits (3), alphanumeric chars (2) and bytes (1) all start at
+    // multiples of 6, so the tail from such a position converts to the same bits
+    // as it does inside the whole message
+    tail_start_ = prefix_.size() / 6 * 6;
+    Context whole(message, cl_);
+    provider_->ConvertInput(message, whole);
+    Context tail(message.substr(tail_start_), cl_);
+    provider_->ConvertInput(message.substr(tail_start_), tail);
+    tail_bit_ = ctx.encoding_field_width + ctx.data_size_field_width + whole.stream.Size() - tail.stream.Size();
+
+    initialized_ = true;
+}
+
+// =============================================================================
+
+void SerialEncoder::UpdateMessage(const std::string& message)
+{
+    std::string tail = message.substr(tail_start_);
+    if (!provider_->IsDataSupported(tail))
+        throw Error(std::format("Unsupported data for {}: {}", provider_->GetProviderName(), message));
+
+    Context ctx(tail, cl_);
+    provider_->ConvertInput(tail, ctx);
+
+    // data codewords covered by the tail, bits around it are kept
+    size_t first = tail_bit_ / BITS_PER_BYTE;
+    size_t last = (tail_bit_ + ctx.stream.Size() - 1) / BITS_PER_BYTE;
+    ArrayType data(stream_.begin() + first, stream_.begin() + last + 1);
+    for (size_t i = 0; i < ctx.stream.Size(); i++)
+    {
+        size_t pos = tail_bit_ % BITS_PER_BYTE + i;
+        uint8_t mask = static_cast<uint8_t>(1 << (BITS_PER_BYTE - 1 - pos % BITS_PER_BYTE));
+        if (ctx.stream.BitAt(i))
+            data[pos / BITS_PER_BYTE] |= mask;
+        else
+            data[pos / BITS_PER_BYTE] &= static_cast<uint8_t>(~mask);
+    }
+
+    Update(first, data);
+}
+
+// =============================================================================
+
+void SerialEncoder::Update(size_t first, const ArrayType& data)
+{
+    // changed data codewords and parity deltas caused by them
+    std::vector<size_t> changed;
+    for (size_t k = 0; k < data.size(); k++)
+    {
+        size_t p = first + k;
+        uint8_t delta = stream_[p] ^ data[k];
+        if (delta == 0) continue;
+
+        stream_[p] = data[k];
+        output_[data_position_[p]] = data[k];
+        changed.push_back(data_position_[p]);
+
+        size_t b = block_of_[p];
+        const ArrayType& contribution = ContributionTable(block_sizes_[b])[index_in_block_[p]];
+        for (size_t i = 0; i < n_correction_bytes_; i++)
+        {
+            uint8_t parity_delta = GaloisMultiply(delta, contribution[i]);
+            if (parity_delta == 0) continue;
+
+            output_[parity_position_[b][i]] ^= parity_delta;
+            changed.push_back(parity_position_[b][i]);
+        }
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    LogDebug("Serial update: {} changed codewords", changed.size());
+
+    Redraw(changed);
+}
+
+// =============================================================================
+
+void SerialEncoder::Redraw(const std::vector<size_t>& changed)
+{
+    size_t size = canvases_.front().Size();
+    for (size_t codeword: changed)
+    {
+        for (size_t k = 0; k < BITS_PER_BYTE; k++)
+        {
+            size_t bit = codeword * BITS_PER_BYTE + k;
+            if (bit >= order_.size()) break;
+
+            size_t row = order_[bit] / size;
+            size_t col = order_[bit] % size;
+            uint8_t value = GetBit(output_[codeword], BITS_PER_BYTE - 1 - k);
+            for (size_t i = 0; i < masks_.size(); i++)
+            {
+                uint8_t masked = value ^ MaskBit(masks_[i], row, col);
+                Cell& cell = canvases_[i].At(row, col);
+                if (cell.value == masked) continue;
+
+                cell.value = masked;
+                if (penalties_.empty()) continue;
+
+                MaskPenalty& penalty = penalties_[i];
+                penalty.rows[row * size + col] = masked;
+                penalty.cols[col * size + row] = masked;
+                if (masked)
+                    penalty.count_black++;
+                else
+                    penalty.count_black--;
+                dirty_rows_[row] = 1;
+                dirty_cols_[col] = 1;
+            }
+        }
+    }
+}
+
+// =============================================================================
+
+void SerialEncoder::InitPenalties()
+{
+    const size_t size = canvases_.front().Size();
+    const Kernels& kernels = GetKernels();
+
+    // all lines are dirty, so the first scan fills the scores
+    dirty_rows_.assign(size, 1);
+    dirty_cols_.assign(size, 1);
+    penalties_.resize(canvases_.size());
+    for (size_t i = 0; i < canvases_.size(); i++)
+    {
+        MaskPenalty& penalty = penalties_[i];
+        penalty.rows.assign(size * size, 0);
+        penalty.cols.assign(size * size, 0);
+        for (size_t row = 0; row < size; ++row)
+        {
+            for (size_t col = 0; col < size; ++col)
+            {
+                uint8_t value = canvases_[i].At(row, col).value;
+                penalty.rows[row * size + col] = value;
+                penalty.cols[col * size + row] = value;
+            }
+        }
+
+        penalty.row_scores.assign(size, 0);
+        penalty.col_scores.assign(size, 0);
+        penalty.square_scores.assign(size - 1, 0);
+        penalty.lines = 0;
+        penalty.count_black = kernels.count_ones(penalty.rows.data(), penalty.rows.size());
+    }
+}
+
+// =============================================================================
+
+size_t SerialEncoder::RescanPenalty(MaskPenalty& penalty) const
+{
+    const size_t size = canvases_.front().Size();
+    const Kernels& kernels = GetKernels();
+
+    for (size_t row = 0; row < size; row++)
+    {
+        if (!dirty_rows_[row]) continue;
+
+        const uint8_t* line = penalty.rows.data() + row * size;
+        Rescore(penalty.lines, penalty.row_scores[row], LinesPenalty(kernels, line, size, 1));
+
+        // squares spanning the previous and the next row, unless the previous row rescanned them
+        if (row > 0 && !dirty_rows_[row - 1])
+            Rescore(penalty.lines, penalty.square_scores[row - 1], SquaresPenalty(kernels, line - size, size, 2));
+        if (row + 1 < size)
+            Rescore(penalty.lines, penalty.square_scores[row], SquaresPenalty(kernels, line, size, 2));
+    }
+
+    for (size_t col = 0; col < size; col++)
+    {
+        if (!dirty_cols_[col]) continue;
+        Rescore(penalty.lines, penalty.col_scores[col], LinesPenalty(kernels, penalty.cols.data() + col * size, size, 1));
+    }
+
+    return penalty.lines + core::BalancePenalty(penalty.count_black, size * size);
+}
+
+// =============================================================================
+
+const std::vector<ArrayType>& SerialEncoder::ContributionTable(size_t size)
+{
+    auto it = contribution_.find(size);
+    if (it != contribution_.end())
+        return it->second;
+
+    // unit blocks are encoded together in lanes
+    ArrayType identity(size * size, 0);
+    std::vector<Block> blocks;
+    for (size_t j = 0; j < size; j++)
+    {
+        identity[j * size + j] = 1;
+        blocks.push_back({identity.begin() + j * size, identity.begin() + (j + 1) * size});
+    }
+
+    return contribution_[size] = GenerateCorrectionBlocks(blocks, n_correction_bytes_);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,273 @@
+#include "sheet.hpp"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+#include "defines.hpp"
+#include "error.hpp"
+#include "simd.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+constexpr size_t GLYPH_WIDTH = 5;
+constexpr size_t GLYPH_HEIGHT = 7;
+constexpr char FIRST_GLYPH = ' ';
+
+// ASCII 32-95, one byte per row, leftmost dot in bit 4
+constexpr uint8_t Font[][GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // space
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},   // !
+    {0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00},   // "
+    {0x0A, 0x1F, 0x0A, 0x0A, 0x0A, 0x1F, 0x0A},   // #
+    {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04},   // $
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03},   // %
+    {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D},   // &
+    {0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00},   // '
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02},   // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08},   // )
+    {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00},   // *
+    {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00},   // +
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08},   // ,
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00},   // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},   // .
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00},   // /
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},   // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},   // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},   // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},   // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},   // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},   // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},   // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},   // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},   // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},   // 9
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00},   // :
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08},   // ;
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02},   // <
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00},   // =
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08},   // >
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},   // ?
+    {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E},   // @
+    {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},   // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E},   // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E},   // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C},   // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F},   // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10},   // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F},   // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},   // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},   // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C},   // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},   // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F},   // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11},   // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},   // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},   // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10},   // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D},   // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11},   // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},   // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},   // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},   // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04},   // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A},   // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11},   // X
+    {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04},   // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F},   // Z
+    {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E},   // [
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00},   // backslash
+    {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E},   // ]
+    {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00},   // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},   // _
+};
+
+const uint8_t* Glyph(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        c = static_cast<char>(c - 'a' + 'A');
+    size_t index = static_cast<unsigned char>(c) - FIRST_GLYPH;
+    if (static_cast<unsigned char>(c) < FIRST_GLYPH || index >= std::size(Font))
+        index = '?' - FIRST_GLYPH;
+    return Font[index];
+}
+
+// Sets pixels [begin, end) of a packed row
+void FillPixels(uint8_t* row, size_t begin, size_t end)
+{
+    for (size_t x = begin; x < end; x++)
+        row[x / BITS_PER_BYTE] |= 0x80 >> (x % BITS_PER_BYTE);
+}
+
+// One code of the grid row being composed
+struct Tile
+{
+    Tile(const Canvas& canvas) : rows(canvas), modules(rows.PackedRowSize()), cached(-1) {}
+
+    CanvasRows rows;
+    std::vector<uint8_t> modules;
+    int cached;                         // module row held in modules
+};
+
+} // namespace
+
+// =============================================================================
+
+bool RenderSheet(std::span<const Canvas> canvases, const SheetLayout& layout, RowSink& sink,
+                 std::span<const std::string> captions, std::stop_token stop)
+{
+    if (layout.columns == 0 || layout.symbol.scale < 1 || layout.symbol.indent < 0 || layout.caption_scale == 0)
+        throw Error("Sheet needs at least one column and positive scales");
+    if (!captions.empty() && captions.size() != canvases.size())
+        throw Error(std::format("Got {} captions for {} codes", captions.size(), canvases.size()));
+
+    const size_t scale = layout.symbol.scale;
+    const size_t indent = layout.symbol.indent;
+    auto symbol_size = [&](const Canvas& canvas) { return (canvas.Size() + 2*indent) * scale; };
+
+    size_t largest = 0;
+    for (const Canvas& canvas: canvases)
+        largest = std::max(largest, symbol_size(canvas));
+
+    // captions start right below the quiet zone and keep one dot below them
+    const size_t dot = layout.caption_scale;
+    const size_t caption_height = captions.empty() ? 0 : (GLYPH_HEIGHT + 1) * dot;
+    const size_t cell_width = layout.cell_width ? layout.cell_width : largest;
+    const size_t cell_height = layout.cell_height ? layout.cell_height : largest + caption_height;
+    if (largest > cell_width || largest + caption_height > cell_height)
+        throw Error(std::format("Cells of {}x{} pixels are too small for codes of {} pixels",
+                                cell_width, cell_height, largest));
+
+    const size_t grid_rows = (canvases.size() + layout.columns - 1) / layout.columns;
+    const size_t width = 2*layout.margin + layout.columns*cell_width + (layout.columns - 1)*layout.spacing;
+    const size_t height = 2*layout.margin + grid_rows*cell_height + (grid_rows ? grid_rows - 1 : 0)*layout.spacing;
+    const size_t stride = (width + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+
+    std::vector<uint8_t> row(stride);
+    const std::vector<uint8_t> blank(stride, 0);
+    auto push = [&](std::span<const uint8_t> pixels) {
+        if (stop.stop_requested() || !sink.Row(pixels))
+        {
+            sink.Abort();
+            return false;
+        }
+        return true;
+    };
+    auto push_blank = [&](size_t count) {
+        for (size_t i = 0; i < count; i++)
+            if (!push(blank))
+                return false;
+        return true;
+    };
+
+    sink.Begin(width, height);
+    if (!push_blank(layout.margin))
+        return false;
+
+    const auto& kernels = GetKernels();
+    for (size_t grid_row = 0; grid_row < grid_rows; grid_row++)
+    {
+        if (grid_row > 0 && !push_blank(layout.spacing))
+            return false;
+
+        const size_t first = grid_row * layout.columns;
+        const size_t count = std::min(layout.columns, canvases.size() - first);
+        std::vector<Tile> tiles(canvases.begin() + first, canvases.begin() + first + count);
+
+        // cells are drawn left to right: expand_bits keeps the pixels before its
+        // offset but clears the rest of its last byte
+        for (size_t y = 0; y < cell_height; y++)
+        {
+            std::fill(row.begin(), row.end(), 0);
+            for (size_t i = 0; i < count; i++)
+            {
+                Tile& tile = tiles[i];
+                const size_t cell_x = layout.margin + i*(cell_width + layout.spacing);
+                const size_t size = symbol_size(canvases[first + i]);
+                const size_t x = cell_x + (cell_width - size) / 2;
+
+                if (y < size)
+                {
+                    int module_row = static_cast<int>(y / scale) - static_cast<int>(indent);
+                    if (module_row < 0 || module_row >= static_cast<int>(tile.rows.Size()))
+                        continue;
+                    if (module_row != tile.cached)
+                    {
+                        tile.rows.PackedRow(module_row, tile.modules);
+                        tile.cached = module_row;
+                    }
+                    kernels.expand_bits(tile.modules.data(), tile.rows.Size(), scale, x + indent*scale, row.data());
+                }
+                else if (!captions.empty() && y < size + GLYPH_HEIGHT*dot)
+                {
+                    const std::string& caption = captions[first + i];
+                    const size_t glyph_row = (y - size) / dot;
+                    const size_t advance = (GLYPH_WIDTH + 1) * dot;
+                    const size_t text_width = caption.size() * advance;
+                    const size_t cell_end = cell_x + cell_width;
+                    size_t text_x = cell_x + (text_width < cell_width ? (cell_width - text_width + dot) / 2 : 0);
+
+                    for (char c: caption)
+                    {
+                        if (text_x >= cell_end)
+                            break;
+                        uint8_t bits = Glyph(c)[glyph_row];
+                        for (size_t col = 0; col < GLYPH_WIDTH; col++)
+                        {
+                            size_t begin = text_x + col*dot;
+                            if (bits & (1 << (GLYPH_WIDTH - 1 - col)))
+                                FillPixels(row.data(), begin, std::min(begin + dot, cell_end));
+                        }
+                        text_x += advance;
+                    }
+                }
+            }
+            if (!push(row))
+                return false;
+        }
+    }
+
+    if (!push_blank(layout.margin))
+        return false;
+    sink.End();
+    return true;
+}
+
+// =============================================================================
+
+void SheetOutputter::Output(std::span<const Canvas> canvases, std::span<const std::string> captions)
+{
+    if (!sink_)
+        throw Error("SheetOutputter has no sink of its own, pass one to Output");
+    Output(canvases, captions, *sink_);
+}
+
+void SheetOutputter::Output(std::span<const Canvas> canvases, std::span<const std::string> captions, ByteSink& sink)
+{
+    if (format_ == SheetFormat::PBM)
+    {
+        PbmRowSink rows(sink);
+        RenderSheet(canvases, layout_, rows, captions);
+    }
+    else
+    {
+        PngRowSink rows(sink);
+        RenderSheet(canvases, layout_, rows, captions);
+    }
+    sink.Flush();
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,459 @@
+#include "simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <format>
+
+#include "core.hpp"
+#include "defines.hpp"
+#include "error.hpp"
+#include "logger.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MYQRO_X86 1
+#include <immintrin.h>
+#endif
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+constexpr size_t BITS = 8;
+
+// =============================================================================
+
+// Kernel bodies are written once as plain loops. They are force-inlined into the
+// per-level entry points below, so the compiler vectorizes them for every level.
+#define MYQRO_KERNEL [[gnu::always_inline]] inline
+
+// Multiplication by alpha (x) modulo the QR primitive polynomial x^8+x^4+x^3+x^2+1
+MYQRO_KERNEL uint8_t MulAlpha(uint8_t x)
+{
+    return static_cast<uint8_t>((x << 1) ^ ((x >> 7) * 0b00011101));
+}
+
+// Parity registers are kept in a ring of rows, so the shift of the register is
+// just a move of the head. A product g*A is the sum of A*alpha^k over the set bits
+// k of g, so every multiply-accumulate is a few XORs of whole rows.
+MYQRO_KERNEL void CorrectionTileImpl(const uint8_t* data, size_t block_size, size_t stride, size_t width,
+                                     const uint8_t* generator, size_t n, uint8_t* parity)
+{
+    uint8_t ring[MAX_CORRECTION_BYTES][CORRECTION_TILE_LANES] = {};
+    uint8_t powers[BITS][CORRECTION_TILE_LANES];
+    size_t head = 0;
+
+    for (size_t j = 0; j < block_size; j++)
+    {
+        const uint8_t* row = data + j * stride;
+        for (size_t l = 0; l < width; l++)
+            powers[0][l] = row[l] ^ ring[head][l];
+        for (size_t k = 1; k < BITS; k++)
+            for (size_t l = 0; l < width; l++)
+                powers[k][l] = MulAlpha(powers[k - 1][l]);
+
+        // the highest degree register leaves and its row becomes the lowest one
+        std::fill(ring[head], ring[head] + width, 0);
+        head = (head + 1) % n;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            uint8_t* dst = ring[(head + i) % n];
+            for (uint8_t m = generator[i]; m != 0; m &= m - 1)
+            {
+                const uint8_t* src = powers[std::countr_zero(m)];
+                for (size_t l = 0; l < width; l++)
+                    dst[l] ^= src[l];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+        std::copy(ring[(head + i) % n], ring[(head + i) % n] + width, parity + i * stride);
+}
+
+MYQRO_KERNEL void UnpackBitsImpl(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (src[i / BITS] >> (BITS - 1 - i % BITS)) & 1;
+}
+
+MYQRO_KERNEL void XorBytesImpl(uint8_t* dst, const uint8_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] ^= src[i];
+}
+
+// The penalty rules of core over rows of a plane
+MYQRO_KERNEL size_t PenaltyRunsImpl(const uint8_t* plane, size_t width, size_t rows)
+{
+    return core::PenaltyRuns([plane, width](size_t r, size_t c) { return plane[r * width + c]; }, width, rows);
+}
+
+MYQRO_KERNEL size_t PenaltySquaresImpl(const uint8_t* plane, size_t width, size_t rows)
+{
+    return core::PenaltySquares([plane, width](size_t r, size_t c) { return plane[r * width + c]; }, width, rows);
+}
+
+MYQRO_KERNEL size_t PenaltyFindersImpl(const uint8_t* plane, size_t width, size_t rows)
+{
+    return core::PenaltyFinders([plane, width](size_t r, size_t c) { return plane[r * width + c]; }, width, rows);
+}
+
+MYQRO_KERNEL size_t CountOnesImpl(const uint8_t* data, size_t count)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < count; i++)
+        result += data[i] != 0;
+    return result;
+}
+
+// =============================================================================
+
+constexpr size_t MIN_FAST_SCALE = 2;
+constexpr size_t MAX_FAST_SCALE = 16;
+constexpr size_t NIBBLE = 4;
+
+// Appends bit strings to a packed MSB-first row. Pending bits are kept at the top
+// of a 64-bit word, so every append is a shift and an OR.
+class BitAppender
+{
+public:
+    MYQRO_KERNEL BitAppender(uint8_t* dst, size_t offset) :
+        dst_(dst + offset / BITS),
+        acc_(static_cast<uint64_t>(dst_[0]) << 56),
+        n_(offset % BITS)
+    {}
+
+    // Appends the low `count` bits of value, count <= 64
+    MYQRO_KERNEL void Append(uint64_t value, size_t count)
+    {
+        if (count > 32)
+        {
+            Put(value >> 32, count - 32);
+            Put(value & 0xFFFFFFFF, 32);
+        }
+        else
+        {
+            Put(value, count);
+        }
+    }
+
+    // `count` equal bits
+    MYQRO_KERNEL void Run(bool bit, size_t count)
+    {
+        for (; count > 32; count -= 32)
+            Put(bit ? 0xFFFFFFFF : 0, 32);
+        Put(bit ? (uint64_t(1) << count) - 1 : 0, count);
+    }
+
+    MYQRO_KERNEL void Finish()
+    {
+        if (n_ > 0)
+            *dst_ = static_cast<uint8_t>(acc_ >> 56);
+    }
+
+private:
+    // count <= 32, so pending bits (less than a byte) and value always fit
+    MYQRO_KERNEL void Put(uint64_t value, size_t count)
+    {
+        if (count == 0)
+            return;
+        acc_ |= value << (64 - n_ - count);
+        n_ += count;
+        while (n_ >= BITS)
+        {
+            *dst_++ = static_cast<uint8_t>(acc_ >> 56);
+            acc_ <<= BITS;
+            n_ -= BITS;
+        }
+    }
+
+private:
+    uint8_t* dst_;
+    uint64_t acc_;
+    size_t n_;
+};
+
+MYQRO_KERNEL bool ModuleBit(const uint8_t* src, size_t i)
+{
+    return (src[i / BITS] >> (BITS - 1 - i % BITS)) & 1;
+}
+
+// Expanded nibbles for fast scales: 4 * scale <= 64 bits each
+constexpr std::array<std::array<uint64_t, 16>, MAX_FAST_SCALE + 1> MakeNibbleTable()
+{
+    std::array<std::array<uint64_t, 16>, MAX_FAST_SCALE + 1> table = {};
+    for (size_t scale = MIN_FAST_SCALE; scale <= MAX_FAST_SCALE; scale++)
+    {
+        for (size_t nibble = 0; nibble < 16; nibble++)
+        {
+            uint64_t value = 0;
+            for (size_t bit = 0; bit < NIBBLE; bit++)
+                if ((nibble >> bit) & 1)
+                    value |= ((uint64_t(1) << scale) - 1) << (bit * scale);
+            table[scale][nibble] = value;
+        }
+    }
+    return table;
+}
+
+constexpr auto NibbleTable = MakeNibbleTable();
+
+// Fast scales take whole nibbles from the table, the rest modules are appended as
+// runs of equal bits
+void ExpandBitsTable(const uint8_t* src, size_t count, size_t scale, size_t offset, uint8_t* dst)
+{
+    BitAppender out(dst, offset);
+    size_t i = 0;
+    if (scale >= MIN_FAST_SCALE && scale <= MAX_FAST_SCALE)
+    {
+        const auto& table = NibbleTable[scale];
+        for (; i + NIBBLE <= count; i += NIBBLE)
+            out.Append(table[(src[i / BITS] >> (BITS - NIBBLE - i % BITS)) & 0xF], NIBBLE * scale);
+    }
+    for (; i < count; i++)
+        out.Run(ModuleBit(src, i), scale);
+    out.Finish();
+}
+
+// =============================================================================
+
+// Entry points of one level: every kernel body compiled with the given target
+#define MYQRO_DEFINE_CORRECTION_TILE(NAME, TARGET)                                                      \
+    TARGET void CorrectionTile##NAME(const uint8_t* data, size_t block_size, size_t stride,             \
+                                     size_t width, const uint8_t* generator, size_t n, uint8_t* parity) \
+    { CorrectionTileImpl(data, block_size, stride, width, generator, n, parity); }
+
+#define MYQRO_DEFINE_KERNELS(NAME, TARGET)                                                              \
+    TARGET void UnpackBits##NAME(const uint8_t* src, size_t count, uint8_t* dst)                        \
+    { UnpackBitsImpl(src, count, dst); }                                                                \
+    TARGET void XorBytes##NAME(uint8_t* dst, const uint8_t* src, size_t count)                          \
+    { XorBytesImpl(dst, src, count); }                                                                  \
+    TARGET size_t PenaltyRuns##NAME(const uint8_t* plane, size_t width, size_t rows)                    \
+    { return PenaltyRunsImpl(plane, width, rows); }                                                     \
+    TARGET size_t PenaltySquares##NAME(const uint8_t* plane, size_t width, size_t rows)                 \
+    { return PenaltySquaresImpl(plane, width, rows); }                                                  \
+    TARGET size_t PenaltyFinders##NAME(const uint8_t* plane, size_t width, size_t rows)                 \
+    { return PenaltyFindersImpl(plane, width, rows); }                                                  \
+    TARGET size_t CountOnes##NAME(const uint8_t* data, size_t count)                                    \
+    { return CountOnesImpl(data, count); }
+
+MYQRO_DEFINE_CORRECTION_TILE(Sse2, )
+MYQRO_DEFINE_KERNELS(Sse2, )
+
+#ifdef MYQRO_X86
+
+#define MYQRO_TARGET_AVX2 [[gnu::target("avx2,bmi2")]]
+#define MYQRO_TARGET_AVX512 [[gnu::target("avx512f,avx512bw,avx512vl,gfni,bmi2")]]
+
+#define MYQRO_TARGET_BMI2 [[gnu::target("bmi2")]]
+
+MYQRO_DEFINE_CORRECTION_TILE(Avx2, MYQRO_TARGET_AVX2)
+MYQRO_DEFINE_KERNELS(Avx2, MYQRO_TARGET_AVX2)
+MYQRO_DEFINE_KERNELS(Avx512, MYQRO_TARGET_AVX512)
+
+// =============================================================================
+
+// Multiplication by a constant is linear over GF(2), so it is one GF2P8AFFINEQB with
+// the 8x8 bit matrix of the constant. Row i of the matrix (byte 7 - i) selects the
+// input bits which contribute to the output bit i.
+uint64_t MulMatrix(uint8_t c)
+{
+    uint8_t products[BITS];
+    products[0] = c;
+    for (size_t k = 1; k < BITS; k++)
+        products[k] = MulAlpha(products[k - 1]);
+
+    uint64_t matrix = 0;
+    for (size_t i = 0; i < BITS; i++)
+    {
+        uint64_t row = 0;
+        for (size_t k = 0; k < BITS; k++)
+            row |= static_cast<uint64_t>((products[k] >> i) & 1) << k;
+        matrix |= row << (BITS * (BITS - 1 - i));
+    }
+    return matrix;
+}
+
+MYQRO_TARGET_AVX512 void CorrectionTileGfni(const uint8_t* data, size_t block_size, size_t stride, size_t width,
+                                            const uint8_t* generator, size_t n, uint8_t* parity)
+{
+    static_assert(CORRECTION_TILE_LANES == 64, "One tile must fit into one AVX-512 register");
+
+    __m512i matrices[MAX_CORRECTION_BYTES];
+    __m512i ring[MAX_CORRECTION_BYTES];
+    for (size_t i = 0; i < n; i++)
+    {
+        matrices[i] = _mm512_set1_epi64(static_cast<long long>(MulMatrix(generator[i])));
+        ring[i] = _mm512_setzero_si512();
+    }
+
+    const __mmask64 lanes = (width >= CORRECTION_TILE_LANES) ? ~__mmask64(0) : ((__mmask64(1) << width) - 1);
+    size_t head = 0;
+    for (size_t j = 0; j < block_size; j++)
+    {
+        __m512i a = _mm512_xor_si512(_mm512_maskz_loadu_epi8(lanes, data + j * stride), ring[head]);
+
+        ring[head] = _mm512_setzero_si512();
+        head = (head + 1) % n;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            __m512i& dst = ring[(head + i) % n];
+            dst = _mm512_xor_si512(dst, _mm512_gf2p8affine_epi64_epi8(a, matrices[i], 0));
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+        _mm512_mask_storeu_epi8(parity + i * stride, lanes, ring[(head + i) % n]);
+}
+
+// =============================================================================
+
+// PDEP puts bit k of a byte (or a nibble for scales above 8) at bit k * scale,
+// multiplication by 2^scale - 1 then fills every group without carries
+MYQRO_TARGET_BMI2 void ExpandBitsPdep(const uint8_t* src, size_t count, size_t scale, size_t offset, uint8_t* dst)
+{
+    if (scale < MIN_FAST_SCALE || scale > MAX_FAST_SCALE)
+        return ExpandBitsTable(src, count, scale, offset, dst);
+
+    const size_t group = (scale * BITS <= 64) ? BITS : NIBBLE;
+    uint64_t mask = 0;
+    for (size_t k = 0; k < group; k++)
+        mask |= uint64_t(1) << (k * scale);
+    const uint64_t fill = (uint64_t(1) << scale) - 1;
+
+    BitAppender out(dst, offset);
+    size_t i = 0;
+    for (; i + group <= count; i += group)
+    {
+        uint64_t bits = (src[i / BITS] >> (BITS - group - i % BITS)) & ((1u << group) - 1);
+        out.Append(_pdep_u64(bits, mask) * fill, group * scale);
+    }
+    for (; i < count; i++)
+        out.Run(ModuleBit(src, i), scale);
+    out.Finish();
+}
+
+#endif // MYQRO_X86
+
+// =============================================================================
+
+#define MYQRO_KERNELS_TABLE(LEVEL, NAME, TILE, EXPAND) \
+    Kernels{LEVEL, TILE, UnpackBits##NAME, XorBytes##NAME, PenaltyRuns##NAME, PenaltySquares##NAME, PenaltyFinders##NAME, CountOnes##NAME, EXPAND}
+
+const Kernels& KernelsTable(SimdLevel level)
+{
+    static const Kernels sse2 = MYQRO_KERNELS_TABLE(SimdLevel::SSE2, Sse2, CorrectionTileSse2, ExpandBitsTable);
+#ifdef MYQRO_X86
+    static const Kernels avx2 = MYQRO_KERNELS_TABLE(SimdLevel::AVX2, Avx2, CorrectionTileAvx2, ExpandBitsPdep);
+    static const Kernels avx512 = MYQRO_KERNELS_TABLE(SimdLevel::AVX512, Avx512, CorrectionTileGfni, ExpandBitsPdep);
+
+    switch (level)
+    {
+        case SimdLevel::SSE2:   return sse2;
+        case SimdLevel::AVX2:   return avx2;
+        case SimdLevel::AVX512: return avx512;
+    }
+#endif
+    return sse2;
+}
+
+// =============================================================================
+
+const Kernels& SelectKernels()
+{
+    SimdLevel level = DetectSimdLevel();
+    if (const char* forced = std::getenv("MYQRO_SIMD"); forced != nullptr)
+    {
+        SimdLevel requested = level;
+        try
+        {
+            requested = SimdLevelFromString(forced);
+        }
+        catch (const Error& e)
+        {
+            LogWarning("Ignoring MYQRO_SIMD: {}, using {}", e.what(), SimdLevelToString(level));
+        }
+
+        if (requested > level)
+            LogWarning("SIMD level {} is not supported by CPU, using {}",
+                       SimdLevelToString(requested), SimdLevelToString(level));
+        else
+            level = requested;
+    }
+    LogDebug("Using SIMD level {}", SimdLevelToString(level));
+    return KernelsTable(level);
+}
+
+} // namespace
+
+// =============================================================================
+
+const char* SimdLevelToString(SimdLevel l)
+{
+    switch (l)
+    {
+        case SimdLevel::SSE2:   return "sse2";
+        case SimdLevel::AVX2:   return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+    }
+    throw Error("Can not convert unknown SIMD level to string");
+}
+
+// =============================================================================
+
+SimdLevel SimdLevelFromString(const std::string& s)
+{
+    if (s == "sse2" || s == "SSE2")     return SimdLevel::SSE2;
+    if (s == "avx2" || s == "AVX2")     return SimdLevel::AVX2;
+    if (s == "avx512" || s == "AVX512") return SimdLevel::AVX512;
+    throw Error(std::format("Unknown SIMD level: {}", s));
+}
+
+// =============================================================================
+
+SimdLevel DetectSimdLevel()
+{
+#ifdef MYQRO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("gfni") && __builtin_cpu_supports("bmi2"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+        return SimdLevel::AVX2;
+#endif
+    return SimdLevel::SSE2;
+}
+
+// =============================================================================
+
+const Kernels& GetKernels()
+{
+    static const Kernels& kernels = SelectKernels();
+    return kernels;
+}
+
+// =============================================================================
+
+const Kernels& GetKernels(SimdLevel level)
+{
+    if (level > DetectSimdLevel())
+        throw Error(std::format("SIMD level {} is not supported by CPU", SimdLevelToString(level)));
+    return KernelsTable(level);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,173 @@
+#include "sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "error.hpp"
+#include "logger.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+void SpanSink::Write(std::span<const uint8_t> data)
+{
+    if (data.empty())
+        return;
+
+    if (data.size() > buffer_.size() - size_)
+        throw Error(std::format("Buffer of {} bytes is too small, {} more bytes are needed",
+                                buffer_.size(), size_ + data.size() - buffer_.size()));
+
+    std::memcpy(buffer_.data() + size_, data.data(), data.size());
+    size_ += data.size();
+}
+
+// =============================================================================
+
+void StreamSink::Write(std::span<const uint8_t> data)
+{
+    stream_.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// =============================================================================
+
+FdSink::FdSink(int fd, size_t buffer_size) :
+    fd_(fd),
+    buffer_(std::max<size_t>(buffer_size, 1)),
+    size_(0)
+{}
+
+FdSink::~FdSink()
+{
+    try
+    {
+        Flush();
+    }
+    catch (const Error& e)
+    {
+        LogError("{}", e.what());
+    }
+}
+
+void FdSink::Write(std::span<const uint8_t> data)
+{
+    if (data.empty())
+        return;
+
+    // large writes bypass the buffer
+    if (data.size() >= buffer_.size())
+    {
+        Flush();
+        WriteAll(data.data(), data.size());
+        return;
+    }
+
+    if (data.size() > buffer_.size() - size_)
+        Flush();
+    std::memcpy(buffer_.data() + size_, data.data(), data.size());
+    size_ += data.size();
+}
+
+void FdSink::Flush()
+{
+    size_t size = size_;
+    size_ = 0;
+    WriteAll(buffer_.data(), size);
+}
+
+void FdSink::WriteAll(const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw Error(std::format("Error writing to file descriptor {}: {}", fd_, std::strerror(errno)));
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// =============================================================================
+
+FileSink::FileSink(const std::filesystem::path& path, size_t buffer_size) :
+    FdSink(-1, buffer_size),
+    path_(path)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw Error(std::format("Error opening file {}: {}", path_.string(), std::strerror(errno)));
+    SetFd(fd);
+}
+
+FileSink::~FileSink()
+{
+    try
+    {
+        Flush();
+    }
+    catch (const Error& e)
+    {
+        LogError("{}", e.what());
+    }
+    ::close(Fd());
+}
+
+// =============================================================================
+
+MappedFile::MappedFile(const std::filesystem::path& path, size_t size) :
+    path_(path),
+    fd_(-1),
+    data_(nullptr),
+    size_(size)
+{
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+        throw Error(std::format("Error opening file {}: {}", path_.string(), std::strerror(errno)));
+
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+    {
+        int error = errno;
+        ::close(fd_);
+        throw Error(std::format("Error resizing file {} to {} bytes: {}", path_.string(), size, std::strerror(error)));
+    }
+
+    if (size == 0)
+        return;
+
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED)
+    {
+        int error = errno;
+        ::close(fd_);
+        throw Error(std::format("Error mapping file {}: {}", path_.string(), std::strerror(error)));
+    }
+    data_ = static_cast<std::byte*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        ::munmap(data_, size_);
+    ::close(fd_);
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,163 @@
+#include "symbol_view.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <mutex>
+
+#include "error.hpp"
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+void SymbolRows::Row(size_t row, std::span<uint8_t> values) const
+{
+    for (size_t col = 0; col < Size(); col++)
+        values[col] = Module(row, col);
+}
+
+void SymbolRows::PackedRow(size_t row, std::span<uint8_t> bits) const
+{
+    std::fill_n(bits.begin(), PackedRowSize(), 0);
+    for (size_t col = 0; col < Size(); col++)
+        bits[col / BITS_PER_BYTE] |= Module(row, col) << (BITS_PER_BYTE - 1 - col % BITS_PER_BYTE);
+}
+
+// =============================================================================
+
+SymbolView::SymbolView(std::vector<uint8_t> codewords, size_t version, CorrectionLevel cl, size_t mask_id) :
+    codewords_(std::move(codewords)),
+    version_(Validate(version, mask_id)),
+    size_(SymbolSize(version)),
+    cl_(cl),
+    mask_id_(mask_id),
+    blocks_(version, cl),
+    n_bits_(core::CodewordsCount(version) * BITS_PER_BYTE),
+    format_code_(CorrectionLevelMaskCode.at(cl)[mask_id]),
+    placement_(&PlacementOf(version))
+{
+    if (codewords_.size() < core::CodewordsCount(version))
+        throw Error(std::format("Symbol of version {} needs {} codewords, got {}",
+                                version, core::CodewordsCount(version), codewords_.size()));
+}
+
+size_t SymbolView::Validate(size_t version, size_t mask_id)
+{
+    if (version < MIN_VERSION || version > MAX_VERSION)
+        throw Error(std::format("No such version: {}", version));
+    if (mask_id > MAX_MASK_ID)
+        throw Error(std::format("No such mask: {}", mask_id));
+    return version;
+}
+
+SymbolView SymbolView::Encode(const std::string& msg, CorrectionLevel cl, EncodingType encoding, int mask_id)
+{
+    std::vector<uint8_t> codewords(core::MAX_CODEWORDS);
+    size_t version = 0;
+    core::Status status = core::EncodeCodewords(msg.data(), msg.size(), encoding, cl,
+                                                codewords.data(), codewords.size(), version);
+    if (status != core::Status::OK)
+        throw Error(std::format("Can't encode message: {}", core::StatusToString(status)));
+    codewords.resize(core::CodewordsCount(version));
+
+    size_t chosen_mask = 0;
+    {
+        std::vector<uint8_t> modules(SymbolSize(version) * SymbolSize(version));
+        status = core::RenderModules(codewords.data(), version, cl, mask_id, modules.data(), modules.size(), chosen_mask);
+        if (status != core::Status::OK)
+            throw Error(std::format("Can't render symbol: {}", core::StatusToString(status)));
+    }
+
+    return SymbolView(std::move(codewords), version, cl, chosen_mask);
+}
+
+// =============================================================================
+
+uint8_t SymbolView::Value(size_t index, size_t row, size_t col) const
+{
+    int32_t bit = placement_->bits[index];
+    if (bit >= 0)
+    {
+        size_t b = static_cast<size_t>(bit);
+        uint8_t value = 0;
+        if (b < n_bits_)
+            value = (blocks_.Interleaved(codewords_.data(), b / BITS_PER_BYTE) >> (BITS_PER_BYTE - 1 - b % BITS_PER_BYTE)) & 1;
+        return value ^ MaskBit(mask_id_, row, col);
+    }
+    if (bit == Placement::FUNCTION)
+        return placement_->functions[index];
+    return (format_code_ >> (Placement::FORMAT - bit)) & 1;
+}
+
+uint8_t SymbolView::Module(size_t row, size_t col) const
+{
+    return Value(row * size_ + col, row, col);
+}
+
+void SymbolView::Row(size_t row, std::span<uint8_t> values) const
+{
+    for (size_t col = 0; col < size_; col++)
+        values[col] = Value(row * size_ + col, row, col);
+}
+
+void SymbolView::PackedRow(size_t row, std::span<uint8_t> bits) const
+{
+    uint8_t byte = 0;
+    for (size_t col = 0; col < size_; col++)
+    {
+        byte = (byte << 1) | Value(row * size_ + col, row, col);
+        if (col % BITS_PER_BYTE == BITS_PER_BYTE - 1)
+        {
+            bits[col / BITS_PER_BYTE] = byte;
+            byte = 0;
+        }
+    }
+    if (size_ % BITS_PER_BYTE)
+        bits[size_ / BITS_PER_BYTE] = byte << (BITS_PER_BYTE - size_ % BITS_PER_BYTE);
+}
+
+// =============================================================================
+
+const SymbolView::Placement& SymbolView::PlacementOf(size_t version)
+{
+    if (version < MIN_VERSION || version > MAX_VERSION)
+        throw Error(std::format("No such version: {}", version));
+
+    static std::array<Placement, VERSION_ARRAY_SIZE> placements;
+    static std::array<std::once_flag, VERSION_ARRAY_SIZE> flags;
+
+    Placement& placement = placements[version - MIN_VERSION];
+    std::call_once(flags[version - MIN_VERSION], [&placement, version]()
+    {
+        const int size = SymbolSize(version);
+        std::vector<uint8_t> modules(size * size);
+        core::PlaceFunctionPatterns(modules.data(), version);
+
+        placement.bits.assign(size * size, Placement::FUNCTION);
+        placement.functions.resize(size * size);
+        for (int i = 0; i < size * size; i++)
+            placement.functions[i] = modules[i] & core::MODULE_DARK;
+
+        core::ForEachFormatModule(version, [&placement, size](int r, int c, int shift) {
+            placement.bits[r * size + c] = Placement::FORMAT - shift;
+        });
+
+        int32_t bit = 0;
+        core::ForEachPlacementModule(version, [&placement, &modules, &bit, size](int r, int c) {
+            if (!(modules[r * size + c] & core::MODULE_FUNCTION))
+                placement.bits[r * size + c] = bit++;
+        });
+    });
+    return placement;
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
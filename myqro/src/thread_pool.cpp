@@ -0,0 +1,140 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+
+// =============================================================================
+
+namespace myqro
+{
+
+// =============================================================================
+
+namespace
+{
+
+// Shared state of one ParallelFor call. Helper tasks may be picked up by workers
+// after the call has already returned, so it is owned by a shared_ptr.
+struct Batch
+{
+    std::atomic<size_t> next{0};
+    size_t count = 0;
+    size_t finished = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void Run(const std::function<void(size_t)>& f)
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            std::exception_ptr e;
+            try
+            {
+                f(i);
+            }
+            catch (...)
+            {
+                e = std::current_exception();
+            }
+
+            std::lock_guard lock(mutex);
+            if (e && !error) error = e;
+            if (++finished == count) cv.notify_all();
+        }
+    }
+};
+
+} // namespace
+
+// =============================================================================
+
+ThreadPool::ThreadPool(size_t n_workers) :
+    stop_(false)
+{
+    workers_.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; i++)
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+// =============================================================================
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& t: workers_)
+        t.join();
+}
+
+// =============================================================================
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& f)
+{
+    if (count == 0) return;
+
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+
+    // f is only called for indices claimed before the batch is exhausted, and we
+    // wait for all of them below, so capturing it by reference is safe
+    size_t n_helpers = std::min(count - 1, workers_.size());
+    if (n_helpers > 0)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            for (size_t i = 0; i < n_helpers; i++)
+                tasks_.emplace_back([batch, &f]() { batch->Run(f); });
+        }
+        cv_.notify_all();
+    }
+
+    batch->Run(f);
+
+    std::unique_lock lock(batch->mutex);
+    batch->cv.wait(lock, [&batch]() { return batch->finished == batch->count; });
+    if (batch->error)
+        std::rethrow_exception(batch->error);
+}
+
+// =============================================================================
+
+ThreadPool& ThreadPool::Shared()
+{
+    static ThreadPool pool([]() -> size_t {
+        size_t n_threads = std::thread::hardware_concurrency();
+        return std::min(n_threads > 0 ? n_threads - 1 : 0, MAX_SHARED_WORKERS);
+    }());
+    return pool;
+}
+
+// =============================================================================
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            if (stop_ && tasks_.empty()) return;
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+// =============================================================================
+
+} // namespace myqro
+
+// =============================================================================
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+// Straightforward CCITT T.6 decoder working on pixels instead of changing
+// elements, enough to check streams written by G4Encoder. Returns one byte per
+// pixel, 1 is black.
+inline std::vector<std::vector<uint8_t>> DecodeG4(std::span<const uint8_t> data, size_t width, size_t height)
+{
+    static const char* const WhiteTerminating[] = {
+        "00110101", "000111", "0111", "1000", "1011", "1100", "1110", "1111",
+        "10011", "10100", "00111", "01000", "001000", "000011", "110100", "110101",
+        "101010", "101011", "0100111", "0001100", "0001000", "0010111", "0000011", "0000100",
+        "0101000", "0101011", "0010011", "0100100", "0011000", "00000010", "00000011", "00011010",
+        "00011011", "00010010", "00010011", "00010100", "00010101", "00010110", "00010111", "00101000",
+        "00101001", "00101010", "00101011", "00101100", "00101101", "00000100", "00000101", "00001010",
+        "00001011", "01010010", "01010011", "01010100", "01010101", "00100100", "00100101", "01011000",
+        "01011001", "01011010", "01011011", "01001010", "01001011", "00110010", "00110011", "00110100",
+    };
+
+    static const char* const WhiteMakeup[] = {
+        "11011", "10010", "010111", "0110111", "00110110", "00110111", "01100100", "01100101",
+        "01101000", "01100111", "011001100", "011001101", "011010010", "011010011", "011010100", "011010101",
+        "011010110", "011010111", "011011000", "011011001", "011011010", "011011011", "010011000", "010011001",
+        "010011010", "011000", "010011011",
+    };
+
+    static const char* const BlackTerminating[] = {
+        "0000110111", "010", "11", "10", "011", "0011", "0010", "00011",
+        "000101", "000100", "0000100", "0000101", "0000111", "00000100", "00000111", "000011000",
+        "0000010111", "0000011000", "0000001000", "00001100111", "00001101000", "00001101100", "00000110111", "00000101000",
+        "00000010111", "00000011000", "000011001010", "000011001011", "000011001100", "000011001101", "000001101000", "000001101001",
+        "000001101010", "000001101011", "000011010010", "000011010011", "000011010100", "000011010101", "000011010110", "000011010111",
+        "000001101100", "000001101101", "000011011010", "000011011011", "000001010100", "000001010101", "000001010110", "000001010111",
+        "000001100100", "000001100101", "000001010010", "000001010011", "000000100100", "000000110111", "000000111000", "000000100111",
+        "000000101000", "000001011000", "000001011001", "000000101011", "000000101100", "000001011010", "000001100110", "000001100111",
+    };
+
+    static const char* const BlackMakeup[] = {
+        "0000001111", "000011001000", "000011001001", "000001011011", "000000110011", "000000110100", "000000110101", "0000001101100",
+        "0000001101101", "0000001001010", "0000001001011", "0000001001100", "0000001001101", "0000001110010", "0000001110011", "0000001110100",
+        "0000001110101", "0000001110110", "0000001110111", "0000001010010", "0000001010011", "0000001010100", "0000001010101", "0000001011010",
+        "0000001011011", "0000001100100", "0000001100101",
+    };
+
+    static const char* const ExtendedMakeup[] = {
+        "00000001000", "00000001100", "00000001101", "000000010010", "000000010011", "000000010100", "000000010101", "000000010110",
+        "000000010111", "000000011100", "000000011101", "000000011110", "000000011111",
+    };
+    // (length, code) -> run, make-up codes of both colors included
+    auto build = [](const char* const* terminating, const char* const* makeup) {
+        std::map<std::pair<size_t, std::string>, size_t> codes;
+        for (size_t run = 0; run < 64; run++)
+            codes[{std::string(terminating[run]).size(), terminating[run]}] = run;
+        for (size_t i = 0; i < 27; i++)
+            codes[{std::string(makeup[i]).size(), makeup[i]}] = 64 * (i + 1);
+        for (size_t i = 0; i < 13; i++)
+            codes[{std::string(ExtendedMakeup[i]).size(), ExtendedMakeup[i]}] = 1792 + 64 * i;
+        return codes;
+    };
+    const auto white = build(WhiteTerminating, WhiteMakeup);
+    const auto black = build(BlackTerminating, BlackMakeup);
+
+    size_t bit = 0;
+    auto read = [&]() {
+        if (bit / 8 >= data.size())
+            throw std::runtime_error("Unexpected end of G4 stream");
+        char value = ((data[bit / 8] >> (7 - bit % 8)) & 1) ? '1' : '0';
+        bit++;
+        return value;
+    };
+    auto mode = [&]() {
+        static const std::map<std::string, int> modes = {
+            {"1", 0}, {"011", 1}, {"000011", 2}, {"0000011", 3}, {"010", -1}, {"000010", -2}, {"0000010", -3},
+            {"001", 10}, {"0001", 20}, {"000000000001", 30},
+        };
+        std::string code;
+        while (code.size() < 12)
+        {
+            code += read();
+            if (auto it = modes.find(code); it != modes.end())
+                return it->second;
+        }
+        throw std::runtime_error("Invalid G4 mode code " + code);
+    };
+    auto run = [&](bool is_black) {
+        const auto& codes = is_black ? black : white;
+        size_t total = 0;
+        while (true)
+        {
+            std::string code;
+            auto it = codes.end();
+            while (it == codes.end())
+            {
+                if (code.size() >= 13)
+                    throw std::runtime_error("Invalid G4 run code " + code);
+                code += read();
+                it = codes.find({code.size(), code});
+            }
+            total += it->second;
+            if (it->second < 64)
+                return total;
+        }
+    };
+
+    std::vector<std::vector<uint8_t>> rows;
+    std::vector<uint8_t> reference(width, 0);
+    auto color_at = [&](const std::vector<uint8_t>& row, long x) { return x < 0 ? 0 : row[x]; };
+    auto next_change = [&](const std::vector<uint8_t>& row, long from) {
+        long x = from;
+        while (x < static_cast<long>(width) && color_at(row, x) == color_at(row, x - 1))
+            x++;
+        return x;
+    };
+
+    for (size_t y = 0; y < height; y++)
+    {
+        std::vector<uint8_t> row(width, 0);
+        long a0 = -1;
+        uint8_t color = 0;
+        auto fill = [&](long from, long to, uint8_t value) {
+            for (long x = std::max(from, 0L); x < to && x < static_cast<long>(width); x++)
+                row[x] = value;
+        };
+
+        while (a0 < static_cast<long>(width))
+        {
+            // b1: next change of the reference row right of a0 to the opposite color
+            long b1 = next_change(reference, a0 + 1);
+            while (b1 < static_cast<long>(width) && reference[b1] == color)
+                b1 = next_change(reference, b1 + 1);
+            long b2 = next_change(reference, b1 + 1);
+
+            int m = mode();
+            if (m == 20)
+            {
+                fill(a0, b2, color);
+                a0 = b2;
+            }
+            else if (m == 10)
+            {
+                long start = std::max(a0, 0L);
+                long first = static_cast<long>(run(color));
+                long second = static_cast<long>(run(!color));
+                fill(start, start + first, color);
+                fill(start + first, start + first + second, !color);
+                a0 = start + first + second;
+            }
+            else if (m >= -3 && m <= 3)
+            {
+                long a1 = b1 + m;
+                fill(a0, a1, color);
+                a0 = a1;
+                color = !color;
+            }
+            else
+                throw std::runtime_error("Unexpected end of facsimile block");
+        }
+
+        rows.push_back(row);
+        reference = row;
+    }
+
+    if (mode() != 30 || mode() != 30)
+        throw std::runtime_error("Missing end of facsimile block");
+    return rows;
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+// Minimal inflater of stored and fixed Huffman blocks, enough to check streams
+// written by Deflater
+inline std::vector<uint8_t> Inflate(std::span<const uint8_t> data)
+{
+    static constexpr uint16_t length_base[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                               35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr uint8_t length_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr uint16_t distance_base[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                                 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static constexpr uint8_t distance_extra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                                 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    std::vector<uint8_t> out;
+    size_t bit = 0;
+    auto read = [&data, &bit](int count)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, bit++)
+        {
+            if (bit / 8 >= data.size())
+                throw std::runtime_error("Unexpected end of deflate stream");
+            value |= ((data[bit / 8] >> (bit % 8)) & 1) << i;
+        }
+        return value;
+    };
+    auto code = [&read](int count, uint32_t value)
+    {
+        for (int i = 0; i < count; i++)
+            value = (value << 1) | read(1);
+        return value;
+    };
+
+    bool last = false;
+    while (!last)
+    {
+        last = read(1);
+        uint32_t type = read(2);
+        if (type == 0)
+        {
+            bit = (bit + 7) / 8 * 8;
+            uint32_t length = read(16);
+            if ((length ^ read(16)) != 0xFFFF)
+                throw std::runtime_error("Corrupted stored block");
+            for (uint32_t i = 0; i < length; i++)
+                out.push_back(static_cast<uint8_t>(read(8)));
+            continue;
+        }
+        if (type != 1)
+            throw std::runtime_error("Only stored and fixed Huffman blocks are supported");
+
+        while (true)
+        {
+            uint32_t symbol = code(7, 0);
+            if (symbol <= 0x17)
+                symbol += 256;
+            else
+            {
+                symbol = code(1, symbol);
+                if (symbol >= 0x30 && symbol <= 0xBF)
+                    symbol -= 0x30;
+                else if (symbol >= 0xC0 && symbol <= 0xC7)
+                    symbol = symbol - 0xC0 + 280;
+                else
+                    symbol = code(1, symbol) - 0x190 + 144;
+            }
+
+            if (symbol < 256)
+            {
+                out.push_back(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256)
+                break;
+
+            uint32_t length = length_base[symbol - 257] + read(length_extra[symbol - 257]);
+            uint32_t index = code(5, 0);
+            uint32_t distance = distance_base[index] + read(distance_extra[index]);
+            if (distance > out.size())
+                throw std::runtime_error("Distance is too far back");
+            for (uint32_t i = 0; i < length; i++)
+                out.push_back(out[out.size() - distance]);
+        }
+    }
+    return out;
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
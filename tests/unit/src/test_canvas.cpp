@@ -0,0 +1,202 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "encoder.hpp"
+#include "fixed_canvas.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestCanvas : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCanvas);
+
+    CPPUNIT_TEST(TestFixedCanvasLayout);
+    CPPUNIT_TEST(TestFixedCanvasFill);
+    CPPUNIT_TEST(TestExportPacked);
+    CPPUNIT_TEST(TestBlitScaled);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestFixedCanvasLayout();
+    void TestFixedCanvasFill();
+    void TestExportPacked();
+    void TestBlitScaled();
+
+private:
+    static Canvas CreateDynamicCanvas(size_t version);
+    static void AssertSameCells(const Canvas& expected, const Canvas& actual);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCanvas);
+
+// =============================================================================
+
+Canvas TestCanvas::CreateDynamicCanvas(size_t version)
+{
+    Canvas canvas(version);
+    canvas.SetupSearchPatterns();
+    canvas.SetupLevelingPatterns();
+    canvas.SetupSyncLines();
+    canvas.SetupVersionCode();
+    return canvas;
+}
+
+// =============================================================================
+
+void TestCanvas::AssertSameCells(const Canvas& expected, const Canvas& actual)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.Version(), actual.Version());
+    CPPUNIT_ASSERT_EQUAL(expected.Size(), actual.Size());
+    for (size_t row = 0; row < expected.Size(); row++)
+    {
+        for (size_t col = 0; col < expected.Size(); col++)
+        {
+            CPPUNIT_ASSERT(expected.At(row, col).kind == actual.At(row, col).kind);
+            if (expected.At(row, col).kind != Pattern::UNKNOWN)
+                CPPUNIT_ASSERT_EQUAL(expected.At(row, col).value, actual.At(row, col).value);
+        }
+    }
+}
+
+// =============================================================================
+
+void TestCanvas::TestFixedCanvasLayout()
+{
+    for (size_t version = MIN_VERSION; version <= MAX_VERSION; version++)
+        AssertSameCells(CreateDynamicCanvas(version), CreateFixedCanvas(version));
+
+    CPPUNIT_ASSERT_THROW(CreateFixedCanvas(0), Error);
+    CPPUNIT_ASSERT_THROW(CreateFixedCanvas(MAX_VERSION + 1), Error);
+}
+
+// =============================================================================
+
+void TestCanvas::TestFixedCanvasFill()
+{
+    for (size_t version: {1, 2, 7, 10, 23, 40})
+    {
+        ArrayType data(SymbolSize(version) * SymbolSize(version) / 8);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<uint8_t>(i * 37 + version);
+        const DataStream stream(data);
+
+        for (size_t mask_id = MIN_MASK_ID; mask_id <= MAX_MASK_ID; mask_id++)
+        {
+            Canvas expected = CreateDynamicCanvas(version);
+            expected.FillData(CorrectionLevel::Q, mask_id, stream);
+
+            Canvas actual = EncodeFixedCanvas(version, CorrectionLevel::Q, mask_id, stream, EncodeOptions());
+            AssertSameCells(expected, actual);
+            CPPUNIT_ASSERT_EQUAL(expected.Penalty(mask_id), actual.Penalty(mask_id));
+        }
+    }
+}
+
+// =============================================================================
+
+void TestCanvas::TestExportPacked()
+{
+    const Canvas canvas = Encoder::Encode("https://example.com/packed", CorrectionLevel::M);
+    const size_t size = canvas.Size();
+    const size_t stride = (size + 7) / 8 + 3;
+
+    for (bool msb_first: {true, false})
+    {
+        std::vector<std::byte> packed(size * stride, std::byte(0xA5));
+        canvas.ExportPacked(packed, stride, msb_first);
+
+        for (size_t row = 0; row < size; row++)
+        {
+            for (size_t col = 0; col < size; col++)
+            {
+                const uint8_t byte = std::to_integer<uint8_t>(packed[row * stride + col / 8]);
+                const size_t bit = msb_first ? 7 - col % 8 : col % 8;
+                CPPUNIT_ASSERT_EQUAL(canvas.At(row, col).value, static_cast<uint8_t>((byte >> bit) & 1));
+            }
+            // padding of the last byte is zero, bytes past the row are kept
+            const uint8_t last = std::to_integer<uint8_t>(packed[row * stride + size / 8]);
+            CPPUNIT_ASSERT_EQUAL(0, msb_first ? last & (0xFF >> (size % 8)) : last >> (size % 8));
+            CPPUNIT_ASSERT(packed[row * stride + stride - 1] == std::byte(0xA5));
+        }
+    }
+
+    std::vector<std::byte> small(size * stride - 4);
+    CPPUNIT_ASSERT_THROW(canvas.ExportPacked(small, stride), Error);
+    CPPUNIT_ASSERT_THROW(canvas.ExportPacked(small, size / 8), Error);
+}
+
+// =============================================================================
+
+void TestCanvas::TestBlitScaled()
+{
+    const Canvas canvas = Encoder::Encode("BLIT", CorrectionLevel::Q);
+    const size_t scale = 3;
+    const size_t indent = 2;
+    const size_t side = (canvas.Size() + 2 * indent) * scale;
+
+    // expected pixel of the symbol with its quiet zone, true for dark
+    auto dark = [&](size_t px, size_t py) {
+        const size_t row = py / scale;
+        const size_t col = px / scale;
+        if (row < indent || col < indent || row >= indent + canvas.Size() || col >= indent + canvas.Size())
+            return false;
+        return canvas.At(row - indent, col - indent).value != 0;
+    };
+
+    // 1 bpp at unaligned offsets, everything around the symbol is kept
+    for (size_t x: {0, 5, 13})
+    {
+        const size_t stride = (x + side) / 8 + 2;
+        const size_t height = side + 7;
+        const size_t y = 4;
+        std::vector<std::byte> frame(stride * height, std::byte(0x5A));
+        canvas.BlitScaled(frame, stride, x, y, scale, indent);
+
+        for (size_t py = 0; py < height; py++)
+        {
+            for (size_t px = 0; px < stride * 8; px++)
+            {
+                const bool bit = (std::to_integer<uint8_t>(frame[py * stride + px / 8]) >> (7 - px % 8)) & 1;
+                const bool inside = px >= x && px < x + side && py >= y && py < y + side;
+                const bool expected = inside ? dark(px - x, py - y) : (0x5A >> (7 - px % 8)) & 1;
+                CPPUNIT_ASSERT_EQUAL(expected, bit);
+            }
+        }
+    }
+
+    // 8 bpp
+    const size_t stride = side + 10;
+    std::vector<std::byte> gray(stride * (side + 1), std::byte(0x80));
+    canvas.BlitScaled(gray, stride, 7, 1, scale, indent, PixelFormat::GRAY8);
+    for (size_t py = 0; py < side + 1; py++)
+    {
+        for (size_t px = 0; px < stride; px++)
+        {
+            std::byte expected{0x80};
+            if (px >= 7 && px < 7 + side && py >= 1)
+                expected = dark(px - 7, py - 1) ? std::byte(0x00) : std::byte(0xFF);
+            CPPUNIT_ASSERT(expected == gray[py * stride + px]);
+        }
+    }
+
+    CPPUNIT_ASSERT_THROW(canvas.BlitScaled(gray, stride, 11, 1, scale, indent, PixelFormat::GRAY8), Error);
+    CPPUNIT_ASSERT_THROW(canvas.BlitScaled(gray, stride, 0, 2, scale, indent, PixelFormat::GRAY8), Error);
+    CPPUNIT_ASSERT_THROW(canvas.BlitScaled(gray, stride, 0, 0, 0, indent), Error);
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
@@ -0,0 +1,126 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ccitt.hpp"
+#include "g4_decode.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestCcitt : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCcitt);
+
+    CPPUNIT_TEST(TestRoundTrip);
+    CPPUNIT_TEST(TestLongRuns);
+    CPPUNIT_TEST(TestCompression);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestRoundTrip();
+    void TestLongRuns();
+    void TestCompression();
+
+private:
+    // Encodes rows given one byte per pixel and checks that they decode back
+    static std::vector<uint8_t> RoundTrip(const std::vector<std::vector<uint8_t>>& rows, size_t width);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCcitt);
+
+// =============================================================================
+
+std::vector<uint8_t> TestCcitt::RoundTrip(const std::vector<std::vector<uint8_t>>& rows, size_t width)
+{
+    G4Encoder encoder(width);
+    for (const auto& row: rows)
+    {
+        std::vector<uint8_t> packed((width + 7) / 8);
+        for (size_t x = 0; x < width; x++)
+            packed[x / 8] |= row[x] << (7 - x % 8);
+        encoder.Row(packed);
+    }
+    encoder.Finish();
+
+    CPPUNIT_ASSERT(DecodeG4(encoder.Output(), width, rows.size()) == rows);
+    return encoder.Output();
+}
+
+// =============================================================================
+
+void TestCcitt::TestRoundTrip()
+{
+    // pseudo-random rows, every row close to the previous one, so all modes are used
+    for (size_t width: {1, 7, 8, 13, 64, 333})
+    {
+        uint32_t state = 12345;
+        auto random = [&state]() {
+            state = state * 1103515245 + 12345;
+            return state >> 16;
+        };
+
+        std::vector<std::vector<uint8_t>> rows;
+        std::vector<uint8_t> row(width);
+        for (size_t y = 0; y < 60; y++)
+        {
+            size_t flips = random() % 6;
+            for (size_t i = 0; i < flips; i++)
+            {
+                size_t x = random() % width;
+                size_t length = 1 + random() % 9;
+                for (size_t k = x; k < x + length && k < width; k++)
+                    row[k] ^= 1;
+            }
+            if (y % 17 == 0)
+                std::fill(row.begin(), row.end(), y % 2);
+            rows.push_back(row);
+        }
+        RoundTrip(rows, width);
+    }
+
+    RoundTrip({}, 10);
+}
+
+// =============================================================================
+
+void TestCcitt::TestLongRuns()
+{
+    // runs beyond the largest make-up code of both colors
+    const size_t width = 9000;
+    std::vector<std::vector<uint8_t>> rows(4, std::vector<uint8_t>(width, 0));
+    std::fill(rows[1].begin() + 3, rows[1].begin() + 6000, 1);
+    std::fill(rows[2].begin() + 2700, rows[2].end(), 1);
+    std::fill(rows[3].begin(), rows[3].begin() + 2600, 1);
+    RoundTrip(rows, width);
+}
+
+// =============================================================================
+
+void TestCcitt::TestCompression()
+{
+    // equal rows cost one bit (V0) per changing element
+    const size_t width = 400;
+    std::vector<uint8_t> row(width);
+    for (size_t x = 0; x < width; x++)
+        row[x] = (x / 10) % 2;
+
+    std::vector<std::vector<uint8_t>> rows(100, row);
+    std::vector<uint8_t> coded = RoundTrip(rows, width);
+    CPPUNIT_ASSERT(coded.size() < 40 + 99 * 41 / 8 + 4);
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
@@ -0,0 +1,157 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <array>
+#include <string>
+
+#include "core.hpp"
+#include "encode_const.hpp"
+#include "encoder.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestCore : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCore);
+
+    CPPUNIT_TEST(TestCoreEncode);
+    CPPUNIT_TEST(TestCoreErrors);
+    CPPUNIT_TEST(TestEncodeConst);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestCoreEncode();
+    void TestCoreErrors();
+    void TestEncodeConst();
+
+private:
+    template <size_t V>
+    static void AssertSameSymbol(const ConstSymbol<V>& symbol, const Canvas& expected);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCore);
+
+// =============================================================================
+
+template <size_t V>
+void TestCore::AssertSameSymbol(const ConstSymbol<V>& symbol, const Canvas& expected)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.Version(), V);
+    for (size_t row = 0; row < expected.Size(); row++)
+        for (size_t col = 0; col < expected.Size(); col++)
+            CPPUNIT_ASSERT_EQUAL(expected.At(row, col).value, symbol.At(row, col));
+}
+
+// =============================================================================
+
+void TestCore::TestCoreEncode()
+{
+    static std::array<uint8_t, core::MAX_CODEWORDS> codewords;
+    static std::array<uint8_t, core::MAX_SIZE * core::MAX_SIZE> modules;
+
+    struct Params
+    {
+        EncodingType encoding;
+        std::string msg;
+    };
+
+    const std::string text = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 $%*+-./:";
+    std::vector<Params> params;
+    for (size_t length: {1, 2, 3, 17, 50, 200, 900})
+    {
+        std::string digits, alnum;
+        for (size_t i = 0; i < length; i++)
+        {
+            digits += static_cast<char>('0' + (i * 7) % 10);
+            alnum += text[(i * 11) % text.size()];
+        }
+        params.push_back({EncodingType::NUNERIC, digits});
+        params.push_back({EncodingType::ALPHANUMERIC, alnum});
+        params.push_back({EncodingType::BYTES, alnum + "\xd0\xaf"});
+    }
+
+    for (const auto& p: params)
+    {
+        for (CorrectionLevel cl: {CorrectionLevel::L, CorrectionLevel::M, CorrectionLevel::Q, CorrectionLevel::H})
+        {
+            for (int mask_id: {-1, 6})
+            {
+                size_t version = 0;
+                size_t chosen_mask = 0;
+                CPPUNIT_ASSERT(core::EncodeCodewords(p.msg.data(), p.msg.size(), p.encoding, cl,
+                                                     codewords.data(), codewords.size(), version) == core::Status::OK);
+                CPPUNIT_ASSERT(core::RenderModules(codewords.data(), version, cl, mask_id,
+                                                   modules.data(), modules.size(), chosen_mask) == core::Status::OK);
+
+                Canvas expected = Encoder::Encode(p.msg, cl, p.encoding, mask_id);
+                CPPUNIT_ASSERT_EQUAL(expected.Version(), version);
+                for (size_t row = 0; row < expected.Size(); row++)
+                    for (size_t col = 0; col < expected.Size(); col++)
+                        CPPUNIT_ASSERT_EQUAL(expected.At(row, col).value,
+                                             static_cast<uint8_t>(modules[row * expected.Size() + col] & core::MODULE_DARK));
+            }
+        }
+    }
+}
+
+// =============================================================================
+
+void TestCore::TestCoreErrors()
+{
+    std::array<uint8_t, core::MAX_CODEWORDS> codewords;
+    std::array<uint8_t, 21 * 21> modules;
+    size_t version = 0;
+    size_t mask_id = 0;
+
+    CPPUNIT_ASSERT(core::EncodeCodewords("12a", 3, EncodingType::NUNERIC, CorrectionLevel::M,
+                                         codewords.data(), codewords.size(), version) == core::Status::UNSUPPORTED_DATA);
+    CPPUNIT_ASSERT(core::EncodeCodewords("abc", 3, EncodingType::ALPHANUMERIC, CorrectionLevel::M,
+                                         codewords.data(), codewords.size(), version) == core::Status::UNSUPPORTED_DATA);
+
+    std::string big(3000, 'x');
+    CPPUNIT_ASSERT(core::EncodeCodewords(big.data(), big.size(), EncodingType::BYTES, CorrectionLevel::M,
+                                         codewords.data(), codewords.size(), version) == core::Status::DATA_TOO_BIG);
+
+    std::string msg(100, 'x');
+    CPPUNIT_ASSERT(core::EncodeCodewords(msg.data(), msg.size(), EncodingType::BYTES, CorrectionLevel::M,
+                                         codewords.data(), 50, version) == core::Status::BUFFER_TOO_SMALL);
+    CPPUNIT_ASSERT(core::EncodeCodewords(msg.data(), msg.size(), EncodingType::BYTES, CorrectionLevel::M,
+                                         codewords.data(), codewords.size(), version) == core::Status::OK);
+    CPPUNIT_ASSERT(core::RenderModules(codewords.data(), version, CorrectionLevel::M, -1,
+                                       modules.data(), modules.size(), mask_id) == core::Status::BUFFER_TOO_SMALL);
+    CPPUNIT_ASSERT(core::RenderModules(codewords.data(), version, CorrectionLevel::M, 8,
+                                       modules.data(), modules.size(), mask_id) == core::Status::INVALID_ARGUMENT);
+}
+
+// =============================================================================
+
+void TestCore::TestEncodeConst()
+{
+    constexpr auto url = EncodeConst<"https://example.com/service?model=XR-200", CorrectionLevel::M>();
+    static_assert(url.VERSION == 3 && url.At(0, 0) == BLACK && url.At(7, 7) == WHITE);
+    AssertSameSymbol(url, Encoder::Encode("https://example.com/service?model=XR-200", CorrectionLevel::M,
+                                          EncodingType::BYTES, -1));
+
+    constexpr auto model = EncodeConst<"XR-200 REV 4", CorrectionLevel::H, EncodingType::ALPHANUMERIC, 3>();
+    static_assert(model.mask_id == 3);
+    AssertSameSymbol(model, Encoder::Encode("XR-200 REV 4", CorrectionLevel::H, EncodingType::ALPHANUMERIC, 3));
+
+    constexpr auto serial = EncodeConst<"31415926535897932384626433832795028841971693993751058209749445923078164062862",
+                                        CorrectionLevel::Q, EncodingType::NUNERIC>();
+    AssertSameSymbol(serial, Encoder::Encode("31415926535897932384626433832795028841971693993751058209749445923078164062862",
+                                             CorrectionLevel::Q, EncodingType::NUNERIC, -1));
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
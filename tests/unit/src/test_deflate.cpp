@@ -0,0 +1,125 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include "deflate.hpp"
+#include "error.hpp"
+#include "inflate.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestDeflate : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestDeflate);
+
+    CPPUNIT_TEST(TestChecksums);
+    CPPUNIT_TEST(TestRoundTrip);
+    CPPUNIT_TEST(TestFormats);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestChecksums();
+    void TestRoundTrip();
+    void TestFormats();
+
+private:
+    static std::span<const uint8_t> Bytes(const std::string& s)
+    {
+        return std::span(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    }
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDeflate);
+
+// =============================================================================
+
+void TestDeflate::TestChecksums()
+{
+    CPPUNIT_ASSERT_EQUAL(0xCBF43926u, Crc32(Bytes("123456789")));
+    CPPUNIT_ASSERT_EQUAL(0x11E60398u, Adler32(Bytes("Wikipedia")));
+    CPPUNIT_ASSERT_EQUAL(0u, Crc32({}));
+    CPPUNIT_ASSERT_EQUAL(1u, Adler32({}));
+
+    // incremental computation gives the same result
+    std::string text(20000, 'q');
+    for (size_t i = 0; i < text.size(); i++)
+        text[i] = static_cast<char>(i * 31 % 251);
+    auto bytes = Bytes(text);
+    CPPUNIT_ASSERT_EQUAL(Crc32(bytes), Crc32(bytes.subspan(7000), Crc32(bytes.first(7000))));
+    CPPUNIT_ASSERT_EQUAL(Adler32(bytes), Adler32(bytes.subspan(7000), Adler32(bytes.first(7000))));
+}
+
+// =============================================================================
+
+void TestDeflate::TestRoundTrip()
+{
+    std::vector<std::vector<uint8_t>> inputs = {{}, {42}, std::vector<uint8_t>(100000, 0)};
+
+    std::vector<uint8_t> pattern;
+    for (size_t i = 0; i < 150000; i++)
+        pattern.push_back(static_cast<uint8_t>((i / 37) % 3 ? 0xFF : i * 13));
+    inputs.push_back(pattern);
+
+    for (const auto& input: inputs)
+    {
+        for (int level: {0, 1, 6, 9})
+        {
+            // written in pieces to cross the window boundaries
+            Deflater deflater(DeflateFormat::RAW, level);
+            for (size_t i = 0; i < input.size(); i += 4999)
+                deflater.Write(std::span(input).subspan(i, std::min<size_t>(4999, input.size() - i)));
+            deflater.Finish();
+            CPPUNIT_ASSERT(Inflate(deflater.Output()) == input);
+        }
+    }
+
+    // long runs compress to a few matches
+    CPPUNIT_ASSERT(Deflater::Compress(inputs[2], DeflateFormat::RAW).size() < 1000);
+    CPPUNIT_ASSERT_THROW(Deflater(DeflateFormat::RAW, 10), Error);
+}
+
+// =============================================================================
+
+void TestDeflate::TestFormats()
+{
+    const std::string text = "QR codes are made of long runs of modules. QR codes are made of long runs.";
+
+    std::vector<uint8_t> zlib = Deflater::Compress(Bytes(text), DeflateFormat::ZLIB);
+    CPPUNIT_ASSERT_EQUAL(0, (zlib[0] * 256 + zlib[1]) % 31);
+    uint32_t adler = 0;
+    for (size_t i = zlib.size() - 4; i < zlib.size(); i++)
+        adler = (adler << 8) | zlib[i];
+    CPPUNIT_ASSERT_EQUAL(Adler32(Bytes(text)), adler);
+    std::vector<uint8_t> raw(zlib.begin() + 2, zlib.end() - 4);
+    CPPUNIT_ASSERT(Inflate(raw) == std::vector<uint8_t>(text.begin(), text.end()));
+
+    std::vector<uint8_t> gzip = Deflater::Compress(Bytes(text), DeflateFormat::GZIP, 0);
+    CPPUNIT_ASSERT_EQUAL(0x1F, static_cast<int>(gzip[0]));
+    CPPUNIT_ASSERT_EQUAL(0x8B, static_cast<int>(gzip[1]));
+    uint32_t crc = 0, size = 0;
+    for (int i = 3; i >= 0; i--)
+    {
+        crc = (crc << 8) | gzip[gzip.size() - 8 + i];
+        size = (size << 8) | gzip[gzip.size() - 4 + i];
+    }
+    CPPUNIT_ASSERT_EQUAL(Crc32(Bytes(text)), crc);
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(text.size()), size);
+    raw.assign(gzip.begin() + 10, gzip.end() - 8);
+    CPPUNIT_ASSERT(Inflate(raw) == std::vector<uint8_t>(text.begin(), text.end()));
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
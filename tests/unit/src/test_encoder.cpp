@@ -1,6 +1,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "encode_provider.hpp"
+#include "reed_solomon.hpp"
 
 
 // =============================================================================
@@ -20,6 +21,8 @@ class TestEncoder : public CppUnit::TestFixture
     CPPUNIT_TEST(TestAddTailZeros);
     CPPUNIT_TEST(TestAddRequiredVersionTailBytes);
     CPPUNIT_TEST(TestGenCorrBlock);
+    CPPUNIT_TEST(TestParallelCorrectionBlocks);
+    CPPUNIT_TEST(TestGenCorrBlocksLanes);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -30,6 +33,8 @@ protected:
     void TestAddTailZeros();
     void TestAddRequiredVersionTailBytes();
     void TestGenCorrBlock();
+    void TestParallelCorrectionBlocks();
+    void TestGenCorrBlocksLanes();
 };
 
 // =============================================================================
@@ -120,6 +125,54 @@ void TestEncoder::TestGenCorrBlock()
     myqro::ArrayType x = myqro::GenerateCorrectionBlock(block, n_corr_bytes);
 }
 
+void TestEncoder::TestParallelCorrectionBlocks()
+{
+    EncodeOptions serial, parallel;
+    serial.parallel_blocks_min_cost = 0;
+    parallel.parallel_blocks_min_cost = 1;
+
+    auto p = myqro::EncodeProviderFactory::GetProvider(myqro::EncodingType::BYTES);
+    for (size_t length: {20, 700, 1200})
+    {
+        std::string data(length, 'q');
+        for (size_t i = 0; i < length; i++)
+            data[i] = static_cast<char>(i * 31 + 5);
+
+        Context c1 = p->Encode(data, CorrectionLevel::H, serial);
+        Context c2 = p->Encode(data, CorrectionLevel::H, parallel);
+        CPPUNIT_ASSERT(c1.output == c2.output);
+    }
+}
+
+void TestEncoder::TestGenCorrBlocksLanes()
+{
+    for (const auto& [n_corr_bytes, poly]: GeneratingPolynomial)
+    {
+        for (size_t block_size: {1, 9, 47, 120})
+        {
+            for (size_t lanes: {1, 5, 64, 100})
+            {
+                myqro::ArrayType data(block_size * lanes);
+                for (size_t i = 0; i < data.size(); i++)
+                    data[i] = static_cast<uint8_t>((i * 167 + n_corr_bytes * 13 + lanes) % 256);
+
+                std::vector<myqro::Block> blocks;
+                for (size_t l = 0; l < lanes; l++)
+                    blocks.push_back({data.begin() + l * block_size, data.begin() + (l + 1) * block_size});
+
+                std::vector<myqro::ArrayType> result = myqro::GenerateCorrectionBlocks(blocks, n_corr_bytes);
+                CPPUNIT_ASSERT_EQUAL(lanes, result.size());
+                for (size_t l = 0; l < lanes; l++)
+                {
+                    myqro::ArrayType expected = myqro::GenerateCorrectionBlock(blocks[l], n_corr_bytes);
+                    expected.resize(n_corr_bytes);
+                    CPPUNIT_ASSERT(expected == result[l]);
+                }
+            }
+        }
+    }
+}
+
 } // namespace myqro::test
 
 // =============================================================================
@@ -0,0 +1,150 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "encode_const.hpp"
+#include "freestanding.hpp"
+
+
+// =============================================================================
+
+// Counts allocations, so the tests can check that encoding doesn't allocate
+namespace
+{
+
+size_t allocations = 0;
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestFreestanding : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestFreestanding);
+
+    CPPUNIT_TEST(TestEncodeInto);
+    CPPUNIT_TEST(TestEncodeIntoErrors);
+    CPPUNIT_TEST(TestPackRows);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestEncodeInto();
+    void TestEncodeIntoErrors();
+    void TestPackRows();
+
+private:
+    template <size_t V>
+    static void AssertSameSymbol(const ConstSymbol<V>& expected, const SymbolRef& symbol);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestFreestanding);
+
+// =============================================================================
+
+template <size_t V>
+void TestFreestanding::AssertSameSymbol(const ConstSymbol<V>& expected, const SymbolRef& symbol)
+{
+    CPPUNIT_ASSERT_EQUAL(V, symbol.version);
+    CPPUNIT_ASSERT_EQUAL(expected.mask_id, symbol.mask_id);
+    for (size_t row = 0; row < expected.SIZE; row++)
+        for (size_t col = 0; col < expected.SIZE; col++)
+            CPPUNIT_ASSERT_EQUAL(expected.At(row, col), symbol.At(row, col));
+}
+
+// =============================================================================
+
+void TestFreestanding::TestEncodeInto()
+{
+    static SymbolBuffers<10> buffers;
+    SymbolRef symbol;
+
+    static constexpr char url[] = "https://example.com/device/XR-200";
+    constexpr auto expected_url = EncodeConst<url, CorrectionLevel::Q>();
+
+    size_t before = allocations;
+    core::Status status = EncodeInto(url, sizeof(url) - 1, CorrectionLevel::Q, EncodingType::BYTES, -1, buffers, symbol);
+    CPPUNIT_ASSERT_EQUAL(before, allocations);
+    CPPUNIT_ASSERT(status == core::Status::OK);
+    AssertSameSymbol(expected_url, symbol);
+
+    constexpr auto expected_num = EncodeConst<"0123456789012345", CorrectionLevel::L, EncodingType::NUNERIC, 5>();
+    status = EncodeInto("0123456789012345", 16, CorrectionLevel::L, EncodingType::NUNERIC, 5, buffers, symbol);
+    CPPUNIT_ASSERT(status == core::Status::OK);
+    AssertSameSymbol(expected_num, symbol);
+}
+
+// =============================================================================
+
+void TestFreestanding::TestEncodeIntoErrors()
+{
+    static SymbolBuffers<2> buffers;
+    SymbolRef symbol;
+
+    std::string msg(100, 'x');
+    CPPUNIT_ASSERT(EncodeInto(msg.data(), msg.size(), CorrectionLevel::M, EncodingType::BYTES, -1, buffers, symbol) ==
+                   core::Status::BUFFER_TOO_SMALL);
+    CPPUNIT_ASSERT(EncodeInto("abc", 3, CorrectionLevel::M, EncodingType::ALPHANUMERIC, -1, buffers, symbol) ==
+                   core::Status::UNSUPPORTED_DATA);
+    CPPUNIT_ASSERT(EncodeInto("ABC", 3, CorrectionLevel::M, EncodingType::ALPHANUMERIC, 8, buffers, symbol) ==
+                   core::Status::INVALID_ARGUMENT);
+    CPPUNIT_ASSERT(EncodeInto("ABC", 3, CorrectionLevel::M, EncodingType::ALPHANUMERIC, 0, buffers, symbol) ==
+                   core::Status::OK);
+}
+
+// =============================================================================
+
+void TestFreestanding::TestPackRows()
+{
+    static SymbolBuffers<1> buffers;
+    SymbolRef symbol;
+    CPPUNIT_ASSERT(EncodeInto("HELLO", 5, CorrectionLevel::M, EncodingType::ALPHANUMERIC, 2, buffers, symbol) ==
+                   core::Status::OK);
+
+    std::array<uint8_t, 4 * 21> packed;
+    CPPUNIT_ASSERT(PackRows(symbol, packed, 2) == core::Status::BUFFER_TOO_SMALL);
+    CPPUNIT_ASSERT(PackRows(symbol, std::span<uint8_t>(packed).first(20), 4) == core::Status::BUFFER_TOO_SMALL);
+    CPPUNIT_ASSERT(PackRows(symbol, packed, 4) == core::Status::OK);
+
+    for (size_t row = 0; row < symbol.size; row++)
+    {
+        for (size_t col = 0; col < 4 * BITS_PER_BYTE; col++)
+        {
+            uint8_t bit = (packed[row * 4 + col / 8] >> (7 - col % 8)) & 1;
+            CPPUNIT_ASSERT_EQUAL(col < symbol.size ? symbol.At(row, col) : uint8_t(0), bit);
+        }
+    }
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
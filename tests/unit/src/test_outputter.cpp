@@ -0,0 +1,836 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "deflate.hpp"
+#include "encoder.hpp"
+#include "error.hpp"
+#include "g4_decode.hpp"
+#include "inflate.hpp"
+#include "outputter.hpp"
+#include "raster.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestOutputter : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestOutputter);
+
+    CPPUNIT_TEST(TestPbm);
+    CPPUNIT_TEST(TestPng);
+    CPPUNIT_TEST(TestSvg);
+    CPPUNIT_TEST(TestEps);
+    CPPUNIT_TEST(TestSinks);
+    CPPUNIT_TEST(TestConsole);
+    CPPUNIT_TEST(TestTiff);
+    CPPUNIT_TEST(TestPdf);
+    CPPUNIT_TEST(TestPrinters);
+    CPPUNIT_TEST(TestMapped);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestPbm();
+    void TestPng();
+    void TestSvg();
+    void TestEps();
+    void TestSinks();
+    void TestConsole();
+    void TestTiff();
+    void TestPdf();
+    void TestPrinters();
+    void TestMapped();
+
+private:
+    static std::string ReadFile(const std::filesystem::path& path);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestOutputter);
+
+// =============================================================================
+
+std::string TestOutputter::ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+// =============================================================================
+
+void TestOutputter::TestPbm()
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::filesystem::path ascii_path = dir / "myqro-test-ascii.pbm";
+    const std::filesystem::path binary_path = dir / "myqro-test-binary.pbm";
+
+    Canvas canvas = Encoder::Encode("PBM output", CorrectionLevel::M, EncodingType::BYTES, 2);
+    for (OutputOptions options: {OutputOptions(1, 0), OutputOptions(3, 4), OutputOptions(8, 1)})
+    {
+        PBMOutputter(ascii_path, PbmFormat::ASCII).Output(canvas, options);
+        PBMOutputter(binary_path).Output(canvas, options);
+
+        size_t size = (canvas.Size() + 2 * options.indent) * options.scale;
+        size_t stride = (size + 7) / 8;
+
+        std::istringstream ascii(ReadFile(ascii_path));
+        std::string magic;
+        size_t width = 0, height = 0;
+        ascii >> magic >> width >> height;
+        CPPUNIT_ASSERT_EQUAL(std::string("P1"), magic);
+        CPPUNIT_ASSERT_EQUAL(size, width);
+        CPPUNIT_ASSERT_EQUAL(size, height);
+
+        std::string binary = ReadFile(binary_path);
+        std::string header = "P4\n" + std::to_string(size) + " " + std::to_string(size) + "\n";
+        CPPUNIT_ASSERT_EQUAL(header, binary.substr(0, header.size()));
+        CPPUNIT_ASSERT_EQUAL(header.size() + stride * size, binary.size());
+
+        for (size_t y = 0; y < size; y++)
+        {
+            std::string line;
+            ascii >> line;
+            CPPUNIT_ASSERT_EQUAL(size, line.size());
+            for (size_t x = 0; x < size; x++)
+            {
+                uint8_t byte = binary[header.size() + y * stride + x / 8];
+                CPPUNIT_ASSERT_EQUAL(line[x] == '1', ((byte >> (7 - x % 8)) & 1) == 1);
+
+                int r = static_cast<int>(y / options.scale) - options.indent;
+                int c = static_cast<int>(x / options.scale) - options.indent;
+                bool dark = canvas.IsInside(r, c) && canvas.At(r, c).value == BLACK;
+                CPPUNIT_ASSERT_EQUAL(dark, line[x] == '1');
+            }
+        }
+    }
+
+    std::filesystem::remove(ascii_path);
+    std::filesystem::remove(binary_path);
+}
+
+// =============================================================================
+
+void TestOutputter::TestPng()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "myqro-test.png";
+    auto be32 = [](const std::string& s, size_t pos)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; i++)
+            value = (value << 8) | static_cast<uint8_t>(s[pos + i]);
+        return value;
+    };
+
+    SymbolView symbol = SymbolView::Encode("https://example.com/png", CorrectionLevel::Q, EncodingType::BYTES, -1);
+    for (OutputOptions options: {OutputOptions(1, 4), OutputOptions(5, 2)})
+    {
+        PngOutputter(path).Output(symbol, options);
+        std::string png = ReadFile(path);
+        CPPUNIT_ASSERT_EQUAL(std::string("\x89PNG\r\n\x1a\n"), png.substr(0, 8));
+
+        std::vector<std::string> types;
+        std::vector<uint8_t> idat;
+        uint32_t width = 0, height = 0;
+        for (size_t pos = 8; pos < png.size();)
+        {
+            uint32_t length = be32(png, pos);
+            std::string type = png.substr(pos + 4, 4);
+            auto chunk = std::span(reinterpret_cast<const uint8_t*>(png.data()) + pos + 4, length + 4);
+            CPPUNIT_ASSERT_EQUAL(Crc32(chunk), be32(png, pos + 8 + length));
+
+            if (type == "IHDR")
+            {
+                width = be32(png, pos + 8);
+                height = be32(png, pos + 12);
+                CPPUNIT_ASSERT_EQUAL(std::string("\x01\x00\x00\x00\x00", 5), png.substr(pos + 16, 5));
+            }
+            else if (type == "IDAT")
+                idat.insert(idat.end(), chunk.begin() + 4, chunk.end());
+
+            types.push_back(type);
+            pos += 12 + length;
+        }
+        CPPUNIT_ASSERT_EQUAL(std::string("IHDR"), types.front());
+        CPPUNIT_ASSERT_EQUAL(std::string("IEND"), types.back());
+
+        size_t size = (symbol.Size() + 2 * options.indent) * options.scale;
+        size_t stride = (size + 7) / 8;
+        CPPUNIT_ASSERT_EQUAL(size, static_cast<size_t>(width));
+        CPPUNIT_ASSERT_EQUAL(size, static_cast<size_t>(height));
+
+        std::vector<uint8_t> pixels = Inflate(std::span(idat).subspan(2, idat.size() - 6));
+        CPPUNIT_ASSERT_EQUAL(size * (stride + 1), pixels.size());
+        for (size_t y = 0; y < size; y++)
+        {
+            CPPUNIT_ASSERT_EQUAL(0, static_cast<int>(pixels[y * (stride + 1)]));
+            for (size_t x = 0; x < size; x++)
+            {
+                uint8_t byte = pixels[y * (stride + 1) + 1 + x / 8];
+                int r = static_cast<int>(y / options.scale) - options.indent;
+                int c = static_cast<int>(x / options.scale) - options.indent;
+                bool dark = symbol.IsInside(r, c) && symbol.Module(r, c) == BLACK;
+                CPPUNIT_ASSERT_EQUAL(dark, ((byte >> (7 - x % 8)) & 1) == 0);
+            }
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+// =============================================================================
+
+void TestOutputter::TestSvg()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "myqro-test.svg";
+    Canvas canvas = Encoder::Encode("https://example.com/svg?q=1", CorrectionLevel::H, EncodingType::BYTES, -1);
+    const OutputOptions options(3, 2);
+    const int size = static_cast<int>(canvas.Size()) + 2 * options.indent;
+
+    size_t runs_size = 0;
+    for (SvgShapes shapes: {SvgShapes::RUNS, SvgShapes::RECTANGLES})
+    {
+        SvgOutputter(path, shapes).Output(canvas, options);
+        std::string svg = ReadFile(path);
+        CPPUNIT_ASSERT(svg.find("viewBox=\"0 0 " + std::to_string(size) + " " + std::to_string(size) + "\"") != std::string::npos);
+        CPPUNIT_ASSERT(svg.find("width=\"" + std::to_string(size * options.scale) + "\"") != std::string::npos);
+
+        // every subpath is `m dx,dy h w v h h -w z`, relative to the previous start
+        size_t begin = svg.find("d=\"") + 3;
+        std::istringstream path_data(svg.substr(begin, svg.find('"', begin) - begin));
+        std::vector<int> dark(size * size, 0);
+        int x = 0, y = 0;
+        char cmd, comma;
+        while (path_data >> cmd)
+        {
+            int dx, dy, w, h, back;
+            char c1, c2, c3, z;
+            path_data >> dx >> comma >> dy >> c1 >> w >> c2 >> h >> c3 >> back >> z;
+            CPPUNIT_ASSERT(c1 == 'h' && c2 == 'v' && c3 == 'h' && z == 'z' && back == -w);
+            x = (cmd == 'M') ? dx : x + dx;
+            y = (cmd == 'M') ? dy : y + dy;
+            for (int r = y; r < y + h; r++)
+                for (int c = x; c < x + w; c++)
+                    dark[r * size + c]++;
+        }
+
+        for (int r = 0; r < size; r++)
+        {
+            for (int c = 0; c < size; c++)
+            {
+                int row = r - options.indent, col = c - options.indent;
+                int expected = canvas.IsInside(row, col) && canvas.At(row, col).value == BLACK;
+                CPPUNIT_ASSERT_EQUAL(expected, dark[r * size + c]);
+            }
+        }
+
+        if (shapes == SvgShapes::RUNS)
+            runs_size = svg.size();
+        else
+            CPPUNIT_ASSERT(svg.size() < runs_size);
+    }
+
+    std::filesystem::remove(path);
+
+    // SVGZ is the same document gzipped, large documents are compressed in chunks
+    Canvas large = Encoder::Encode(std::string(1500, 'Z') + "svgz", CorrectionLevel::L);
+    for (const Canvas* symbol: {&canvas, &large})
+    {
+        const std::string svg = SvgOutputter(SvgShapes::RECTANGLES).Render(CanvasRows(*symbol), options);
+        size_t stored_size = 0;
+        for (int level: {0, 9})
+        {
+            MemorySink svgz;
+            SvgzOutputter(SvgShapes::RECTANGLES, level).Output(*symbol, options, svgz);
+            const std::vector<uint8_t>& data = svgz.Data();
+            CPPUNIT_ASSERT(data[0] == 0x1F && data[1] == 0x8B);
+            std::vector<uint8_t> text = Inflate(std::span(data).subspan(10, data.size() - 18));
+            CPPUNIT_ASSERT(svg == std::string(text.begin(), text.end()));
+
+            if (level == 0)
+                stored_size = data.size();
+            else
+                CPPUNIT_ASSERT(data.size() * 3 < stored_size);
+        }
+    }
+}
+
+// =============================================================================
+
+void TestOutputter::TestEps()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "myqro-test.eps";
+    SymbolView symbol = SymbolView::Encode("EPS OUTPUT 0123", CorrectionLevel::M, EncodingType::ALPHANUMERIC, -1);
+    const OutputOptions options(2, 4);
+    const size_t n = symbol.Size();
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> bits(symbol.PackedRowSize());
+    for (size_t row = 0; row < n; row++)
+    {
+        symbol.PackedRow(row, bits);
+        expected.insert(expected.end(), bits.begin(), bits.end());
+    }
+
+    for (EpsFormat format: {EpsFormat::HEX, EpsFormat::ASCII85, EpsFormat::RECTFILL})
+    {
+        EpsOutputter(path, format).Output(symbol, options);
+        std::string eps = ReadFile(path);
+        std::string box = "%%BoundingBox: 0 0 " + std::to_string((n + 8) * 2);
+        CPPUNIT_ASSERT(eps.rfind("%!PS-Adobe-3.0 EPSF-3.0\n", 0) == 0);
+        CPPUNIT_ASSERT(eps.find(box) != std::string::npos);
+        CPPUNIT_ASSERT(eps.find("%%EOF\n") == eps.size() - 6);
+
+        std::vector<uint8_t> decoded;
+        if (format == EpsFormat::RECTFILL)
+        {
+            decoded.assign(expected.size(), 0);
+            std::istringstream body(eps.substr(eps.find("bind def\n") + 9));
+            int x, y, w;
+            std::string f;
+            while (body >> x >> y >> w >> f)
+            {
+                CPPUNIT_ASSERT_EQUAL(std::string("f"), f);
+                size_t row = n - 1 - y;
+                for (int col = x; col < x + w; col++)
+                    decoded[row * symbol.PackedRowSize() + col / 8] |= 0x80 >> (col % 8);
+            }
+        }
+        else
+        {
+            size_t begin = eps.find("imagemask\n") + 10;
+            std::string data = eps.substr(begin, eps.find('>', begin) - begin);
+            if (format == EpsFormat::HEX)
+            {
+                std::istringstream hex(data);
+                std::string line;
+                while (hex >> line)
+                    for (size_t i = 0; i < line.size(); i += 2)
+                        decoded.push_back(static_cast<uint8_t>(std::stoi(line.substr(i, 2), nullptr, 16)));
+            }
+            else
+            {
+                CPPUNIT_ASSERT_EQUAL('~', data.back());
+                uint64_t group = 0;
+                size_t count = 0;
+                for (char c: data.substr(0, data.size() - 1))
+                {
+                    if (c == '\n')
+                        continue;
+                    if (c == 'z')
+                    {
+                        decoded.insert(decoded.end(), 4, 0);
+                        continue;
+                    }
+                    group = group * 85 + (c - '!');
+                    if (++count == 5)
+                    {
+                        for (int i = 3; i >= 0; i--)
+                            decoded.push_back(static_cast<uint8_t>(group >> (8 * i)));
+                        group = 0;
+                        count = 0;
+                    }
+                }
+                if (count > 0)
+                {
+                    for (size_t i = count; i < 5; i++)
+                        group = group * 85 + 84;
+                    for (size_t i = 0; i < count - 1; i++)
+                        decoded.push_back(static_cast<uint8_t>(group >> (24 - 8 * i)));
+                }
+            }
+        }
+        CPPUNIT_ASSERT(decoded == expected);
+    }
+
+    std::filesystem::remove(path);
+}
+
+// =============================================================================
+
+void TestOutputter::TestSinks()
+{
+    SymbolView symbol = SymbolView::Encode("https://example.com/sinks", CorrectionLevel::L, EncodingType::BYTES, -1);
+    const OutputOptions options(4, 4);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "myqro-test-sink.png";
+
+    PngOutputter png;
+    CPPUNIT_ASSERT_THROW(png.Output(symbol, options), Error);
+
+    MemorySink memory;
+    png.Output(symbol, options, memory);
+    PngOutputter(path).Output(symbol, options);
+    CPPUNIT_ASSERT(ReadFile(path) == std::string(memory.Data().begin(), memory.Data().end()));
+
+    // the size query gives the exact size of a caller buffer
+    size_t size = png.OutputSize(symbol, options);
+    CPPUNIT_ASSERT_EQUAL(memory.Data().size(), size);
+    std::vector<std::byte> buffer(size);
+    SpanSink exact(buffer);
+    png.Output(symbol, options, exact);
+    CPPUNIT_ASSERT_EQUAL(size, exact.Size());
+    CPPUNIT_ASSERT(std::memcmp(buffer.data(), memory.Data().data(), size) == 0);
+
+    SpanSink small{std::span(buffer).first(size - 1)};
+    CPPUNIT_ASSERT_THROW(png.Output(symbol, options, small), Error);
+
+    // buffer smaller than single writes and larger than others
+    for (size_t buffer_size: {7, 4096})
+    {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        CPPUNIT_ASSERT(fd >= 0);
+        {
+            FdSink sink(fd, buffer_size);
+            SvgOutputter().Output(symbol, options, sink);
+        }
+        ::close(fd);
+        CPPUNIT_ASSERT_EQUAL(SvgOutputter().Render(symbol, options), ReadFile(path));
+    }
+
+    std::stringstream console;
+    ConsoleOutputter(console).Output(symbol, OutputOptions(1, 1));
+    CPPUNIT_ASSERT_EQUAL((symbol.Size() + 2) * (symbol.Size() + 3), console.str().size());
+
+    std::filesystem::remove(path);
+}
+
+// =============================================================================
+
+void TestOutputter::TestConsole()
+{
+    SymbolView symbol = SymbolView::Encode("HALF BLOCKS", CorrectionLevel::M, EncodingType::ALPHANUMERIC, -1);
+    const OutputOptions options(1, 1);
+    const size_t size = symbol.Size() + 2;
+
+    std::stringstream ascii;
+    ConsoleOutputter(ascii).Output(symbol, options);
+    std::vector<std::string> pixels;
+    for (std::string line; std::getline(ascii, line);)
+        pixels.push_back(line);
+    CPPUNIT_ASSERT_EQUAL(size, pixels.size());
+    pixels.push_back(std::string(size, ' '));
+
+    const std::string blocks[] = {" ", "\u2584", "\u2580", "\u2588"};
+    for (bool inverse: {false, true})
+    {
+        MemorySink sink;
+        ConsoleOutputter(ConsoleStyle::HALF_BLOCKS, inverse).Output(symbol, options, sink);
+        std::string text(sink.Data().begin(), sink.Data().end());
+
+        std::string expected;
+        for (size_t y = 0; y < size; y += 2)
+        {
+            if (inverse)
+                expected += "\x1b[7m";
+            for (size_t x = 0; x < size; x++)
+                expected += blocks[(pixels[y][x] == '#') * 2 + (pixels[y + 1][x] == '#')];
+            if (inverse)
+                expected += "\x1b[27m";
+            expected += '\n';
+        }
+        CPPUNIT_ASSERT(expected == text);
+    }
+}
+
+// =============================================================================
+
+void TestOutputter::TestTiff()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "myqro-test.tif";
+    auto le = [](const std::string& s, size_t pos, size_t size)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < size; i++)
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(s[pos + i])) << (8 * i);
+        return value;
+    };
+
+    std::vector<Canvas> canvases;
+    for (const char* msg: {"TIFF", "https://example.com/tiff-g4", "0123456789012345678901234567890123456789"})
+        canvases.push_back(Encoder::Encode(msg, CorrectionLevel::M));
+    OutputOptions options(8, 2);
+    TiffG4Outputter(path, 600).OutputPages(canvases, options);
+    std::string tiff = ReadFile(path);
+    CPPUNIT_ASSERT_EQUAL(std::string("II*\0", 4), tiff.substr(0, 4));
+
+    size_t page = 0;
+    for (uint32_t ifd = le(tiff, 4, 4); ifd != 0; page++)
+    {
+        CPPUNIT_ASSERT(page < canvases.size());
+        CPPUNIT_ASSERT_EQUAL(0u, ifd % 2);
+
+        std::map<uint32_t, uint32_t> tags;
+        uint32_t count = le(tiff, ifd, 2);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            size_t entry = ifd + 2 + 12 * i;
+            uint32_t tag = le(tiff, entry, 2);
+            tags[tag] = le(tiff, entry + 8, le(tiff, entry + 2, 2) == 3 ? 2 : 4);
+        }
+        ifd = le(tiff, ifd + 2 + 12 * count, 4);
+
+        const CanvasRows symbol(canvases[page]);
+        size_t size = (symbol.Size() + 2 * options.indent) * options.scale;
+        CPPUNIT_ASSERT_EQUAL(size, static_cast<size_t>(tags[256]));
+        CPPUNIT_ASSERT_EQUAL(size, static_cast<size_t>(tags[257]));
+        CPPUNIT_ASSERT_EQUAL(4u, tags[259]);
+        CPPUNIT_ASSERT_EQUAL(0u, tags[262]);
+        CPPUNIT_ASSERT_EQUAL(600u, le(tiff, tags[282], 4));
+
+        auto strip = std::span(reinterpret_cast<const uint8_t*>(tiff.data()) + tags[273], tags[279]);
+        std::vector<std::vector<uint8_t>> pixels = DecodeG4(strip, size, size);
+        for (size_t y = 0; y < size; y++)
+        {
+            for (size_t x = 0; x < size; x++)
+            {
+                int r = static_cast<int>(y / options.scale) - options.indent;
+                int c = static_cast<int>(x / options.scale) - options.indent;
+                bool dark = symbol.IsInside(r, c) && symbol.Module(r, c) == BLACK;
+                CPPUNIT_ASSERT_EQUAL(dark, pixels[y][x] == 1);
+            }
+        }
+
+        // an order of magnitude smaller than PBM at print scales
+        CPPUNIT_ASSERT(strip.size() * 10 < size * (size + 7) / 8);
+    }
+    CPPUNIT_ASSERT_EQUAL(canvases.size(), page);
+
+    // single page
+    MemorySink single;
+    TiffG4Outputter().Output(canvases[0], options, single);
+    std::string first(single.Data().begin(), single.Data().end());
+    uint32_t ifd = le(first, 4, 4);
+    CPPUNIT_ASSERT_EQUAL(0u, le(first, ifd + 2 + 12 * le(first, ifd, 2), 4));
+    CPPUNIT_ASSERT_THROW(TiffG4Outputter().OutputPages({}, options, single), Error);
+
+    std::filesystem::remove(path);
+}
+
+// =============================================================================
+
+void TestOutputter::TestPdf()
+{
+    std::vector<Canvas> canvases;
+    for (char c: std::string("ABCDE"))
+        canvases.push_back(Encoder::Encode(std::string("PDF CODE ") + c, CorrectionLevel::M));
+    const int n = static_cast<int>(canvases[0].Size());
+    const OutputOptions options(2, 4);
+    const int cell = (n + 8) * 2;
+
+    PdfLayout layout;
+    layout.columns = 2;
+    layout.margin = 10;
+    layout.spacing = 4;
+
+    for (PdfShapes shapes: {PdfShapes::PATH, PdfShapes::IMAGE})
+    {
+        MemorySink sink;
+        PdfOutputter(shapes, layout).OutputPages(canvases, options, sink);
+        std::string pdf(sink.Data().begin(), sink.Data().end());
+        CPPUNIT_ASSERT_EQUAL(std::string("%PDF-1.4\n"), pdf.substr(0, 9));
+        CPPUNIT_ASSERT(pdf.ends_with("%%EOF\n"));
+        CPPUNIT_ASSERT(pdf.find("/Type /Pages /Count 3 ") != std::string::npos);
+        CPPUNIT_ASSERT(pdf.find("/MediaBox [0 0 " + std::to_string(20 + 2 * cell + 4) + " " +
+                                std::to_string(20 + cell) + "]") != std::string::npos);
+
+        // every cross-reference entry points to its object
+        size_t xref = std::stoul(pdf.substr(pdf.rfind("startxref\n") + 10));
+        std::istringstream table(pdf.substr(xref));
+        std::string word;
+        size_t first = 0, count = 0;
+        table >> word >> first >> count;
+        CPPUNIT_ASSERT_EQUAL(std::string("xref"), word);
+        table.ignore(1);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string entry(20, ' ');
+            table.read(entry.data(), 20);
+            if (i > 0)
+            {
+                std::string header = std::to_string(i) + " 0 obj\n";
+                CPPUNIT_ASSERT_EQUAL(header, pdf.substr(std::stoul(entry.substr(0, 10)), header.size()));
+            }
+        }
+
+        // streams in file order: content of a page, then its image masks
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> streams;
+        for (size_t pos = pdf.find(">>\nstream\n"); pos != std::string::npos; pos = pdf.find(">>\nstream\n", pos + 1))
+        {
+            size_t begin = pos + 10;
+            size_t end = pdf.find("\nendstream", begin);
+            size_t dict = pdf.rfind("obj\n", pos);
+            auto data = std::span(reinterpret_cast<const uint8_t*>(pdf.data()) + begin, end - begin);
+            streams.emplace_back(pdf.substr(dict, pos - dict), Inflate(data.subspan(2, data.size() - 6)));
+        }
+
+        size_t code = 0;
+        for (size_t i = 0; i < streams.size(); i++)
+        {
+            if (streams[i].first.find("/Subtype /Image") != std::string::npos)
+                continue;
+            std::istringstream content(std::string(streams[i].second.begin(), streams[i].second.end()));
+            for (std::string q; content >> q; code++)
+            {
+                CPPUNIT_ASSERT_EQUAL(std::string("q"), q);
+                const int x = 10 + static_cast<int>(code % 2) * (cell + 4) + 8;
+                const int top = 10 + cell - 8;
+                const CanvasRows symbol(canvases[code]);
+
+                int a, b, c, d, e, f;
+                content >> a >> b >> c >> d >> e >> f >> word;
+                if (shapes == PdfShapes::PATH)
+                {
+                    CPPUNIT_ASSERT(a == 2 && b == 0 && c == 0 && d == -2 && e == x && f == top);
+                    std::vector<std::vector<int>> grid(n, std::vector<int>(n, 0));
+                    for (int rx, ry, w, h; content >> word && word != "f";)
+                    {
+                        rx = std::stoi(word);
+                        content >> ry >> w >> h >> word;
+                        CPPUNIT_ASSERT_EQUAL(std::string("re"), word);
+                        for (int r = ry; r < ry + h; r++)
+                            for (int col = rx; col < rx + w; col++)
+                                grid[r][col]++;
+                    }
+                    for (int r = 0; r < n; r++)
+                        for (int col = 0; col < n; col++)
+                            CPPUNIT_ASSERT_EQUAL(static_cast<int>(symbol.Module(r, col) == BLACK), grid[r][col]);
+                }
+                else
+                {
+                    CPPUNIT_ASSERT(a == 2 * n && d == 2 * n && e == x && f == top - 2 * n);
+                    std::string name;
+                    content >> name >> word;
+                    CPPUNIT_ASSERT_EQUAL(std::string("Do"), word);
+
+                    // image masks follow the content stream of their page
+                    size_t image = i + 1 + std::stoul(name.substr(3));
+                    CPPUNIT_ASSERT(streams[image].first.find("/Width " + std::to_string(n)) != std::string::npos);
+                    std::vector<uint8_t> expected;
+                    std::vector<uint8_t> bits(symbol.PackedRowSize());
+                    for (int r = 0; r < n; r++)
+                    {
+                        symbol.PackedRow(r, bits);
+                        expected.insert(expected.end(), bits.begin(), bits.end());
+                    }
+                    CPPUNIT_ASSERT(expected == streams[image].second);
+                }
+                content >> word;
+                CPPUNIT_ASSERT_EQUAL(std::string("Q"), word);
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(canvases.size(), code);
+    }
+
+    // single code on a page of its size
+    MemorySink single;
+    PdfOutputter().Output(canvases[0], options, single);
+    std::string pdf(single.Data().begin(), single.Data().end());
+    CPPUNIT_ASSERT(pdf.find("/MediaBox [0 0 " + std::to_string(cell) + " " + std::to_string(cell) + "]") != std::string::npos);
+
+    // cells fit the first code
+    canvases.push_back(Encoder::Encode(std::string(100, '7'), CorrectionLevel::H));
+    CPPUNIT_ASSERT_THROW(PdfOutputter(PdfShapes::PATH, layout).OutputPages(canvases, options, single), Error);
+}
+
+// =============================================================================
+
+void TestOutputter::TestPrinters()
+{
+    SymbolView symbol = SymbolView::Encode("https://example.com/label/000123", CorrectionLevel::Q);
+    const OutputOptions options(6, 4);
+    Raster raster(symbol, options);
+    std::vector<std::vector<uint8_t>> expected;
+    for (size_t y = 0; y < raster.Size(); y++)
+        expected.emplace_back(raster.Row(y).begin(), raster.Row(y).end());
+    const size_t stride = raster.Stride();
+
+    for (size_t band: {size_t(1), size_t(10), EscPosOutputter::DEFAULT_BAND_ROWS, size_t(100000)})
+    {
+        // GS v 0 commands
+        MemorySink escpos;
+        EscPosOutputter(band).Output(symbol, options, escpos);
+        const std::vector<uint8_t>& data = escpos.Data();
+        std::vector<std::vector<uint8_t>> rows;
+        for (size_t pos = 0; pos < data.size();)
+        {
+            CPPUNIT_ASSERT(data[pos] == 0x1D && data[pos + 1] == 'v' && data[pos + 2] == '0' && data[pos + 3] == 0);
+            size_t width = data[pos + 4] | (data[pos + 5] << 8);
+            size_t height = data[pos + 6] | (data[pos + 7] << 8);
+            CPPUNIT_ASSERT_EQUAL(stride, width);
+            CPPUNIT_ASSERT(height <= band);
+            pos += 8;
+            for (size_t y = 0; y < height; y++, pos += width)
+                rows.emplace_back(data.begin() + pos, data.begin() + pos + width);
+        }
+        CPPUNIT_ASSERT(expected == rows);
+
+        // ZPL graphic fields
+        MemorySink zpl_sink;
+        ZplOutputter(band).Output(symbol, options, zpl_sink);
+        std::string zpl(zpl_sink.Data().begin(), zpl_sink.Data().end());
+        std::string header = "^XA\n^PW" + std::to_string(raster.Size()) + "\n^LL" + std::to_string(raster.Size()) + "\n";
+        CPPUNIT_ASSERT_EQUAL(header, zpl.substr(0, header.size()));
+        CPPUNIT_ASSERT(zpl.ends_with("^FS\n^XZ\n"));
+
+        rows.clear();
+        for (size_t pos = zpl.find("^FO"); pos != std::string::npos; pos = zpl.find("^FO", pos + 1))
+        {
+            size_t x = 0, y = 0, field = 0, field_count = 0, bytes_per_row = 0;
+            char comma;
+            std::istringstream params(zpl.substr(pos + 3, 64));
+            params >> x >> comma >> y;
+            params.ignore(5);
+            params >> field >> comma >> field_count >> comma >> bytes_per_row;
+            CPPUNIT_ASSERT_EQUAL(size_t(0), x);
+            CPPUNIT_ASSERT_EQUAL(rows.size(), y);
+            CPPUNIT_ASSERT_EQUAL(field, field_count);
+            CPPUNIT_ASSERT_EQUAL(stride, bytes_per_row);
+
+            size_t begin = zpl.find(',', zpl.find("^GFA,", pos) + 5);
+            begin = zpl.find(',', begin + 1);
+            begin = zpl.find(',', begin + 1) + 1;
+            size_t end = zpl.find("^FS", begin);
+            const size_t first = rows.size();
+
+            std::vector<uint8_t> row;
+            size_t nibbles = 0, repeat = 0;
+            auto push = [&](int value) {
+                if (nibbles % 2 == 0)
+                    row.push_back(static_cast<uint8_t>(value << 4));
+                else
+                    row.back() |= value;
+                if (++nibbles == 2 * stride)
+                {
+                    rows.push_back(row);
+                    row.clear();
+                    nibbles = 0;
+                }
+            };
+            for (char c: zpl.substr(begin, end - begin))
+            {
+                if (c >= 'G' && c <= 'Y')
+                    repeat += c - 'G' + 1;
+                else if (c >= 'g' && c <= 'z')
+                    repeat += (c - 'g' + 1) * 20;
+                else if (c == ':')
+                {
+                    CPPUNIT_ASSERT(nibbles == 0 && rows.size() > first);
+                    rows.push_back(rows.back());
+                }
+                else if (c == ',' || c == '!')
+                {
+                    for (size_t start = rows.size(); rows.size() == start;)
+                        push(c == ',' ? 0 : 0xF);
+                }
+                else
+                {
+                    int value = std::stoi(std::string(1, c), nullptr, 16);
+                    for (size_t i = 0; i < std::max<size_t>(repeat, 1); i++)
+                        push(value);
+                    repeat = 0;
+                }
+            }
+            CPPUNIT_ASSERT_EQUAL(size_t(0), nibbles);
+            CPPUNIT_ASSERT_EQUAL(field, (rows.size() - first) * stride);
+        }
+        CPPUNIT_ASSERT(expected == rows);
+
+        // runs of equal rows are repeated with ':'
+        if (band > 1)
+            CPPUNIT_ASSERT(zpl.size() < raster.Size() * stride / 2);
+    }
+}
+
+// =============================================================================
+
+void TestOutputter::TestMapped()
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    SymbolView symbol = SymbolView::Encode("https://example.com/poster", CorrectionLevel::H);
+    const OutputOptions options(9, 3);
+
+    Raster raster(symbol, options);
+    const size_t size = raster.Size();
+
+    // bands of a few rows, bottom-up rows with padding over garbage
+    const size_t stride = raster.Stride() + 3;
+    std::vector<std::byte> buffer(5 + stride * size, std::byte(0xCC));
+    RowLayout layout;
+    layout.offset = 5;
+    layout.stride = stride;
+    layout.bottom_up = true;
+    RenderBands(symbol, options, buffer, layout, 7);
+    for (size_t y = 0; y < size; y++)
+    {
+        std::span<const uint8_t> row = raster.Row(y);
+        const std::byte* out = buffer.data() + 5 + (size - 1 - y) * stride;
+        CPPUNIT_ASSERT(std::memcmp(out, row.data(), row.size()) == 0);
+        for (size_t i = row.size(); i < stride; i++)
+            CPPUNIT_ASSERT(out[i] == std::byte(0));
+    }
+    CPPUNIT_ASSERT(buffer[4] == std::byte(0xCC));
+
+    layout.stride = raster.Stride() - 1;
+    CPPUNIT_ASSERT_THROW(RenderBands(symbol, options, buffer, layout), Error);
+    layout.stride = stride + 1;
+    CPPUNIT_ASSERT_THROW(RenderBands(symbol, options, buffer, layout), Error);
+
+    // PBM is the same file PBMOutputter writes
+    const std::filesystem::path pbm_path = dir / "myqro-test-mapped.pbm";
+    MappedOutputter(pbm_path).Output(symbol, options);
+    MemorySink pbm;
+    PBMOutputter().Output(symbol, options, pbm);
+    CPPUNIT_ASSERT(std::string(pbm.Data().begin(), pbm.Data().end()) == ReadFile(pbm_path));
+    std::filesystem::remove(pbm_path);
+
+    // BMP headers, palette and bottom-up rows padded to 4 bytes
+    const std::filesystem::path bmp_path = dir / "myqro-test-mapped.bmp";
+    MappedOutputter(bmp_path, MappedFormat::BMP).Output(symbol, options);
+    const std::string bmp = ReadFile(bmp_path);
+    std::filesystem::remove(bmp_path);
+
+    auto le = [&bmp](size_t pos, int n_bytes) {
+        uint32_t value = 0;
+        for (int i = n_bytes - 1; i >= 0; i--)
+            value = (value << 8) | static_cast<uint8_t>(bmp[pos + i]);
+        return value;
+    };
+    const size_t bmp_stride = (size + 31) / 32 * 4;
+    CPPUNIT_ASSERT(bmp.substr(0, 2) == "BM");
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(bmp.size()), le(2, 4));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(62), le(10, 4));
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(size), le(18, 4));
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(size), le(22, 4));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), le(28, 2));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0xFFFFFF), le(54, 4));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), le(58, 4));
+    CPPUNIT_ASSERT_EQUAL(62 + bmp_stride * size, bmp.size());
+    for (size_t y = 0; y < size; y++)
+    {
+        std::span<const uint8_t> row = raster.Row(y);
+        const std::string expected = std::string(row.begin(), row.end()) + std::string(bmp_stride - row.size(), '\0');
+        CPPUNIT_ASSERT(bmp.substr(62 + (size - 1 - y) * bmp_stride, bmp_stride) == expected);
+    }
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
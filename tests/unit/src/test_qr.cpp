@@ -2,6 +2,7 @@
 
 #include "encoder.hpp"
 #include "outputter.hpp"
+#include "serial_encoder.hpp"
 
 
 // =============================================================================
@@ -15,10 +16,14 @@ class TestQR : public CppUnit::TestFixture
 {
     CPPUNIT_TEST_SUITE(TestQR);
     CPPUNIT_TEST(TestQrBytesEncoding);
+    CPPUNIT_TEST(TestParallelBestMask);
+    CPPUNIT_TEST(TestSerialEncoder);
     CPPUNIT_TEST_SUITE_END();
 
 protected:
     void TestQrBytesEncoding();
+    void TestParallelBestMask();
+    void TestSerialEncoder();
 
 private:
     struct Params
@@ -640,6 +645,63 @@ void TestQR::TestQrBytesEncoding()
 
 // =============================================================================
 
+void TestQR::TestParallelBestMask()
+{
+    EncodeOptions serial, parallel;
+    serial.parallel_mask_min_version = 0;
+    parallel.parallel_mask_min_version = 1;
+
+    for (size_t length: {10, 300, 1500})
+    {
+        std::string msg(length, 'x');
+        for (size_t i = 0; i < length; i++)
+            msg[i] = static_cast<char>('a' + (i * 7) % 26);
+
+        std::stringstream s1, s2;
+        ImprintOutputter(s1).Output(Encoder::Encode(msg, CorrectionLevel::M, EncodingType::BYTES, -1, serial));
+        ImprintOutputter(s2).Output(Encoder::Encode(msg, CorrectionLevel::M, EncodingType::BYTES, -1, parallel));
+        CPPUNIT_ASSERT_EQUAL(s1.str(), s2.str());
+    }
+}
+
+// =============================================================================
+
+void TestQR::TestSerialEncoder()
+{
+    const std::vector<Params> params = {
+        {EncodingType::BYTES, CorrectionLevel::M, 0, "LBL-2024/"},
+        {EncodingType::BYTES, CorrectionLevel::H, -1, "https://example.com/item?id="},
+        {EncodingType::NUNERIC, CorrectionLevel::L, 5, "4601234"},
+        {EncodingType::NUNERIC, CorrectionLevel::Q, -1, "77"},
+        {EncodingType::ALPHANUMERIC, CorrectionLevel::L, -1, "LOT 42/A"},
+        {EncodingType::BYTES, CorrectionLevel::Q, -1, std::string(150, 'x') + "/"},
+    };
+
+    for (const Params& p: params)
+    {
+        const uint64_t start = 995;
+        std::vector<Canvas> canvases = SerialEncoder::EncodeRange(p.msg, start, 12, p.cl, p.encoding, p.mask_id);
+        CPPUNIT_ASSERT_EQUAL(size_t(12), canvases.size());
+
+        for (size_t i = 0; i < canvases.size(); i++)
+        {
+            std::string number = std::to_string(start + i);
+            std::string msg = p.msg + std::string(4 - number.size(), '0') + number;
+
+            std::stringstream s1, s2;
+            ImprintOutputter(s1).Output(canvases[i]);
+            ImprintOutputter(s2).Output(Encoder::Encode(msg, p.cl, p.encoding, p.mask_id));
+            CPPUNIT_ASSERT_EQUAL(s2.str(), s1.str());
+        }
+    }
+
+    SerialEncoder encoder("ID", 3);
+    CPPUNIT_ASSERT_EQUAL(std::string("ID007"), encoder.Message(7));
+    CPPUNIT_ASSERT_THROW(encoder.Message(1000), Error);
+}
+
+// =============================================================================
+
 } // namespace myqro::test
 
 // =============================================================================
@@ -0,0 +1,344 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "outputter.hpp"
+#include "raster.hpp"
+#include "row_sink.hpp"
+#include "symbol_view.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+namespace
+{
+
+// Keeps all rows, refuses rows from `limit` on
+class CollectingSink : public RowSink
+{
+public:
+    CollectingSink(size_t limit = SIZE_MAX) : limit(limit) {}
+
+    void Begin(size_t w, size_t h) override { width = w; height = h; }
+
+    bool Row(std::span<const uint8_t> pixels) override
+    {
+        if (rows.size() >= limit)
+            return false;
+        rows.emplace_back(pixels.begin(), pixels.end());
+        return true;
+    }
+
+    void End() override { ended = true; }
+    void Abort() override { aborted = true; }
+
+    size_t limit;
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<std::vector<uint8_t>> rows;
+    bool ended = false;
+    bool aborted = false;
+};
+
+} // namespace
+
+// =============================================================================
+
+class TestRowSink : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestRowSink);
+
+    CPPUNIT_TEST(TestRender);
+    CPPUNIT_TEST(TestCancel);
+    CPPUNIT_TEST(TestAsync);
+    CPPUNIT_TEST(TestAsyncErrors);
+    CPPUNIT_TEST(TestTee);
+    CPPUNIT_TEST(TestOutputAll);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestRender();
+    void TestCancel();
+    void TestAsync();
+    void TestAsyncErrors();
+    void TestTee();
+    void TestOutputAll();
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestRowSink);
+
+// =============================================================================
+
+void TestRowSink::TestRender()
+{
+    SymbolView symbol = SymbolView::Encode("https://example.com/row-sink", CorrectionLevel::M);
+    OutputOptions options(3, 2);
+
+    CollectingSink sink;
+    CPPUNIT_ASSERT(RenderRows(symbol, options, sink));
+    CPPUNIT_ASSERT(sink.ended && !sink.aborted);
+
+    Raster raster(symbol, options);
+    CPPUNIT_ASSERT_EQUAL(raster.Size(), sink.width);
+    CPPUNIT_ASSERT_EQUAL(raster.Size(), sink.height);
+    CPPUNIT_ASSERT_EQUAL(raster.Size(), sink.rows.size());
+    for (size_t y = 0; y < raster.Size(); y++)
+    {
+        std::span<const uint8_t> row = raster.Row(y);
+        CPPUNIT_ASSERT(std::equal(row.begin(), row.end(), sink.rows[y].begin(), sink.rows[y].end()));
+    }
+
+    // the outputters are built on the row sinks
+    MemorySink pbm, png, expected_pbm, expected_png;
+    PBMOutputter().Output(symbol, options, expected_pbm);
+    PngOutputter().Output(symbol, options, expected_png);
+    PbmRowSink pbm_rows(pbm);
+    PngRowSink png_rows(png);
+    RenderRows(symbol, options, pbm_rows);
+    RenderRows(symbol, options, png_rows);
+    CPPUNIT_ASSERT(expected_pbm.Data() == pbm.Data());
+    CPPUNIT_ASSERT(expected_png.Data() == png.Data());
+}
+
+// =============================================================================
+
+void TestRowSink::TestCancel()
+{
+    SymbolView symbol = SymbolView::Encode("CANCEL", CorrectionLevel::L);
+    OutputOptions options(2, 4);
+
+    CollectingSink refusing(10);
+    CPPUNIT_ASSERT(!RenderRows(symbol, options, refusing));
+    CPPUNIT_ASSERT_EQUAL(size_t(10), refusing.rows.size());
+    CPPUNIT_ASSERT(refusing.aborted && !refusing.ended);
+
+    std::stop_source stop;
+    stop.request_stop();
+    CollectingSink stopped;
+    CPPUNIT_ASSERT(!RenderRows(symbol, options, stopped, stop.get_token()));
+    CPPUNIT_ASSERT(stopped.rows.empty());
+    CPPUNIT_ASSERT(stopped.aborted && !stopped.ended);
+}
+
+// =============================================================================
+
+void TestRowSink::TestAsync()
+{
+    // the consumer is slow, the producer must never get more than `capacity` rows ahead
+    class SlowSink : public CollectingSink
+    {
+    public:
+        SlowSink(const std::atomic<size_t>& produced) : produced(produced) {}
+
+        bool Row(std::span<const uint8_t> pixels) override
+        {
+            max_ahead = std::max(max_ahead, produced.load() - rows.size());
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            return CollectingSink::Row(pixels);
+        }
+
+        const std::atomic<size_t>& produced;
+        size_t max_ahead = 0;
+    };
+
+    class CountingRows : public RowSink
+    {
+    public:
+        CountingRows(RowSink& sink, std::atomic<size_t>& produced) : sink(sink), produced(produced) {}
+
+        void Begin(size_t w, size_t h) override { sink.Begin(w, h); }
+        bool Row(std::span<const uint8_t> pixels) override
+        {
+            bool accepted = sink.Row(pixels);
+            produced++;
+            return accepted;
+        }
+        void End() override { sink.End(); }
+        void Abort() override { sink.Abort(); }
+
+        RowSink& sink;
+        std::atomic<size_t>& produced;
+    };
+
+    SymbolView symbol = SymbolView::Encode("BACKPRESSURE 0123456789", CorrectionLevel::H);
+    OutputOptions options(4, 4);
+    constexpr size_t capacity = 3;
+
+    std::atomic<size_t> produced = 0;
+    SlowSink slow(produced);
+    AsyncRowSink async(slow, capacity);
+    CountingRows counting(async, produced);
+
+    CPPUNIT_ASSERT(RenderRows(symbol, options, counting));
+    CPPUNIT_ASSERT(!async.Cancelled());
+    CPPUNIT_ASSERT(slow.ended && !slow.aborted);
+    CPPUNIT_ASSERT(slow.max_ahead <= capacity + 1);
+
+    CollectingSink direct;
+    RenderRows(symbol, options, direct);
+    CPPUNIT_ASSERT(direct.rows == slow.rows);
+
+    // PNG compressed on the consumer thread
+    MemorySink expected, actual;
+    PngOutputter().Output(symbol, options, expected);
+    PngRowSink png(actual);
+    AsyncRowSink async_png(png);
+    CPPUNIT_ASSERT(RenderRows(symbol, options, async_png));
+    CPPUNIT_ASSERT(expected.Data() == actual.Data());
+
+    // the consumer refuses a row, the producer sees it at a later row
+    CollectingSink refusing(5);
+    AsyncRowSink async_refusing(refusing, 2);
+    CPPUNIT_ASSERT(!RenderRows(symbol, options, async_refusing));
+    CPPUNIT_ASSERT(async_refusing.Cancelled());
+    CPPUNIT_ASSERT_EQUAL(size_t(5), refusing.rows.size());
+    CPPUNIT_ASSERT(refusing.aborted && !refusing.ended);
+}
+
+// =============================================================================
+
+void TestRowSink::TestAsyncErrors()
+{
+    class FailingSink : public CollectingSink
+    {
+    public:
+        bool Row(std::span<const uint8_t> pixels) override
+        {
+            if (rows.size() == 3)
+                throw std::runtime_error("printer is offline");
+            return CollectingSink::Row(pixels);
+        }
+    };
+
+    SymbolView symbol = SymbolView::Encode("ERRORS", CorrectionLevel::Q);
+    FailingSink failing;
+    AsyncRowSink async(failing, 1);
+    CPPUNIT_ASSERT_THROW(RenderRows(symbol, OutputOptions(2, 0), async), std::runtime_error);
+    CPPUNIT_ASSERT(!failing.ended);
+
+    // destroyed without End or Abort
+    CollectingSink sink;
+    {
+        AsyncRowSink unfinished(sink);
+        unfinished.Begin(16, 16);
+        uint8_t row[2] = {0xFF, 0x00};
+        CPPUNIT_ASSERT(unfinished.Row(row));
+    }
+    CPPUNIT_ASSERT(!sink.ended);
+}
+
+// =============================================================================
+
+void TestRowSink::TestTee()
+{
+    SymbolView symbol = SymbolView::Encode("TEE", CorrectionLevel::M);
+    OutputOptions options(2, 1);
+
+    CollectingSink first, second;
+    TeeRowSink tee;
+    tee.Add(first);
+    tee.Add(second);
+    CPPUNIT_ASSERT(RenderRows(symbol, options, tee));
+    CPPUNIT_ASSERT(first.ended && second.ended);
+    CPPUNIT_ASSERT_EQUAL(size_t(Raster(symbol, options).Size()), first.rows.size());
+    CPPUNIT_ASSERT(first.rows == second.rows);
+
+    // one sink refusing cancels all
+    CollectingSink all, refusing(4);
+    TeeRowSink cancelled;
+    cancelled.Add(all);
+    cancelled.Add(refusing);
+    CPPUNIT_ASSERT(!RenderRows(symbol, options, cancelled));
+    CPPUNIT_ASSERT(all.aborted && refusing.aborted);
+    CPPUNIT_ASSERT(!all.ended && !refusing.ended);
+}
+
+// =============================================================================
+
+void TestRowSink::TestOutputAll()
+{
+    // counts the module rows read
+    class CountingSymbol : public SymbolRows
+    {
+    public:
+        CountingSymbol(const SymbolRows& symbol) : symbol(symbol) {}
+
+        size_t Size() const final { return symbol.Size(); }
+        uint8_t Module(size_t row, size_t col) const final { return symbol.Module(row, col); }
+        void Row(size_t row, std::span<uint8_t> values) const final { rows++; symbol.Row(row, values); }
+        void PackedRow(size_t row, std::span<uint8_t> bits) const final { rows++; symbol.PackedRow(row, bits); }
+
+        const SymbolRows& symbol;
+        mutable size_t rows = 0;
+    };
+
+    auto read = [](const std::filesystem::path& path) {
+        std::ifstream stream(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    };
+
+    SymbolView symbol = SymbolView::Encode("https://example.com/all-formats", CorrectionLevel::Q);
+    OutputOptions options(3, 2);
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::filesystem::path paths[] = {dir / "myqro-all.png", dir / "myqro-all.pbm", dir / "myqro-all.tif",
+                                           dir / "myqro-all.svg", dir / "myqro-all-mixed.png"};
+
+    std::vector<std::unique_ptr<Outputter>> outputters;
+    outputters.push_back(std::make_unique<PngOutputter>(paths[0]));
+    outputters.push_back(std::make_unique<PBMOutputter>(paths[1]));
+    outputters.push_back(std::make_unique<TiffG4Outputter>(paths[2]));
+    std::vector<Outputter*> raster;
+    for (const auto& outputter: outputters)
+        raster.push_back(outputter.get());
+
+    // raster formats share one pass over the module rows
+    CountingSymbol counting(symbol);
+    Outputter::OutputAll(counting, options, raster);
+    CPPUNIT_ASSERT_EQUAL(symbol.Size(), counting.rows);
+
+    MemorySink png, pbm, tiff;
+    PngOutputter().Output(symbol, options, png);
+    PBMOutputter().Output(symbol, options, pbm);
+    TiffG4Outputter().Output(symbol, options, tiff);
+    CPPUNIT_ASSERT(png.Data() == read(paths[0]));
+    CPPUNIT_ASSERT(pbm.Data() == read(paths[1]));
+    CPPUNIT_ASSERT(tiff.Data() == read(paths[2]));
+
+    // other formats are written on their own
+    SvgOutputter svg(paths[3]);
+    PngOutputter mixed_png(paths[4]);
+    Outputter* mixed[] = {&svg, &mixed_png};
+    Outputter::OutputAll(symbol, options, mixed);
+    const std::vector<uint8_t> document = read(paths[3]);
+    const std::string expected = SvgOutputter().Render(symbol, options);
+    CPPUNIT_ASSERT(std::string(document.begin(), document.end()) == expected);
+    CPPUNIT_ASSERT(png.Data() == read(paths[4]));
+
+    for (const auto& path: paths)
+        std::filesystem::remove(path);
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
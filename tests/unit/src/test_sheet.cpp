@@ -0,0 +1,217 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "encoder.hpp"
+#include "error.hpp"
+#include "sheet.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+namespace
+{
+
+class ImageSink : public RowSink
+{
+public:
+    void Begin(size_t w, size_t h) override { width = w; height = h; }
+    bool Row(std::span<const uint8_t> pixels) override
+    {
+        rows.emplace_back(pixels.begin(), pixels.end());
+        return true;
+    }
+    void End() override { ended = true; }
+
+    bool At(size_t x, size_t y) const { return (rows[y][x / 8] >> (7 - x % 8)) & 1; }
+
+    bool Blank(size_t x0, size_t y0, size_t x1, size_t y1) const
+    {
+        for (size_t y = y0; y < y1; y++)
+            for (size_t x = x0; x < x1; x++)
+                if (At(x, y))
+                    return false;
+        return true;
+    }
+
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<std::vector<uint8_t>> rows;
+    bool ended = false;
+};
+
+std::vector<Canvas> MakeCodes(size_t count)
+{
+    std::vector<Canvas> codes;
+    for (size_t i = 0; i < count; i++)
+        codes.push_back(Encoder::Encode("LABEL " + std::string(i * 13, 'X'), CorrectionLevel::M));
+    return codes;
+}
+
+} // namespace
+
+// =============================================================================
+
+class TestSheet : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestSheet);
+
+    CPPUNIT_TEST(TestLayout);
+    CPPUNIT_TEST(TestCaptions);
+    CPPUNIT_TEST(TestOutput);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestLayout();
+    void TestCaptions();
+    void TestOutput();
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestSheet);
+
+// =============================================================================
+
+void TestSheet::TestLayout()
+{
+    std::vector<Canvas> codes = MakeCodes(5);
+    CPPUNIT_ASSERT(codes.front().Size() < codes.back().Size());
+
+    SheetLayout layout;
+    layout.columns = 2;
+    layout.margin = 3;
+    layout.spacing = 5;
+    layout.symbol = OutputOptions(2, 1);
+
+    ImageSink image;
+    CPPUNIT_ASSERT(RenderSheet(codes, layout, image));
+    CPPUNIT_ASSERT(image.ended);
+
+    const size_t cell = (codes.back().Size() + 2) * 2;
+    CPPUNIT_ASSERT_EQUAL(2*3 + 2*cell + 5, image.width);
+    CPPUNIT_ASSERT_EQUAL(2*3 + 3*cell + 2*5, image.height);
+    CPPUNIT_ASSERT_EQUAL(image.height, image.rows.size());
+
+    for (size_t i = 0; i < codes.size(); i++)
+    {
+        const Canvas& code = codes[i];
+        const size_t size = (code.Size() + 2) * 2;
+        const size_t cell_x = 3 + (i % 2) * (cell + 5);
+        const size_t cell_y = 3 + (i / 2) * (cell + 5);
+        const size_t x0 = cell_x + (cell - size) / 2 + 2;
+        const size_t y0 = cell_y + 2;
+
+        for (size_t y = 0; y < code.Size() * 2; y++)
+            for (size_t x = 0; x < code.Size() * 2; x++)
+                CPPUNIT_ASSERT_EQUAL(bool(code.At(y / 2, x / 2).value), image.At(x0 + x, y0 + y));
+
+        // quiet zone and the rest of the cell
+        CPPUNIT_ASSERT(image.Blank(cell_x, cell_y, cell_x + cell, y0));
+        CPPUNIT_ASSERT(image.Blank(cell_x, cell_y, x0, cell_y + cell));
+        CPPUNIT_ASSERT(image.Blank(x0 + code.Size() * 2, cell_y, cell_x + cell, cell_y + cell));
+        CPPUNIT_ASSERT(image.Blank(cell_x, y0 + code.Size() * 2, cell_x + cell, cell_y + cell));
+    }
+
+    // margins, spacing and the empty last cell
+    CPPUNIT_ASSERT(image.Blank(0, 0, image.width, 3));
+    CPPUNIT_ASSERT(image.Blank(0, 0, 3, image.height));
+    CPPUNIT_ASSERT(image.Blank(3 + cell, 0, 3 + cell + 5, image.height));
+    CPPUNIT_ASSERT(image.Blank(3 + cell + 5, 3 + 2 * (cell + 5), image.width, image.height));
+
+    // fixed cells larger than the codes
+    layout.cell_width = cell + 10;
+    layout.cell_height = cell + 4;
+    ImageSink fixed;
+    RenderSheet(codes, layout, fixed);
+    CPPUNIT_ASSERT_EQUAL(2*3 + 2*(cell + 10) + 5, fixed.width);
+    CPPUNIT_ASSERT_EQUAL(2*3 + 3*(cell + 4) + 2*5, fixed.height);
+
+    layout.cell_width = cell - 1;
+    CPPUNIT_ASSERT_THROW(RenderSheet(codes, layout, fixed), Error);
+}
+
+// =============================================================================
+
+void TestSheet::TestCaptions()
+{
+    std::vector<Canvas> codes = MakeCodes(3);
+    SheetLayout layout;
+    layout.columns = 3;
+    layout.symbol = OutputOptions(1, 2);
+    layout.caption_scale = 2;
+
+    auto render = [&](std::vector<std::string> captions) {
+        ImageSink image;
+        RenderSheet(codes, layout, image, captions);
+        return image;
+    };
+
+    ImageSink image = render({"A1", "", "lower"});
+    const size_t cell = codes.back().Size() + 4;
+    CPPUNIT_ASSERT_EQUAL(cell + 8 * 2, image.height);
+
+    CPPUNIT_ASSERT(!image.Blank(0, cell, cell, cell + 14));
+    CPPUNIT_ASSERT(image.Blank(cell, cell, 2 * cell, image.height));
+    CPPUNIT_ASSERT(!image.Blank(2 * cell, cell, 3 * cell, cell + 14));
+    CPPUNIT_ASSERT(image.Blank(0, cell + 14, image.width, image.height));
+
+    CPPUNIT_ASSERT(render({"A1", "", "lower"}).rows == render({"a1", "", "LOWER"}).rows);
+    CPPUNIT_ASSERT(render({"~", "", ""}).rows == render({"?", "", ""}).rows);
+
+    // long captions are clipped to their cell
+    ImageSink clipped = render({std::string(100, '#'), "", ""});
+    CPPUNIT_ASSERT(clipped.Blank(cell, cell, image.width, image.height));
+
+    CPPUNIT_ASSERT_THROW(render({"one"}), Error);
+    layout.cell_height = cell + 4;
+    CPPUNIT_ASSERT_THROW(render({"A", "B", "C"}), Error);
+}
+
+// =============================================================================
+
+void TestSheet::TestOutput()
+{
+    std::vector<Canvas> codes = MakeCodes(4);
+    SheetLayout layout;
+    layout.columns = 3;
+    layout.margin = 8;
+    layout.symbol = OutputOptions(3, 4);
+
+    ImageSink image;
+    RenderSheet(codes, layout, image);
+
+    MemorySink pbm;
+    SheetOutputter(layout, SheetFormat::PBM).Output(codes, {}, pbm);
+    std::string header = "P4\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n";
+    std::vector<uint8_t> expected(header.begin(), header.end());
+    for (const auto& row: image.rows)
+        expected.insert(expected.end(), row.begin(), row.end());
+    CPPUNIT_ASSERT(expected == pbm.Data());
+
+    MemorySink png;
+    SheetOutputter(layout).Output(codes, {}, png);
+    CPPUNIT_ASSERT(std::string("\x89PNG") == std::string(png.Data().begin(), png.Data().begin() + 4));
+
+    CPPUNIT_ASSERT_THROW(SheetOutputter(layout).Output(codes), Error);
+
+    std::stop_source stop;
+    stop.request_stop();
+    ImageSink stopped;
+    CPPUNIT_ASSERT(!RenderSheet(codes, layout, stopped, {}, stop.get_token()));
+    CPPUNIT_ASSERT(stopped.rows.empty() && !stopped.ended);
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
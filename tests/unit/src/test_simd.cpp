@@ -0,0 +1,272 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "datastream.hpp"
+#include "error.hpp"
+#include "reed_solomon.hpp"
+#include "simd.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestSimd : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestSimd);
+
+    CPPUNIT_TEST(TestSimdLevelString);
+    CPPUNIT_TEST(TestCorrectionTile);
+    CPPUNIT_TEST(TestBitKernels);
+    CPPUNIT_TEST(TestPenaltyKernels);
+    CPPUNIT_TEST(TestExpandBits);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestSimdLevelString();
+    void TestCorrectionTile();
+    void TestBitKernels();
+    void TestPenaltyKernels();
+    void TestExpandBits();
+
+private:
+    static std::vector<SimdLevel> SupportedLevels();
+    static ArrayType RandomBytes(size_t size, uint32_t seed, uint8_t mod = 0);
+
+    // Plain per-module scans the penalty kernels must agree with
+    static size_t ReferenceRuns(const ArrayType& plane, size_t width);
+    static size_t ReferenceSquares(const ArrayType& plane, size_t width);
+    static size_t ReferenceFinders(const ArrayType& plane, size_t width);
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestSimd);
+
+// =============================================================================
+
+std::vector<SimdLevel> TestSimd::SupportedLevels()
+{
+    std::vector<SimdLevel> result;
+    for (SimdLevel l: {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        if (l <= DetectSimdLevel()) result.push_back(l);
+    return result;
+}
+
+ArrayType TestSimd::RandomBytes(size_t size, uint32_t seed, uint8_t mod)
+{
+    ArrayType result(size);
+    for (uint8_t& x: result)
+    {
+        seed = seed * 1664525 + 1013904223;
+        x = static_cast<uint8_t>(seed >> 24);
+        if (mod > 0) x %= mod;
+    }
+    return result;
+}
+
+size_t TestSimd::ReferenceRuns(const ArrayType& plane, size_t width)
+{
+    size_t result = 0;
+    for (size_t r = 0; r < plane.size() / width; r++)
+    {
+        for (size_t c = 0; c < width;)
+        {
+            size_t end = c;
+            while (end < width && plane[r * width + end] == plane[r * width + c])
+                end++;
+            if (end - c >= 5)
+                result += end - c - 2;
+            c = end;
+        }
+    }
+    return result;
+}
+
+size_t TestSimd::ReferenceSquares(const ArrayType& plane, size_t width)
+{
+    size_t result = 0;
+    for (size_t r = 0; r + 1 < plane.size() / width; r++)
+    {
+        for (size_t c = 0; c + 1 < width; c++)
+        {
+            uint8_t v = plane[r * width + c];
+            if (plane[r * width + c + 1] == v && plane[(r + 1) * width + c] == v && plane[(r + 1) * width + c + 1] == v)
+                result++;
+        }
+    }
+    return result;
+}
+
+size_t TestSimd::ReferenceFinders(const ArrayType& plane, size_t width)
+{
+    const uint8_t pattern[] = {1, 0, 1, 1, 1, 0, 1};
+    auto matches = [&](size_t at, const uint8_t* expected, size_t length) {
+        for (size_t i = 0; i < length; i++)
+            if (plane[at + i] != expected[i])
+                return false;
+        return true;
+    };
+    const uint8_t white[4] = {};
+
+    size_t result = 0;
+    for (size_t r = 0; r < plane.size() / width; r++)
+    {
+        const size_t row = r * width;
+        for (size_t col = 0; col + 7 <= width;)
+        {
+            if (!matches(row + col, pattern, 7))
+            {
+                col++;
+                continue;
+            }
+            bool before = col > 4 && matches(row + col - 4, white, 4);
+            bool after = col + 11 <= width && matches(row + col + 7, white, 4);
+            if (before || after)
+                result++;
+            col += after ? 11 : before ? 7 : 1;
+        }
+    }
+    return result;
+}
+
+// =============================================================================
+
+void TestSimd::TestSimdLevelString()
+{
+    for (SimdLevel l: {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        CPPUNIT_ASSERT(l == SimdLevelFromString(SimdLevelToString(l)));
+    CPPUNIT_ASSERT(GetKernels().level <= DetectSimdLevel());
+    CPPUNIT_ASSERT_THROW(SimdLevelFromString("neon"), Error);
+}
+
+void TestSimd::TestCorrectionTile()
+{
+    for (size_t n_corr_bytes: {7, 17, 30})
+    {
+        std::vector<uint8_t> generator = GeneratorCoefficients(n_corr_bytes);
+        for (size_t width: {size_t(1), size_t(13), CORRECTION_TILE_LANES})
+        {
+            size_t block_size = 40;
+            ArrayType data = RandomBytes(block_size * width, static_cast<uint32_t>(n_corr_bytes * width));
+
+            // blocks in natural layout for the reference implementation
+            ArrayType plain(data.size());
+            for (size_t j = 0; j < block_size; j++)
+                for (size_t l = 0; l < width; l++)
+                    plain[l * block_size + j] = data[j * width + l];
+
+            for (SimdLevel level: SupportedLevels())
+            {
+                ArrayType parity(n_corr_bytes * width);
+                GetKernels(level).correction_tile(data.data(), block_size, width, width,
+                                                  generator.data(), generator.size(), parity.data());
+
+                for (size_t l = 0; l < width; l++)
+                {
+                    Block block{plain.begin() + l * block_size, plain.begin() + (l + 1) * block_size};
+                    ArrayType expected = GenerateCorrectionBlock(block, n_corr_bytes);
+                    for (size_t i = 0; i < n_corr_bytes; i++)
+                        CPPUNIT_ASSERT_EQUAL(expected[i], parity[i * width + l]);
+                }
+            }
+        }
+    }
+}
+
+void TestSimd::TestBitKernels()
+{
+    const Kernels& reference = GetKernels(SimdLevel::SSE2);
+    for (size_t count: {1, 7, 64, 1001})
+    {
+        ArrayType src = RandomBytes(count, static_cast<uint32_t>(count));
+        ArrayType expected(count), expected_xor = RandomBytes(count, 7);
+        reference.unpack_bits(src.data(), count, expected.data());
+        reference.xor_bytes(expected_xor.data(), src.data(), count);
+
+        for (size_t i = 0; i < count; i++)
+            CPPUNIT_ASSERT_EQUAL(GetBit(src[i / 8], 7 - i % 8), expected[i]);
+
+        for (SimdLevel level: SupportedLevels())
+        {
+            ArrayType bits(count), x = RandomBytes(count, 7);
+            GetKernels(level).unpack_bits(src.data(), count, bits.data());
+            GetKernels(level).xor_bytes(x.data(), src.data(), count);
+            CPPUNIT_ASSERT(expected == bits);
+            CPPUNIT_ASSERT(expected_xor == x);
+            CPPUNIT_ASSERT_EQUAL(reference.count_ones(src.data(), count), GetKernels(level).count_ones(src.data(), count));
+        }
+    }
+}
+
+void TestSimd::TestPenaltyKernels()
+{
+    const Kernels& reference = GetKernels(SimdLevel::SSE2);
+    for (size_t size: {21, 57, 177})
+    {
+        ArrayType plane = RandomBytes(size * size, static_cast<uint32_t>(size), 2);
+        for (size_t i = 0; i < plane.size(); i += 19)
+            plane[i] = plane[i + 1] = plane[i + 2] = 1;
+
+        for (SimdLevel level: SupportedLevels())
+        {
+            const Kernels& k = GetKernels(level);
+            CPPUNIT_ASSERT_EQUAL(reference.penalty_runs(plane.data(), size, size), k.penalty_runs(plane.data(), size, size));
+            CPPUNIT_ASSERT_EQUAL(reference.penalty_squares(plane.data(), size, size), k.penalty_squares(plane.data(), size, size));
+            CPPUNIT_ASSERT_EQUAL(reference.penalty_finders(plane.data(), size, size), k.penalty_finders(plane.data(), size, size));
+        }
+
+        // the fastest level against the plain scans
+        const Kernels& best = GetKernels(SupportedLevels().back());
+        CPPUNIT_ASSERT_EQUAL(ReferenceRuns(plane, size), best.penalty_runs(plane.data(), size, size));
+        CPPUNIT_ASSERT_EQUAL(ReferenceSquares(plane, size), best.penalty_squares(plane.data(), size, size));
+        CPPUNIT_ASSERT_EQUAL(ReferenceFinders(plane, size), best.penalty_finders(plane.data(), size, size));
+    }
+
+    // 7 equal modules give 5, two runs of 5 give 3 each
+    ArrayType row{1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1};
+    CPPUNIT_ASSERT_EQUAL(size_t(11), reference.penalty_runs(row.data(), row.size(), 1));
+
+    // finder-like pattern with 4 white modules after it
+    ArrayType finder{1, 0, 1, 1, 1, 0, 1, 0, 0, 0, 0};
+    CPPUNIT_ASSERT_EQUAL(size_t(1), reference.penalty_finders(finder.data(), finder.size(), 1));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), reference.penalty_finders(finder.data(), finder.size() - 1, 1));
+}
+
+// =============================================================================
+
+void TestSimd::TestExpandBits()
+{
+    for (size_t count: {1, 21, 25, 177})
+    {
+        ArrayType src = RandomBytes((count + 7) / 8, static_cast<uint32_t>(count));
+        for (size_t scale: {1, 2, 3, 5, 8, 9, 13, 16, 17, 33, 70})
+        {
+            for (size_t offset: {0, 3, 8, 27})
+            {
+                size_t bits = offset + count * scale;
+                ArrayType expected((bits + 7) / 8 + 1, 0);
+                for (size_t i = 0; i < count; i++)
+                    if ((src[i / 8] >> (7 - i % 8)) & 1)
+                        for (size_t k = 0; k < scale; k++)
+                            expected[(offset + i * scale + k) / 8] |= 0x80 >> ((offset + i * scale + k) % 8);
+
+                for (SimdLevel level: SupportedLevels())
+                {
+                    ArrayType dst(expected.size(), 0);
+                    GetKernels(level).expand_bits(src.data(), count, scale, offset, dst.data());
+                    CPPUNIT_ASSERT(expected == dst);
+                }
+            }
+        }
+    }
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
@@ -0,0 +1,117 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "encoder.hpp"
+#include "error.hpp"
+#include "outputter.hpp"
+#include "symbol_view.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestSymbolView : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestSymbolView);
+
+    CPPUNIT_TEST(TestModules);
+    CPPUNIT_TEST(TestRows);
+    CPPUNIT_TEST(TestOutput);
+    CPPUNIT_TEST(TestErrors);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestModules();
+    void TestRows();
+    void TestOutput();
+    void TestErrors();
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestSymbolView);
+
+// =============================================================================
+
+void TestSymbolView::TestModules()
+{
+    const std::string text = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789";
+    for (size_t length: {1, 20, 150, 1000})
+    {
+        std::string msg;
+        for (size_t i = 0; i < length; i++)
+            msg += text[(i * 7) % text.size()];
+
+        for (CorrectionLevel cl: {CorrectionLevel::L, CorrectionLevel::M, CorrectionLevel::Q, CorrectionLevel::H})
+        {
+            for (int mask_id: {-1, 0, 5})
+            {
+                SymbolView view = SymbolView::Encode(msg, cl, EncodingType::ALPHANUMERIC, mask_id);
+                Canvas expected = Encoder::Encode(msg, cl, EncodingType::ALPHANUMERIC, mask_id);
+
+                CPPUNIT_ASSERT_EQUAL(expected.Version(), view.Version());
+                for (size_t row = 0; row < expected.Size(); row++)
+                    for (size_t col = 0; col < expected.Size(); col++)
+                        CPPUNIT_ASSERT_EQUAL(expected.At(row, col).value, view.Module(row, col));
+            }
+        }
+    }
+}
+
+// =============================================================================
+
+void TestSymbolView::TestRows()
+{
+    SymbolView view = SymbolView::Encode("https://example.com/labels?id=0042", CorrectionLevel::Q);
+    Canvas expected_canvas = Encoder::Encode("https://example.com/labels?id=0042", CorrectionLevel::Q);
+    CanvasRows canvas(expected_canvas);
+
+    std::vector<uint8_t> values(view.Size());
+    std::vector<uint8_t> packed(view.PackedRowSize());
+    std::vector<uint8_t> expected(canvas.PackedRowSize());
+    for (size_t row = 0; row < view.Size(); row++)
+    {
+        view.Row(row, values);
+        for (size_t col = 0; col < view.Size(); col++)
+            CPPUNIT_ASSERT_EQUAL(view.Module(row, col), values[col]);
+
+        view.PackedRow(row, packed);
+        canvas.PackedRow(row, expected);
+        CPPUNIT_ASSERT(packed == expected);
+    }
+}
+
+// =============================================================================
+
+void TestSymbolView::TestOutput()
+{
+    std::stringstream s1, s2;
+    ImprintOutputter(s1).Output(SymbolView::Encode("0123456789", CorrectionLevel::H, EncodingType::NUNERIC, -1));
+    ImprintOutputter(s2).Output(Encoder::Encode("0123456789", CorrectionLevel::H, EncodingType::NUNERIC, -1));
+    CPPUNIT_ASSERT_EQUAL(s2.str(), s1.str());
+}
+
+// =============================================================================
+
+void TestSymbolView::TestErrors()
+{
+    CPPUNIT_ASSERT_THROW(SymbolView::Encode("12a", CorrectionLevel::M, EncodingType::NUNERIC), Error);
+    CPPUNIT_ASSERT_THROW(SymbolView(std::vector<uint8_t>(10), 1, CorrectionLevel::M, 0), Error);
+    CPPUNIT_ASSERT_THROW(SymbolView(std::vector<uint8_t>(26), 41, CorrectionLevel::M, 0), Error);
+    CPPUNIT_ASSERT_THROW(SymbolView(std::vector<uint8_t>(26), 0, CorrectionLevel::M, 0), Error);
+    CPPUNIT_ASSERT_THROW(SymbolView(std::vector<uint8_t>(26), 1, CorrectionLevel::M, MAX_MASK_ID + 1), Error);
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================
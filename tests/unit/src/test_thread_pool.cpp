@@ -0,0 +1,71 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include "thread_pool.hpp"
+
+
+// =============================================================================
+
+namespace myqro::test
+{
+
+// =============================================================================
+
+class TestThreadPool : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestThreadPool);
+
+    CPPUNIT_TEST(TestParallelFor);
+    CPPUNIT_TEST(TestParallelForException);
+
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void TestParallelFor();
+    void TestParallelForException();
+};
+
+// =============================================================================
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestThreadPool);
+
+// =============================================================================
+
+void TestThreadPool::TestParallelFor()
+{
+    for (size_t n_workers: {0, 1, 3})
+    {
+        ThreadPool pool(n_workers);
+        CPPUNIT_ASSERT_EQUAL(n_workers, pool.WorkersCount());
+
+        for (size_t count: {0, 1, 7, 1000})
+        {
+            std::vector<std::atomic<size_t>> calls(count);
+            pool.ParallelFor(count, [&calls](size_t i) { calls[i]++; });
+            for (const auto& c: calls)
+                CPPUNIT_ASSERT_EQUAL(size_t(1), c.load());
+        }
+    }
+}
+
+void TestThreadPool::TestParallelForException()
+{
+    ThreadPool pool(2);
+    std::atomic<size_t> calls = 0;
+    auto f = [&calls](size_t i)
+    {
+        calls++;
+        if (i == 5) throw std::runtime_error("failed");
+    };
+
+    CPPUNIT_ASSERT_THROW(pool.ParallelFor(10, f), std::runtime_error);
+    CPPUNIT_ASSERT_EQUAL(size_t(10), calls.load());
+}
+
+// =============================================================================
+
+} // namespace myqro::test
+
+// =============================================================================